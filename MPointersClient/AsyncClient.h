@@ -0,0 +1,255 @@
+#ifndef ASYNC_CLIENT_H
+#define ASYNC_CLIENT_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "ConnectionPool.h"
+
+using namespace std;
+
+/*
+  AsyncClient: operaciones remotas sin bloquear al hilo que las pide.
+
+  Usa una sola conexión binaria propia (fuera del ConnectionPool). submit() asigna un requestId,
+  guarda el callback y escribe el mensaje; no espera la respuesta. Un único hilo de E/S lee
+  las respuestas de esa conexión y llama al callback que corresponde a cada requestId, así que
+  cualquier cantidad de operaciones puede estar en vuelo a la vez (el servidor las atiende en
+  orden, una detrás de otra, sin esperar a que el cliente lea).
+
+  Sobre submit() se arman los futures (request()) y los awaitables para corrutinas
+  (RemoteAwaitable) que usan MPointer<T>::getAsync(), setAsync(), NewAsync() y sus variantes
+  Awaitable.
+
+  Los callbacks, y por lo tanto la continuación de las corrutinas, corren en el hilo de E/S:
+  no deben esperar un future de otra operación asíncrona (nunca llegaría). Si la conexión se
+  pierde, las operaciones pendientes terminan con STATUS_ERROR y la próxima abre otra.
+*/
+class AsyncClient {
+public:
+    typedef function<void(protocol::Message&)> Callback;
+
+    static AsyncClient& getInstance() {
+        static AsyncClient instance;
+        return instance;
+    }
+
+    // Envía 'msg' y retorna enseguida; 'done' recibe la respuesta en el hilo de E/S.
+    // false (sin llamar a 'done') si no hay conexión o el servidor solo habla texto.
+    bool submit(protocol::Message& msg, Callback done) {
+        unique_lock<mutex> lock(mtx_);
+        if (sock_ == INVALID_SOCKET && !connectLocked()) return false;
+        uint32_t id = nextRequestId_++;
+        msg.header.requestId = id;
+        pending_.emplace(id, move(done));
+        SOCKET sock = sock_;
+        lock.unlock();
+
+        // El hilo de E/S cierra el socket con sendMtx_ tomado: si con él sigue siendo sock_,
+        // no se cierra (ni otra conexión reusa el descriptor) mientras se escribe
+        lock_guard<mutex> sendLock(sendMtx_);
+        lock.lock();
+        bool current = sock_ == sock;
+        lock.unlock();
+        // Si la conexión ya se cerró, el hilo de E/S terminó esta operación con error
+        if (!current) return true;
+        if (protocol::sendMessage(sock, msg)) return true;
+
+        // Un mensaje a medias deja la conexión inservible: se cierra y el hilo de E/S
+        // termina las demás pendientes. Si ya sacó esta, él llama al callback.
+        net::shutdownBoth(sock);
+        lock.lock();
+        return pending_.erase(id) == 0;
+    }
+
+    // Envía 'msg' y entrega decode(respuesta) en un future
+    template <typename R, typename Decode>
+    future<R> request(protocol::Message& msg, Decode decode) {
+        auto result = make_shared<promise<R>>();
+        future<R> value = result->get_future();
+        if (!submit(msg, [result, decode](protocol::Message& reply) { result->set_value(decode(reply)); })) {
+            protocol::Message failed;
+            failed.header.status = protocol::STATUS_ERROR;
+            result->set_value(decode(failed));
+        }
+        return value;
+    }
+
+    // Operaciones enviadas que todavía no recibieron respuesta
+    size_t inFlight() {
+        lock_guard<mutex> lock(mtx_);
+        return pending_.size();
+    }
+
+    // Cierra la conexión y espera al hilo de E/S (las pendientes terminan con error)
+    void close() {
+        unique_lock<mutex> lock(mtx_);
+        if (sock_ != INVALID_SOCKET) net::shutdownBoth(sock_);
+        readerDone_.wait(lock, [this]() { return readers_ == 0; });
+    }
+
+    ~AsyncClient() {
+        close();
+    }
+
+private:
+    AsyncClient() : sock_(INVALID_SOCKET), nextRequestId_(1), readers_(0) {}
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // Abre la conexión y arranca su hilo de E/S (con mtx_ tomado)
+    bool connectLocked() {
+        SOCKET sock = ConnectionPool::getInstance().openDedicated();
+        if (sock == INVALID_SOCKET) return false;
+        sock_ = sock;
+        readers_++;
+        thread(&AsyncClient::run, this, sock).detach();
+        return true;
+    }
+
+    // Hilo de E/S: entrega cada respuesta a su callback hasta que la conexión se cierra
+    void run(SOCKET sock) {
+        protocol::Message reply;
+        while (protocol::recvMessage(sock, reply)) {
+            Callback done;
+            {
+                lock_guard<mutex> lock(mtx_);
+                auto it = pending_.find(reply.header.requestId);
+                if (it == pending_.end()) continue;
+                done = move(it->second);
+                pending_.erase(it);
+            }
+            done(reply);
+        }
+
+        unordered_map<uint32_t, Callback> failed;
+        {
+            // Con sendMtx_ ningún submit() está escribiendo en este socket ni lo hará después
+            lock_guard<mutex> sendLock(sendMtx_);
+            lock_guard<mutex> lock(mtx_);
+            sock_ = INVALID_SOCKET;
+            failed.swap(pending_);
+            closesocket(sock);
+        }
+        for (auto& entry : failed) {
+            protocol::Message error;
+            error.header.requestId = entry.first;
+            error.header.status = protocol::STATUS_ERROR;
+            entry.second(error);
+        }
+
+        lock_guard<mutex> lock(mtx_);
+        readers_--;
+        readerDone_.notify_all();
+    }
+
+    mutex mtx_;
+    // Los mensajes de hilos distintos no se intercalan en el socket, y el socket no se cierra
+    // mientras se escribe en él. Se toma antes que mtx_.
+    mutex sendMtx_;
+    SOCKET sock_;
+    unordered_map<uint32_t, Callback> pending_;
+    uint32_t nextRequestId_;
+    size_t readers_;
+    condition_variable readerDone_;
+};
+
+/*
+  RemoteAwaitable<R>: operación remota para "co_await". Al suspenderse la corrutina se envía el
+  mensaje; la respuesta, convertida con 'decode', la retoma desde el hilo de E/S.
+  Construido con un valor, ya está resuelto y la corrutina no se suspende.
+*/
+template <typename R>
+class RemoteAwaitable {
+public:
+    RemoteAwaitable(protocol::Message msg, function<R(protocol::Message&)> decode)
+        : msg_(move(msg)), decode_(move(decode)), result_(), ready_(false) {}
+
+    explicit RemoteAwaitable(R ready) : result_(move(ready)), ready_(true) {}
+
+    bool await_ready() const noexcept { return ready_; }
+
+    // Si no se pudo enviar, la corrutina sigue de inmediato con el resultado de error
+    bool await_suspend(coroutine_handle<> handle) {
+        bool sent = AsyncClient::getInstance().submit(msg_, [this, handle](protocol::Message& reply) {
+            result_ = decode_(reply);
+            handle.resume();
+        });
+        if (!sent) {
+            protocol::Message failed;
+            failed.header.status = protocol::STATUS_ERROR;
+            result_ = decode_(failed);
+        }
+        return sent;
+    }
+
+    R await_resume() { return move(result_); }
+
+private:
+    protocol::Message msg_;
+    function<R(protocol::Message&)> decode_;
+    R result_;
+    bool ready_;
+};
+
+/*
+  AsyncTask: tipo de retorno mínimo para escribir corrutinas con MPointers. La corrutina
+  empieza al llamarla y wait() bloquea hasta que termina (no llamarlo desde el hilo de E/S).
+
+      AsyncTask sumar(MPointer<int> a, MPointer<int> b, int* out) {
+          *out = co_await a.getAwaitable() + co_await b.getAwaitable();
+      }
+      sumar(a, b, &total).wait();
+*/
+class AsyncTask {
+public:
+    struct State {
+        mutex mtx;
+        condition_variable cv;
+        bool done = false;
+        exception_ptr error;
+    };
+
+    struct promise_type {
+        shared_ptr<State> state = make_shared<State>();
+
+        AsyncTask get_return_object() { return AsyncTask(state); }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { finish(nullptr); }
+        void unhandled_exception() { finish(current_exception()); }
+
+        void finish(exception_ptr error) {
+            lock_guard<mutex> lock(state->mtx);
+            state->error = error;
+            state->done = true;
+            state->cv.notify_all();
+        }
+    };
+
+    // Espera a que la corrutina termine; relanza su excepción si la hubo
+    void wait() {
+        unique_lock<mutex> lock(state_->mtx);
+        state_->cv.wait(lock, [this]() { return state_->done; });
+        if (state_->error) rethrow_exception(state_->error);
+    }
+
+    bool done() {
+        lock_guard<mutex> lock(state_->mtx);
+        return state_->done;
+    }
+
+private:
+    explicit AsyncTask(shared_ptr<State> state) : state_(move(state)) {}
+
+    shared_ptr<State> state_;
+};
+
+#endif // ASYNC_CLIENT_H
@@ -0,0 +1,325 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "../MemoryManagerServer/Socket.h"
+#include "../MemoryManagerServer/Protocol.h"
+#include "../MemoryManagerServer/SharedRing.h"
+
+using namespace std;
+
+/*
+  ConnectionPool mantiene conexiones TCP persistentes con el Memory Manager.
+
+  Es compartido por todas las instanciaciones de MPointer<T> (MPointer<int>, MPointer<string>, ...),
+  de modo que cada operación toma una conexión libre, envía un frame, lee la respuesta y la
+  devuelve al pool sin cerrarla. Solo se abre una conexión nueva cuando todas están ocupadas
+  (por ejemplo, varios hilos usando MPointers a la vez).
+
+  Al abrir cada conexión se negocia el protocolo binario (protocol::kBinaryHello). Si el
+  servidor no lo soporta, la conexión queda en modo texto y call() no está disponible.
+
+  Si el servidor está en la misma máquina (127.x.x.x o "localhost"), cada conexión binaria pide
+  además un canal de memoria compartida (ver SharedRing.h) y sus mensajes viajan por ahí en
+  lugar de por el stack TCP; si el servidor no tiene canales libres, se sigue por TCP.
+*/
+class ConnectionPool {
+public:
+    static ConnectionPool& getInstance() {
+        static ConnectionPool instance;
+        return instance;
+    }
+
+    // Configura el servidor destino; si cambia, se descartan las conexiones abiertas
+    void configure(const string& ip, int port) {
+        lock_guard<mutex> lock(mtx_);
+        if (ip == serverIP_ && port == serverPort_) return;
+        closeIdleLocked();
+        serverIP_ = ip;
+        serverPort_ = port;
+        binaryMode_.store(-1, memory_order_release);
+    }
+
+    // Activa o desactiva el canal de memoria compartida para las conexiones nuevas
+    void setSharedMemory(bool enabled) {
+        lock_guard<mutex> lock(mtx_);
+        sharedMemory_ = enabled;
+    }
+
+    // Conexiones abiertas que usan memoria compartida
+    size_t sharedChannels() const { return sharedChannels_.load(memory_order_relaxed); }
+
+    // Envía un comando de texto y retorna la respuesta. Si la conexión falla, el comando se
+    // reintenta una vez con una conexión nueva solo cuando no llegó a enviarse o es de lectura
+    // (ver canRetry); en otro caso el servidor pudo haberlo aplicado y se reporta el error.
+    // En conexiones binarias el comando viaja dentro de un mensaje OP_TEXT.
+    string request(const string& command) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = false;
+            Connection conn = acquire(reused);
+            if (conn.sock == INVALID_SOCKET) {
+                return "Error: connect()";
+            }
+            string response;
+            bool ok;
+            bool sent;
+            if (conn.binary) {
+                protocol::Message msg;
+                msg.header.opcode = protocol::OP_TEXT;
+                msg.payload = command;
+                ok = exchange(conn, msg, sent);
+                response = move(msg.payload);
+            }
+            else {
+                sent = protocol::sendFrame(conn.sock, command);
+                ok = sent && protocol::recvFrame(conn.sock, response);
+            }
+            if (ok) {
+                release(conn);
+                return response;
+            }
+            closeConnection(conn);
+            if (!reused) break;
+            if (sent && !isReadOnlyCommand(command)) return "Error: recv()";
+        }
+        return "Error: recv()";
+    }
+
+    // Envía un mensaje binario y lo reemplaza por la respuesta del servidor.
+    // Retorna false si hubo un error de transporte o el servidor solo habla texto; igual que
+    // request(), solo se reintenta si el mensaje no llegó a enviarse o es de lectura.
+    bool call(protocol::Message& msg) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = false;
+            Connection conn = acquire(reused);
+            if (conn.sock == INVALID_SOCKET || !conn.binary) {
+                if (conn.sock != INVALID_SOCKET) release(conn);
+                return false;
+            }
+            protocol::Message copy = msg;
+            bool sent;
+            if (exchange(conn, copy, sent)) {
+                release(conn);
+                msg = move(copy);
+                return true;
+            }
+            closeConnection(conn);
+            if (!reused) break;
+            if (sent && !isReadOnly(msg)) return false;
+        }
+        return false;
+    }
+
+    // Indica si el servidor habla el protocolo binario (se averigua con la primera conexión)
+    bool supportsBinary() {
+        int known = binaryMode_.load(memory_order_acquire);
+        if (known < 0) {
+            bool reused = false;
+            Connection conn = acquire(reused);
+            if (conn.sock == INVALID_SOCKET) return false;
+            release(conn);
+            known = conn.binary ? 1 : 0;
+        }
+        return known == 1;
+    }
+
+    // Abre una conexión binaria fuera del pool (para un canal propio, como el de avisos de
+    // ReadCache); INVALID_SOCKET si no se pudo conectar o el servidor solo habla texto
+    SOCKET openDedicated() {
+        string ip;
+        int port;
+        {
+            lock_guard<mutex> lock(mtx_);
+            ip = serverIP_;
+            port = serverPort_;
+        }
+        SOCKET sock = openConnection(ip, port);
+        if (sock != INVALID_SOCKET && !negotiateBinary(sock)) {
+            closesocket(sock);
+            return INVALID_SOCKET;
+        }
+        return sock;
+    }
+
+    // Cierra todas las conexiones inactivas (por ejemplo, antes de net::cleanup)
+    void closeAll() {
+        lock_guard<mutex> lock(mtx_);
+        closeIdleLocked();
+    }
+
+    ~ConnectionPool() {
+        closeIdleLocked();
+    }
+
+private:
+    ConnectionPool() : serverIP_("127.0.0.1"), serverPort_(8080), sharedMemory_(true), binaryMode_(-1),
+        nextRequestId_(1), sharedChannels_(0) {}
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Máximo de conexiones inactivas que se conservan abiertas
+    static constexpr size_t kMaxIdle = 16;
+
+    struct Connection {
+        SOCKET sock = INVALID_SOCKET;
+        bool binary = false;
+        // Canal de memoria compartida (nullptr: los mensajes van por el socket)
+        shm::Segment* segment = nullptr;
+    };
+
+    // Intercambia un mensaje binario y verifica que la respuesta corresponda a la petición.
+    // 'sent' queda en true si la petición salió completa (el servidor pudo haberla ejecutado).
+    bool exchange(Connection& conn, protocol::Message& msg, bool& sent) {
+        msg.header.requestId = nextRequestId_.fetch_add(1, memory_order_relaxed);
+        uint32_t requestId = msg.header.requestId;
+        if (conn.segment) {
+            return shm::call(conn.segment, conn.sock, msg, sent) && msg.header.requestId == requestId;
+        }
+        sent = protocol::sendMessage(conn.sock, msg);
+        return sent
+            && protocol::recvMessage(conn.sock, msg)
+            && msg.header.requestId == requestId;
+    }
+
+    // Operaciones que se pueden repetir sin efectos: si se perdió la respuesta, reenviarlas
+    // por otra conexión no cambia el estado del servidor
+    static bool isReadOnly(const protocol::Message& msg) {
+        switch (msg.header.opcode) {
+        case protocol::OP_GET:
+        case protocol::OP_STATUS:
+        case protocol::OP_MAP:
+        case protocol::OP_READ_RANGE:
+        case protocol::OP_TX_GET:
+            return true;
+        case protocol::OP_TEXT:
+            return isReadOnlyCommand(msg.payload);
+        default:
+            return false;
+        }
+    }
+
+    static bool isReadOnlyCommand(const string& command) {
+        string name = command.substr(0, command.find(' '));
+        return name == "get" || name == "status" || name == "map" || name == "stats" || name == "tget";
+    }
+
+    // Toma una conexión libre o abre una nueva. Las conexiones inactivas que el servidor ya
+    // cerró se descartan aquí, antes de enviar nada por ellas.
+    Connection acquire(bool& reused) {
+        string ip;
+        int port;
+        bool sharedMemory;
+        {
+            lock_guard<mutex> lock(mtx_);
+            while (!idle_.empty()) {
+                Connection conn = idle_.back();
+                idle_.pop_back();
+                if (net::hasPendingInput(conn.sock)) {
+                    closeConnection(conn);
+                    continue;
+                }
+                reused = true;
+                return conn;
+            }
+            ip = serverIP_;
+            port = serverPort_;
+            sharedMemory = sharedMemory_;
+        }
+        reused = false;
+        Connection conn;
+        conn.sock = openConnection(ip, port);
+        if (conn.sock != INVALID_SOCKET) {
+            conn.binary = negotiateBinary(conn.sock);
+            binaryMode_.store(conn.binary ? 1 : 0, memory_order_release);
+            if (conn.binary && sharedMemory && shm::kSupported && isLocal(ip)) {
+                conn.segment = attachShared(conn.sock);
+            }
+        }
+        return conn;
+    }
+
+    // Devuelve una conexión sana al pool
+    void release(const Connection& conn) {
+        lock_guard<mutex> lock(mtx_);
+        if (idle_.size() < kMaxIdle) {
+            idle_.push_back(conn);
+        }
+        else {
+            closeConnection(conn);
+        }
+    }
+
+    void closeConnection(const Connection& conn) {
+        if (conn.segment) {
+            shm::detach(conn.segment);
+            sharedChannels_.fetch_sub(1, memory_order_relaxed);
+        }
+        closesocket(conn.sock);
+    }
+
+    static bool isLocal(const string& ip) {
+        return ip == "localhost" || ip.rfind("127.", 0) == 0;
+    }
+
+    // Pide un canal de memoria compartida por la conexión recién abierta; nullptr si el
+    // servidor no lo ofrece (servidor antiguo, otro sistema o sin canales libres)
+    shm::Segment* attachShared(SOCKET sock) {
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_SHM_ATTACH;
+        msg.header.requestId = nextRequestId_.fetch_add(1, memory_order_relaxed);
+        if (!protocol::sendMessage(sock, msg) || !protocol::recvMessage(sock, msg)
+            || msg.header.status != protocol::STATUS_OK)
+            return nullptr;
+        shm::Segment* segment = shm::attach(msg.payload);
+        if (segment) sharedChannels_.fetch_add(1, memory_order_relaxed);
+        return segment;
+    }
+
+    // Propone el protocolo binario; un servidor que no lo conoce responde con un error de texto
+    static bool negotiateBinary(SOCKET sock) {
+        string reply;
+        return protocol::sendFrame(sock, protocol::kBinaryHello)
+            && protocol::recvFrame(sock, reply)
+            && reply == protocol::kBinaryHello;
+    }
+
+    static SOCKET openConnection(const string& ip, int port) {
+        SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock == INVALID_SOCKET) {
+            return INVALID_SOCKET;
+        }
+        sockaddr_in serverAddr;
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(port);
+        inet_pton(AF_INET, ip.c_str(), &serverAddr.sin_addr);
+
+        if (connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+            closesocket(sock);
+            return INVALID_SOCKET;
+        }
+        protocol::setNoDelay(sock);
+        return sock;
+    }
+
+    void closeIdleLocked() {
+        for (const Connection& conn : idle_) {
+            closeConnection(conn);
+        }
+        idle_.clear();
+    }
+
+    mutex mtx_;
+    vector<Connection> idle_;
+    string serverIP_;
+    int serverPort_;
+    bool sharedMemory_;
+    // -1 desconocido, 0 solo texto, 1 binario
+    atomic<int> binaryMode_;
+    atomic<uint32_t> nextRequestId_;
+    atomic<size_t> sharedChannels_;
+};
+
+#endif // CONNECTION_POOL_H
@@ -0,0 +1,164 @@
+#ifndef MPOINTER_BATCH_H
+#define MPOINTER_BATCH_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Mpointer.h"
+
+using namespace std;
+
+/*
+  MPointerBatch acumula operaciones sobre MPointers (create, set, get, increase, decrease)
+  y las envía en un único mensaje OP_BATCH. El servidor ejecuta las operaciones en tandas de
+  hasta mil con una sola toma de sus mutex y responde con los resultados en el mismo orden, de modo que inicializar
+  miles de MPointers cuesta un viaje de red en lugar de miles.
+
+  Uso:
+      MPointerBatch batch;
+      vector<MPointer<int>> ps(1000);
+      for (auto& p : ps) batch.create(p);
+      batch.flush();                       // crea los 1000 bloques
+      for (size_t i = 0; i < ps.size(); i++) batch.set(ps[i], (int)i);
+      int x; batch.get(ps[0], x);
+      batch.flush();                       // 1000 set + 1 get en un solo mensaje
+
+  Los resultados de get() y create() quedan disponibles después de flush(). Los MPointers y
+  variables pasados por referencia deben seguir vivos hasta entonces.
+  Requiere que el servidor hable el protocolo binario; si no, flush() retorna false sin enviar nada.
+*/
+class MPointerBatch {
+public:
+    MPointerBatch() = default;
+    MPointerBatch(const MPointerBatch&) = delete;
+    MPointerBatch& operator=(const MPointerBatch&) = delete;
+
+    // Crea un bloque y, al hacer flush(), lo asigna a 'target'
+    template <typename T>
+    void create(MPointer<T>& target) {
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_CREATE;
+        msg.payload.resize(4);
+        protocol::putU32(&msg.payload[0], static_cast<uint32_t>(sizeof(T)));
+        msg.payload += MPointer<T>::typeName();
+        MPointer<T>* dst = addressof(target);
+        enqueue(msg, [dst](const protocol::Message& reply) {
+            if (reply.header.status != protocol::STATUS_OK) return;
+            // El bloque nuevo ya nace con refCount 1 en el servidor: se adopta sin increase
+            if (dst->blockID >= 0)
+                MPointer<T>::decreaseRef(dst->blockID);
+            dst->blockID = reply.header.blockId;
+            RefDeltaTable::getInstance().track(dst->blockID);
+        });
+    }
+
+    template <typename T>
+    void set(const MPointer<T>& p, const T& val) {
+        static_assert(MPointer<T>::binaryEncodable, "MPointerBatch solo admite tipos del protocolo binario");
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_SET;
+        msg.header.blockId = p.blockID;
+        MPointer<T>::encodeValue(val, msg.payload);
+        int id = p.blockID;
+        enqueue(msg, [id](const protocol::Message&) {
+            ReadCache::getInstance().invalidate(id);
+        });
+    }
+
+    // Lee el valor del bloque en 'out' al hacer flush()
+    template <typename T>
+    void get(const MPointer<T>& p, T& out) {
+        static_assert(MPointer<T>::binaryEncodable, "MPointerBatch solo admite tipos del protocolo binario");
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_GET;
+        msg.header.blockId = p.blockID;
+        T* dst = &out;
+        enqueue(msg, [dst](const protocol::Message& reply) {
+            if (reply.header.status == protocol::STATUS_OK)
+                MPointer<T>::decodeValue(reply.payload, *dst);
+        });
+    }
+
+    template <typename T>
+    void increase(const MPointer<T>& p) { enqueueRef(protocol::OP_INCREASE, p.blockID); }
+
+    template <typename T>
+    void decrease(const MPointer<T>& p) { enqueueRef(protocol::OP_DECREASE, p.blockID); }
+
+    // Cantidad de operaciones pendientes
+    size_t size() const { return callbacks_.size(); }
+
+    // Envía las operaciones pendientes y aplica los resultados. Los lotes muy grandes se
+    // parten en varios mensajes de hasta protocol::kMaxBatchOps operaciones.
+    bool flush() {
+        if (callbacks_.empty()) return true;
+        ConnectionPool& pool = ConnectionPool::getInstance();
+        if (!pool.supportsBinary()) return false;
+
+        bool ok = true;
+        size_t begin = 0;
+        while (begin < chunks_.size()) {
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_BATCH;
+            msg.payload.swap(chunks_[begin].payload);
+            uint32_t count = chunks_[begin].count;
+            protocol::putU32(&msg.payload[0], count);
+
+            if (!pool.call(msg) || msg.header.status != protocol::STATUS_OK
+                || msg.payload.size() < 4 || protocol::getU32(msg.payload.data()) != count) {
+                ok = false;
+                break;
+            }
+            size_t pos = 4;
+            protocol::Message reply;
+            for (uint32_t i = 0; i < count; i++) {
+                if (!protocol::readMessage(msg.payload, pos, reply)) {
+                    ok = false;
+                    break;
+                }
+                auto& callback = callbacks_[chunks_[begin].first + i];
+                if (callback) callback(reply);
+            }
+            if (!ok) break;
+            begin++;
+        }
+        callbacks_.clear();
+        chunks_.clear();
+        return ok;
+    }
+
+private:
+    // Un frame OP_BATCH en construcción
+    struct Chunk {
+        string payload;     // uint32 N + mensajes (el conteo se escribe al enviar)
+        uint32_t count = 0;
+        size_t first = 0;   // índice de la primera operación del chunk en callbacks_
+    };
+
+    void enqueue(protocol::Message& msg, function<void(const protocol::Message&)> callback) {
+        if (chunks_.empty() || chunks_.back().count == protocol::kMaxBatchOps
+            || chunks_.back().payload.size() + protocol::kHeaderSize + msg.payload.size() > protocol::kMaxFrameSize) {
+            Chunk chunk;
+            chunk.payload.resize(4);
+            chunk.first = callbacks_.size();
+            chunks_.push_back(move(chunk));
+        }
+        msg.header.requestId = static_cast<uint32_t>(callbacks_.size());
+        protocol::appendMessage(chunks_.back().payload, msg);
+        chunks_.back().count++;
+        callbacks_.push_back(move(callback));
+    }
+
+    void enqueueRef(uint8_t opcode, int id) {
+        if (id < 0) return;
+        protocol::Message msg;
+        msg.header.opcode = opcode;
+        msg.header.blockId = id;
+        enqueue(msg, nullptr);
+    }
+
+    vector<Chunk> chunks_;
+    vector<function<void(const protocol::Message&)>> callbacks_;
+};
+
+#endif // MPOINTER_BATCH_H
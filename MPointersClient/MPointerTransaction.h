@@ -0,0 +1,114 @@
+#ifndef MPOINTER_TRANSACTION_H
+#define MPOINTER_TRANSACTION_H
+
+#include <vector>
+#include "Mpointer.h"
+
+using namespace std;
+
+/*
+  MPointerTransaction agrupa lecturas y escrituras de varios MPointers que el servidor aplica
+  todas juntas o ninguna. Es optimista: nada se bloquea mientras la transacción está abierta;
+  al confirmar, el servidor comprueba que ningún bloque leído o escrito haya cambiado desde
+  entonces y, si alguno cambió, la descarta entera. En ese caso se vuelve a intentar.
+
+  Uso (mover 10 de un saldo a otro):
+      MPointerTransaction tx;
+      do {
+          tx.begin();
+          long a = tx.get(origen), b = tx.get(destino);
+          tx.set(origen, a - 10);
+          tx.set(destino, b + 10);
+      } while (!tx.commit());
+
+  get() ve lo que la misma transacción ya escribió; los demás clientes no ven nada hasta
+  commit(). Una transacción sin escrituras solo compara versiones al confirmar. Admite los
+  tipos del protocolo binario (no arreglos) y requiere que el servidor lo hable; si no,
+  begin() y commit() retornan false. Si se destruye abierta, se descarta.
+*/
+class MPointerTransaction {
+public:
+    MPointerTransaction() : tx_(0), conflictBlock_(0) {}
+    MPointerTransaction(const MPointerTransaction&) = delete;
+    MPointerTransaction& operator=(const MPointerTransaction&) = delete;
+
+    ~MPointerTransaction() { abort(); }
+
+    // Abre una transacción nueva (descarta la anterior si seguía abierta)
+    bool begin() {
+        abort();
+        written_.clear();
+        protocol::Message msg;
+        if (!ConnectionPool::getInstance().supportsBinary() || !call(protocol::OP_TX_BEGIN, -1, msg)
+            || msg.payload.size() < 4)
+            return false;
+        tx_ = protocol::getU32(msg.payload.data());
+        return true;
+    }
+
+    template <typename T>
+    T get(const MPointer<T>& p) {
+        static_assert(MPointer<T>::binaryEncodable, "MPointerTransaction solo admite tipos del protocolo binario");
+        T result{};
+        protocol::Message msg;
+        if (tx_ != 0 && call(protocol::OP_TX_GET, p.blockID, msg))
+            MPointer<T>::decodeValue(msg.payload, result);
+        return result;
+    }
+
+    template <typename T>
+    bool set(const MPointer<T>& p, const T& val) {
+        static_assert(MPointer<T>::binaryEncodable, "MPointerTransaction solo admite tipos del protocolo binario");
+        if (tx_ == 0) return false;
+        string value;
+        MPointer<T>::encodeValue(val, value);
+        protocol::Message msg;
+        if (!call(protocol::OP_TX_SET, p.blockID, msg, value)) return false;
+        written_.push_back(p.blockID);
+        return true;
+    }
+
+    // Aplica las escrituras; false si algún bloque cambió (ver conflictBlock()) o la
+    // transacción no existe. En ambos casos queda cerrada.
+    bool commit() {
+        if (tx_ == 0) return false;
+        protocol::Message msg;
+        bool ok = call(protocol::OP_TX_COMMIT, -1, msg);
+        conflictBlock_ = msg.header.status == protocol::STATUS_CONFLICT ? msg.header.blockId : 0;
+        tx_ = 0;
+        for (int id : written_) ReadCache::getInstance().invalidate(id);
+        written_.clear();
+        return ok;
+    }
+
+    // Descarta la transacción abierta (si hay una)
+    void abort() {
+        if (tx_ == 0) return;
+        protocol::Message msg;
+        call(protocol::OP_TX_ABORT, -1, msg);
+        tx_ = 0;
+        written_.clear();
+    }
+
+    bool isOpen() const { return tx_ != 0; }
+
+    // Bloque que cambió en el último commit() rechazado (0 si no hubo conflicto)
+    int conflictBlock() const { return conflictBlock_; }
+
+private:
+    // Envía la operación con el número de transacción al inicio del payload
+    bool call(uint8_t opcode, int id, protocol::Message& msg, const string& value = string()) {
+        msg.header.opcode = opcode;
+        msg.header.blockId = id;
+        msg.payload.assign(4, '\0');
+        protocol::putU32(&msg.payload[0], tx_);
+        msg.payload += value;
+        return ConnectionPool::getInstance().call(msg) && msg.header.status == protocol::STATUS_OK;
+    }
+
+    uint32_t tx_;
+    int conflictBlock_;
+    vector<int> written_;
+};
+
+#endif // MPOINTER_TRANSACTION_H
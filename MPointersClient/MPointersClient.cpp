@@ -1,13 +1,37 @@
 #include <iostream>
-#include "MPointer.h"
-#include <winsock2.h>
-#pragma comment(lib, "Ws2_32.lib")
+#include "Mpointer.h"
+#include "MPointerBatch.h"
+#include "MPointerTransaction.h"
+#include <vector>
+#include <thread>
 using namespace std;
 
+// Crea un bloque con un valor y lo retorna por valor (se mueve, no se copia)
+static MPointer<int> crearConValor(int valor) {
+    MPointer<int> p = MPointer<int>::New();
+    *p = valor;
+    return p;
+}
+
+// Corrutina: crea 'n' bloques, los escribe y suma sus valores sin bloquear ningún hilo
+static AsyncTask sumarRemotos(int n, long long* total) {
+    vector<MPointer<int>> bloques;
+    for (int i = 0; i < n; i++) {
+        bloques.push_back(co_await MPointer<int>::NewAwaitable());
+        co_await bloques.back().setAwaitable(i + 1);
+    }
+    *total = 0;
+    for (const MPointer<int>& p : bloques) *total += co_await p.getAwaitable();
+}
+
+// Mensajes increase/decrease enviados hasta ahora
+static unsigned long long mensajesRefCount() {
+    return MPointerStats::increases + MPointerStats::decreases;
+}
+
 int main() {
-    // Inicializar Winsock
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    // Inicializar los sockets (Winsock en Windows)
+    if (!net::startup()) {
         cout << "WSAStartup failed." << endl;
         return 1;
     }
@@ -74,13 +98,235 @@ int main() {
     cout << "           pInt  ID: " << &pInt << " - Valor: " << *pInt << endl;
     cout << "           pInt2 ID: " << &pInt2 << " - Valor: " << *pInt2 << endl;
 
+    // --- Prueba de lote: 100 bloques creados, asignados y leídos en dos viajes ---
+    MPointerBatch batch;
+    vector<MPointer<int>> arreglo(100);
+    for (auto& p : arreglo) batch.create(p);
+    batch.flush();
+    for (size_t i = 0; i < arreglo.size(); i++) batch.set(arreglo[i], static_cast<int>(i * i));
+    int ultimo = 0;
+    batch.get(arreglo.back(), ultimo);
+    batch.flush();
+    cout << "\n[CLIENTE] Lote de " << arreglo.size() << " MPointer<int>, último valor: " << ultimo << endl;
+
+    // --- Prueba de movimiento: crecer un vector y retornar por valor no envía increase/decrease ---
+    {
+        unsigned long long antes = mensajesRefCount();
+        vector<MPointer<int>> crecido;
+        for (int i = 0; i < 20; i++)
+            crecido.push_back(crearConValor(i));   // el vector se realoja varias veces
+        MPointer<int> movido = move(crecido.front());
+        swap(movido, crecido.back());
+        unsigned long long mensajes = mensajesRefCount() - antes;
+        cout << "\n[CLIENTE] Vector de " << crecido.size() << " MPointer<int> (capacidad " << crecido.capacity()
+             << "), mensajes increase/decrease: " << mensajes << (mensajes == 0 ? " (OK)" : " (ERROR)") << endl;
+        cout << "           movido ID: " << &movido << " - Valor: " << *movido
+             << ", origen nulo: " << (crecido.front().isNull() ? "true" : "false") << endl;
+        movido.reset();
+        cout << "           Tras reset(): nulo = " << (movido.isNull() ? "true" : "false")
+             << ", decrease enviados: " << mensajesRefCount() - antes << endl;
+    }
+
+    // --- Prueba de refCount diferido: muchas copias se resumen en pocos mensajes refdelta ---
+    {
+        unsigned long long cambiosAntes = mensajesRefCount();
+        unsigned long long mensajesAntes = RefDeltaTable::getInstance().messagesSent();
+        vector<MPointer<int>> copias;
+        for (int i = 0; i < 1000; i++) {
+            MPointer<int> copia = pInt;        // increase
+            copias.push_back(copia);           // increase; 'copia' se destruye: decrease
+        }
+        copias.clear();                        // 1000 decrease
+        RefDeltaTable::getInstance().flush();
+        cout << "\n[CLIENTE] Copias de pInt: " << mensajesRefCount() - cambiosAntes
+             << " cambios de refCount, mensajes refdelta: "
+             << RefDeltaTable::getInstance().messagesSent() - mensajesAntes
+             << " - Valor: " << *pInt << endl;
+    }
+
+    // --- Prueba de arreglo remoto: 100000 int en un solo bloque, escritos y leídos por rangos ---
+    {
+        MPointer<int[]> pArr = MPointer<int[]>::New(100000);
+        vector<int> datos(pArr.size());
+        for (size_t i = 0; i < datos.size(); i++) datos[i] = static_cast<int>(i * 3);
+        bool escrito = pArr.write(0, datos.size(), datos.data());
+        vector<int> tramo(5);
+        bool leido = pArr.read(99995, tramo.size(), tramo.data());
+        pArr[7] = -1;
+        int septimo = pArr[7];
+        cout << "\n[CLIENTE] MPointer<int[]> de " << pArr.size() << " elementos con ID: " << pArr.getID()
+             << " (escritura " << (escrito ? "ok" : "error") << ", lectura " << (leido ? "ok" : "error") << ")" << endl;
+        cout << "           Últimos 5:";
+        for (int v : tramo) cout << " " << v;
+        cout << " - Elemento 7: " << septimo
+             << " - Fuera de rango: " << (pArr.read(99999, 2, tramo.data()) ? "aceptado (ERROR)" : "rechazado") << endl;
+    }
+
+    // --- Prueba de caché de lecturas con leases: lecturas repetidas sin viajes de red ---
+    if (ReadCache::getInstance().enable()) {
+        ReadCache& cache = ReadCache::getInstance();
+        unsigned long long aciertosAntes = cache.hits();
+        long long suma = 0;
+        for (int i = 0; i < 1000; i++) suma += *pInt;
+        cout << "\n[CLIENTE] 1000 lecturas de pInt con caché: " << cache.hits() - aciertosAntes
+             << " desde el caché, suma " << suma << endl;
+
+        // Otro cliente (una conexión aparte) escribe el bloque: el servidor avisa al caché
+        SOCKET otro = ConnectionPool::getInstance().openDedicated();
+        protocol::Message set;
+        set.header.opcode = protocol::OP_SET;
+        set.header.blockId = pInt.getID();
+        set.payload.resize(4);
+        protocol::putU32(&set.payload[0], 456);
+        bool escrito = otro != INVALID_SOCKET && protocol::sendMessage(otro, set) && protocol::recvMessage(otro, set);
+        if (otro != INVALID_SOCKET) closesocket(otro);
+        this_thread::sleep_for(chrono::milliseconds(50));
+        cout << "[CLIENTE] Tras escribir 456 desde otro cliente (" << (escrito ? "ok" : "error")
+             << "): avisos recibidos " << cache.invalidations() << ", valor leído " << *pInt << endl;
+        *pInt = 123;
+        cout << "[CLIENTE] Tras escribir 123 desde este cliente, valor leído " << *pInt << endl;
+        cache.disable();
+    }
+
+    // --- Prueba de operaciones atómicas: 4 hilos incrementan el mismo contador sin locks ---
+    {
+        MPointer<long> contador = MPointer<long>::New();
+        *contador = 0;
+        vector<thread> hilos;
+        for (int h = 0; h < 4; h++) {
+            hilos.emplace_back([&contador]() {
+                for (int i = 0; i < 500; i++) contador.fetch_add(1);
+            });
+        }
+        for (thread& t : hilos) t.join();
+        long esperado = 2000;
+        bool cambiado = contador.compare_exchange(esperado, -1);
+        long fallido = 5;
+        bool repetido = contador.compare_exchange(fallido, 7);
+        cout << "\n[CLIENTE] 4 hilos x 500 fetch_add sobre el ID " << contador.getID() << ": "
+             << (cambiado ? "2000 (cas a -1 ok)" : "cas falló") << " - cas con 5: "
+             << (repetido ? "intercambiado (ERROR)" : "rechazado") << ", valor actual " << fallido
+             << " - exchange retorna " << contador.exchange(42) << ", queda " << *contador << endl;
+    }
+
+    // --- Prueba de transacciones: 4 hilos mueven saldos entre dos cuentas; el total se mantiene ---
+    {
+        MPointer<long> cuentaA = MPointer<long>::New();
+        MPointer<long> cuentaB = MPointer<long>::New();
+        *cuentaA = 1000;
+        *cuentaB = 1000;
+        atomic<int> conflictos{ 0 };
+        vector<thread> hilos;
+        for (int h = 0; h < 4; h++) {
+            hilos.emplace_back([&, h]() {
+                MPointerTransaction tx;
+                for (int i = 0; i < 100; i++) {
+                    long monto = (h % 2 == 0) ? 3 : -2;
+                    while (true) {
+                        tx.begin();
+                        long a = tx.get(cuentaA), b = tx.get(cuentaB);
+                        tx.set(cuentaA, a - monto);
+                        tx.set(cuentaB, b + monto);
+                        if (tx.commit()) break;
+                        conflictos++;
+                    }
+                }
+            });
+        }
+        for (thread& t : hilos) t.join();
+        MPointerTransaction lectura;
+        lectura.begin();
+        long a = lectura.get(cuentaA), b = lectura.get(cuentaB);
+        bool consistente = lectura.commit();
+        cout << "\n[CLIENTE] 400 transferencias entre los IDs " << cuentaA.getID() << " y " << cuentaB.getID()
+             << ": A=" << a << ", B=" << b << ", total " << a + b << " (" << conflictos.load()
+             << " reintentos por conflicto, lectura " << (consistente ? "consistente" : "en conflicto") << ")" << endl;
+    }
+
+    // --- Prueba asíncrona: 500 lecturas en vuelo a la vez y una corrutina con co_await ---
+    {
+        vector<MPointer<int>> bloques;
+        for (int i = 0; i < 5; i++) bloques.push_back(MPointer<int>::NewAsync().get());
+        vector<future<bool>> escrituras;
+        for (size_t i = 0; i < bloques.size(); i++) escrituras.push_back(bloques[i].setAsync(static_cast<int>(i * 10)));
+        for (future<bool>& f : escrituras) f.get();
+
+        vector<future<int>> lecturas;
+        size_t enVuelo = 0;
+        for (int i = 0; i < 500; i++) {
+            lecturas.push_back(bloques[i % bloques.size()].getAsync());
+            enVuelo = max(enVuelo, AsyncClient::getInstance().inFlight());
+        }
+        long long suma = 0;
+        for (future<int>& f : lecturas) suma += f.get();
+        cout << "\n[CLIENTE] 500 getAsync() sobre " << bloques.size() << " bloques (" << enVuelo
+             << " en vuelo como máximo): suma " << suma << (suma == 10000 ? " (OK)" : " (ERROR)") << endl;
+
+        long long total = 0;
+        sumarRemotos(10, &total).wait();
+        cout << "[CLIENTE] Corrutina con co_await sobre 10 bloques nuevos: suma " << total
+             << (total == 55 ? " (OK)" : " (ERROR)") << endl;
+    }
+
+    // --- Prueba de respuestas grandes en tubería: 10 lecturas de 2 MB enviadas sin esperar ---
+    // Superan el límite de salida pendiente del servidor, que debe pausar la conexión y
+    // retomar los pedidos encolados a medida que el cliente consume las respuestas.
+    {
+        const size_t elementos = 1 << 19;
+        MPointer<int[]> grande = MPointer<int[]>::New(elementos);
+        vector<int> datos(elementos);
+        for (size_t i = 0; i < datos.size(); i++) datos[i] = static_cast<int>(i);
+        bool escrito = grande.write(0, datos.size(), datos.data());
+
+        vector<future<bool>> lecturas;
+        for (int i = 0; i < 10; i++) {
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_READ_RANGE;
+            msg.header.blockId = grande.getID();
+            msg.payload.resize(8);
+            protocol::putU32(&msg.payload[0], 0);
+            protocol::putU32(&msg.payload[4], static_cast<uint32_t>(elementos));
+            lecturas.push_back(AsyncClient::getInstance().request<bool>(msg, [elementos](protocol::Message& reply) {
+                if (reply.header.status != protocol::STATUS_OK || reply.payload.size() != elementos * sizeof(int))
+                    return false;
+                int ultimo;
+                memcpy(&ultimo, reply.payload.data() + reply.payload.size() - sizeof(int), sizeof(int));
+                return ultimo == static_cast<int>(elementos - 1);
+            }));
+        }
+        int respondidas = 0;
+        for (future<bool>& f : lecturas) {
+            if (f.wait_for(chrono::seconds(10)) != future_status::ready) break;
+            if (f.get()) respondidas++;
+        }
+        cout << "\n[CLIENTE] 10 lecturas en tubería de " << elementos * sizeof(int) / (1024 * 1024)
+             << " MB sobre el ID " << grande.getID() << " (escritura " << (escrito ? "ok" : "error") << "): "
+             << respondidas << " de 10 respondidas" << (respondidas == 10 ? " (OK)" : " (ERROR)") << endl;
+        if (respondidas < 10) {
+            // Las pendientes no van a llegar: se cierra la conexión para que terminen con error
+            AsyncClient::getInstance().close();
+            for (future<bool>& f : lecturas) if (f.valid()) f.wait();
+        }
+    }
+
     // Instrucciones de uso:
     // - MPointer<T>::New() crea un puntero remoto (se reserva localmente solo el blockID).
     // - Para asignar un valor, se usa: *p = valor;
     // - Para leer el valor, se usa: T x = *p;
     // - Para obtener el identificador (la “dirección remota”), se usa p.getID() o el operador & (sobrecargado).
     // - Para copiar un puntero, se usa p2 = p; (esto incrementa el refCount en el servidor).
+    // - Mover (p2 = move(p), retornar por valor, vector) y swap() no envían mensajes; reset() suelta el bloque.
+    // - Los cambios de refCount de las copias viajan acumulados (RefDeltaTable::flush() los envía ya).
+    // - ReadCache::getInstance().enable() activa el caché de lecturas con leases del servidor.
+    // - MPointer<T[]>::New(n) crea un arreglo en un solo bloque; p[i], read() y write() lo acceden por rangos.
+    // - fetch_add(), exchange() y compare_exchange() se ejecutan en el servidor en un solo viaje.
+    // - MPointerTransaction aplica varias escrituras juntas o ninguna (commit() false: reintentar).
+    // - Para muchas operaciones seguidas, MPointerBatch las envía en un solo mensaje (flush()).
+    // - getAsync(), setAsync() y NewAsync() retornan futures; getAwaitable() y compañía sirven para co_await.
 
-    WSACleanup();
+    RefDeltaTable::getInstance().flush();
+    AsyncClient::getInstance().close();
+    ConnectionPool::getInstance().closeAll();
+    net::cleanup();
     return 0;
 }
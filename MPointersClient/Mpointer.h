@@ -2,16 +2,21 @@
 #define MPOINTER_H
 
 #include <string>
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <iostream>
 #include <type_traits>
 #include <sstream>
 #include <mutex>
 #include <iomanip>
+#include <limits>
 #include <cstring>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include "ConnectionPool.h"
+#include "RefDeltaTable.h"
+#include "ReadCache.h"
+#include "AsyncClient.h"
 
-#pragma comment(lib, "Ws2_32.lib")
 using namespace std;
 
 /*
@@ -19,16 +24,33 @@ using namespace std;
   Internamente, guarda nicamente el identificador (blockID) del bloque asignado por el Memory Manager.
 
   Se comunican comandos (create, set, get, increase, decrease) con el servidor mediante sockets.
+  Las conexiones son persistentes y las comparte ConnectionPool entre todas las instanciaciones de MPointer.
+  Los increase/decrease de copias y destrucciones no viajan uno a uno: RefDeltaTable los acumula y
+  enva los cambios netos en un mensaje refdelta (de inmediato cuando un bloque se queda sin MPointers).
+  Con ReadCache activo, las lecturas repetidas se responden localmente mientras dure el lease del servidor.
+  getAsync, setAsync y NewAsync (y sus variantes Awaitable para co_await) no esperan la respuesta:
+  AsyncClient las enva por su propia conexin y entrega el resultado cuando llega.
 
   Se sobrecargan los siguientes operadores:
     *   Se usa un objeto Proxy para que *p sirva tanto para lectura (convertido a T) como para asignacin.
     =   Permite asignar un valor a un MPointer (o copiar otro MPointer, copiando el blockID y ajustando el refCount).
+         Mover un MPointer transfiere el blockID sin contactar al servidor (el origen queda nulo).
     &   Est sobrecargado como miembro para retornar el blockID, _simulando_ la direccin remota.
 
   Nota: Debido a que sobrecargar operator& implica que &pInt ya no retorna la direccin de pInt en memoria local,
   se debe usar nicamente para obtener el identificador del bloque en el servidor (no para compararlo con nullptr).
 */
 
+class MPointerBatch;
+class MPointerTransaction;
+
+// Contadores de cambios de refCount (increase/decrease) pedidos por todos los MPointer del proceso
+// (lo que llega al servidor son los mensajes refdelta de RefDeltaTable)
+struct MPointerStats {
+    static inline atomic<unsigned long long> increases{ 0 };
+    static inline atomic<unsigned long long> decreases{ 0 };
+};
+
 template <typename T>
 class MPointer {
 public:
@@ -41,9 +63,21 @@ public:
     // Operador de asignacin de otro MPointer (copia el blockID e incrementa refCount)
     MPointer<T>& operator=(const MPointer<T>& other);
 
+    // Constructor de movimiento: toma el blockID de 'other' sin tocar el refCount
+    MPointer(MPointer<T>&& other) noexcept;
+
+    // Asignacin por movimiento: libera el bloque propio (decrease) y toma el de 'other'
+    MPointer<T>& operator=(MPointer<T>&& other) noexcept;
+
     // Operador de asignacin desde un valor T (permite "p = valor")
     MPointer<T>& operator=(const T& val);
 
+    // Intercambia los bloques de dos MPointer (sin mensajes al servidor)
+    void swap(MPointer<T>& other) noexcept { std::swap(blockID, other.blockID); }
+
+    // Suelta el bloque (decrease) y queda nulo
+    void reset();
+
     // Destructor: decrementa el refCount en el servidor
     ~MPointer();
 
@@ -70,6 +104,23 @@ public:
     // Mtodo para obtener el ID del bloque
     int getID() const;
 
+    // Operaciones atmicas en el servidor (int, long, float, double y bool): una sola ida y
+    // vuelta, sin intercalarse con las de otros clientes. Retornan el valor anterior.
+    // fetch_add suma 'delta' (no para bool); exchange escribe 'desired'; compare_exchange escribe
+    // 'desired' solo si el valor actual es 'expected' y, si no, deja en 'expected' el actual.
+    T fetch_add(const T& delta);
+    T exchange(const T& desired);
+    bool compare_exchange(T& expected, const T& desired);
+
+    // Versiones asncronas de get y set: retornan enseguida y el resultado llega en el future
+    // (T() o false si fall). Las variantes Awaitable son para "co_await" dentro de una
+    // corrutina, que sigue en el hilo de E/S de AsyncClient al llegar la respuesta.
+    // Con un servidor que solo habla texto (o tipos sin formato binario) se resuelven en el momento.
+    future<T> getAsync() const;
+    future<bool> setAsync(const T& val) const;
+    RemoteAwaitable<T> getAwaitable() const;
+    RemoteAwaitable<bool> setAwaitable(const T& val) const;
+
     // Retorna true si no apunta a ningn bloque (blockID == -1)
     bool isNull() const { return blockID < 0; }
 
@@ -80,7 +131,17 @@ public:
     // Crea un nuevo bloque remoto y retorna un MPointer para ese bloque
     static MPointer<T> New();
 
+    // New sin esperar al servidor (future o co_await); MPointer nulo si fall
+    static future<MPointer<T>> NewAsync();
+    static RemoteAwaitable<MPointer<T>> NewAwaitable();
+
 private:
+    // MPointerBatch y MPointerTransaction arman sus mensajes con los helpers privados
+    friend class MPointerBatch;
+    friend class MPointerTransaction;
+    // MPointer<T[]> usa el nombre de tipo de sus elementos
+    template <typename U> friend class MPointer;
+
     int blockID; // Identificador del bloque en el servidor Memory Manager
 
     // Enva un comando al servidor y retorna la respuesta en forma de string
@@ -89,23 +150,42 @@ private:
     // Funcin auxiliar para mapear el tipo T a un string (para el comando "create <size> <type>")
     static string typeName();
 
+    // Tipos que viajan por el protocolo binario (el resto usa los comandos de texto)
+    static constexpr bool binaryEncodable =
+        is_same_v<T, int> || is_same_v<T, long> || is_same_v<T, float> || is_same_v<T, double> ||
+        is_same_v<T, bool> || is_same_v<T, char> || is_same_v<T, unsigned char> || is_same_v<T, string>;
+
+    // Codifican/decodifican T en el formato binario del protocolo (little-endian, ancho fijo)
+    static void encodeValue(const T& val, string& out);
+    static bool decodeValue(const string& in, T& out);
+
+    // Enva un mensaje binario sin payload (get)
+    static bool sendBinary(uint8_t opcode, int id, protocol::Message& msg);
+
+    // Tipos que admiten las operaciones atmicas del servidor
+    static constexpr bool atomicCapable =
+        is_same_v<T, int> || is_same_v<T, long> || is_same_v<T, float> || is_same_v<T, double> || is_same_v<T, bool>;
+
+    // Enva una operacin atmica (protocolo binario o comando de texto) y retorna el valor
+    // anterior; 'expected' solo en compare_exchange
+    T atomicOp(uint8_t opcode, const T& operand, const T* expected, bool& swapped);
+
     // Mtodos helper para asignar y obtener el valor remoto:
     void setValue(const T& val) const;
     T getValue() const;
 
-    // Mtodos para incrementar o decrementar el contador de referencias en el servidor
+    // Mensajes y decodificadores que comparten las versiones con future y con co_await
+    protocol::Message getMessage() const;
+    protocol::Message setMessage(const T& val) const;
+    static protocol::Message newMessage();
+    static T decodeGet(protocol::Message& reply);
+    static MPointer<T> decodeNew(protocol::Message& reply);
+
+    // Mtodos para incrementar o decrementar el contador de referencias (va RefDeltaTable)
     static void increaseRef(int id);
     static void decreaseRef(int id);
-
-    // Variables estticas para la conexin con el servidor Memory Manager
-    static string serverIP;
-    static int serverPort;
 };
 
-// Definicin de las variables estticas
-template <typename T> string MPointer<T>::serverIP = "127.0.0.1";
-template <typename T> int MPointer<T>::serverPort = 8080;
-
 // ----------------------------------------------------------------------
 // Implementacin de MPointer (en el header, al ser template)
 // ----------------------------------------------------------------------
@@ -134,6 +214,24 @@ MPointer<T>& MPointer<T>::operator=(const MPointer<T>& other) {
     return *this;
 }
 
+// Constructor de movimiento
+template <typename T>
+MPointer<T>::MPointer(MPointer<T>&& other) noexcept : blockID(other.blockID) {
+    other.blockID = -1;
+}
+
+// Asignacin por movimiento
+template <typename T>
+MPointer<T>& MPointer<T>::operator=(MPointer<T>&& other) noexcept {
+    if (this != addressof(other)) {
+        if (blockID >= 0)
+            decreaseRef(blockID);
+        blockID = other.blockID;
+        other.blockID = -1;
+    }
+    return *this;
+}
+
 // Operador de asignacin desde un valor T
 template <typename T>
 MPointer<T>& MPointer<T>::operator=(const T& val) {
@@ -151,17 +249,109 @@ MPointer<T>::~MPointer() {
     }
 }
 
+// reset: suelta el bloque actual
+template <typename T>
+void MPointer<T>::reset() {
+    if (blockID >= 0) {
+        decreaseRef(blockID);
+        blockID = -1;
+    }
+}
+
+// swap libre para que std::swap y los algoritmos usen el intercambio sin mensajes
+template <typename T>
+void swap(MPointer<T>& a, MPointer<T>& b) noexcept {
+    a.swap(b);
+}
+
 // getID: devuelve el blockID
 template <typename T>
 int MPointer<T>::getID() const {
     return blockID;
 }
 
+// fetch_add, exchange y compare_exchange: ver atomicOp
+template <typename T>
+T MPointer<T>::fetch_add(const T& delta) {
+    static_assert(atomicCapable && !is_same_v<T, bool>, "fetch_add admite int, long, float y double");
+    bool swapped;
+    return atomicOp(protocol::OP_ATOMIC_ADD, delta, nullptr, swapped);
+}
+
+template <typename T>
+T MPointer<T>::exchange(const T& desired) {
+    static_assert(atomicCapable, "exchange admite int, long, float, double y bool");
+    bool swapped;
+    return atomicOp(protocol::OP_ATOMIC_XCHG, desired, nullptr, swapped);
+}
+
+template <typename T>
+bool MPointer<T>::compare_exchange(T& expected, const T& desired) {
+    static_assert(atomicCapable, "compare_exchange admite int, long, float, double y bool");
+    bool swapped = false;
+    expected = atomicOp(protocol::OP_ATOMIC_CAS, desired, &expected, swapped);
+    return swapped;
+}
+
+// atomicOp: "add <id> <delta>", "cas <id> <esperado> <nuevo>" o "xchg <id> <valor>" (o sus
+// opcodes); la respuesta trae el valor anterior
+template <typename T>
+T MPointer<T>::atomicOp(uint8_t opcode, const T& operand, const T* expected, bool& swapped) {
+    T previous{};
+    swapped = false;
+    if (blockID < 0) return previous;
+
+    if (ConnectionPool::getInstance().supportsBinary()) {
+        protocol::Message msg;
+        msg.header.opcode = opcode;
+        msg.header.blockId = blockID;
+        string value;
+        if (expected) {
+            encodeValue(*expected, value);
+            msg.payload.resize(4);
+            protocol::putU32(&msg.payload[0], static_cast<uint32_t>(value.size()));
+            msg.payload += value;
+        }
+        encodeValue(operand, value);
+        msg.payload += value;
+        if (ConnectionPool::getInstance().call(msg) && msg.header.status == protocol::STATUS_OK) {
+            if (opcode == protocol::OP_ATOMIC_CAS && !msg.payload.empty()) {
+                swapped = msg.payload[0] != 0;
+                msg.payload.erase(0, 1);
+            }
+            decodeValue(msg.payload, previous);
+        }
+        ReadCache::getInstance().invalidate(blockID);
+        return previous;
+    }
+
+    // Texto: los nmeros viajan con todos sus dgitos para que cas compare el valor exacto
+    ostringstream oss;
+    oss << setprecision(numeric_limits<T>::max_digits10);
+    oss << (opcode == protocol::OP_ATOMIC_ADD ? "add " : opcode == protocol::OP_ATOMIC_CAS ? "cas " : "xchg ") << blockID;
+    if (expected) oss << " " << *expected;
+    oss << " " << operand;
+    string resp = sendRequest(oss.str());
+    size_t pos = resp.find(": ");
+    if (resp.rfind("Valor anterior", 0) != 0 || pos == string::npos) return previous;
+    istringstream iss(resp.substr(pos + 2));
+    string valStr;
+    iss >> valStr;
+    if constexpr (is_same_v<T, bool>) {
+        previous = (valStr == "true" || valStr == "1");
+    }
+    else {
+        istringstream(valStr) >> previous;
+    }
+    swapped = resp.find("(intercambiado)") != string::npos;
+    return previous;
+}
+
 // Init: configura la direccin IP y el puerto del Memory Manager
+// (el pool de conexiones es compartido por todos los MPointer<T>)
 template <typename T>
 void MPointer<T>::Init(const string& ip, int port) {
-    serverIP = ip;
-    serverPort = port;
+    ConnectionPool::getInstance().configure(ip, port);
 }
 
 // New: crea un nuevo bloque remoto y retorna un MPointer para ese bloque
@@ -170,6 +360,15 @@ MPointer<T> MPointer<T>::New() {
     size_t sizeBytes = sizeof(T);
     string tname = typeName();
 
+    if (ConnectionPool::getInstance().supportsBinary()) {
+        protocol::Message msg = newMessage();
+        MPointer<T> mp;
+        if (ConnectionPool::getInstance().call(msg) && msg.header.status == protocol::STATUS_OK)
+            mp.blockID = msg.header.blockId;
+        RefDeltaTable::getInstance().track(mp.blockID);
+        return mp;
+    }
+
     ostringstream oss;
     oss << "create " << sizeBytes << " " << tname;
     string resp = sendRequest(oss.str());
@@ -181,6 +380,7 @@ MPointer<T> MPointer<T>::New() {
     }
     MPointer<T> mp;
     mp.blockID = newID;
+    RefDeltaTable::getInstance().track(mp.blockID);
     return mp;
 }
 
@@ -188,6 +388,17 @@ MPointer<T> MPointer<T>::New() {
 // Se asume que el servidor tiene ramas especficas, por ejemplo, para "char" se copia un solo byte.
 template <typename T>
 void MPointer<T>::setValue(const T& val) const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary()) {
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_SET;
+            msg.header.blockId = blockID;
+            encodeValue(val, msg.payload);
+            ConnectionPool::getInstance().call(msg);
+            ReadCache::getInstance().invalidate(blockID);
+            return;
+        }
+    }
     ostringstream oss;
     oss << "set " << blockID << " " << val;
     sendRequest(oss.str());
@@ -196,6 +407,34 @@ void MPointer<T>::setValue(const T& val) const {
 // getValue: enva "get <blockID>" y procesa la respuesta
 template <typename T>
 T MPointer<T>::getValue() const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary()) {
+            protocol::Message msg;
+            T result{};
+            ReadCache& cache = ReadCache::getInstance();
+            if (uint32_t subscriber = cache.subscriber()) {
+                // Con cach: se usa el valor si su lease sigue vigente, si no se pide con lease
+                if (cache.lookup(blockID, msg.payload) && decodeValue(msg.payload, result))
+                    return result;
+                uint64_t epoch = cache.epoch();
+                auto requested = chrono::steady_clock::now();
+                msg.header.opcode = protocol::OP_GET_LEASE;
+                msg.header.blockId = blockID;
+                msg.payload.resize(4);
+                protocol::putU32(&msg.payload[0], subscriber);
+                if (ConnectionPool::getInstance().call(msg) && msg.header.status == protocol::STATUS_OK
+                    && msg.payload.size() >= 4) {
+                    string value = msg.payload.substr(4);
+                    cache.store(blockID, value, protocol::getU32(msg.payload.data()), requested, epoch);
+                    decodeValue(value, result);
+                }
+                return result;
+            }
+            if (sendBinary(protocol::OP_GET, blockID, msg) && msg.header.status == protocol::STATUS_OK)
+                decodeValue(msg.payload, result);
+            return result;
+        }
+    }
     ostringstream oss;
     oss << "get " << blockID;
     string resp = sendRequest(oss.str());
@@ -235,22 +474,146 @@ T MPointer<T>::getValue() const {
     return T();
 }
 
-// increaseRef: enva "increase <id>" al servidor
+// getAsync: OP_GET por AsyncClient (un acierto de ReadCache se resuelve sin viajar)
+template <typename T>
+future<T> MPointer<T>::getAsync() const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary()) {
+            string cached;
+            T result{};
+            ReadCache& cache = ReadCache::getInstance();
+            if (!(cache.subscriber() && cache.lookup(blockID, cached) && decodeValue(cached, result))) {
+                protocol::Message msg = getMessage();
+                return AsyncClient::getInstance().request<T>(msg, decodeGet);
+            }
+            promise<T> ready;
+            ready.set_value(result);
+            return ready.get_future();
+        }
+    }
+    promise<T> ready;
+    ready.set_value(getValue());
+    return ready.get_future();
+}
+
+// setAsync: OP_SET por AsyncClient; true si el servidor lo acept
+template <typename T>
+future<bool> MPointer<T>::setAsync(const T& val) const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary()) {
+            protocol::Message msg = setMessage(val);
+            int id = blockID;
+            return AsyncClient::getInstance().request<bool>(msg, [id](protocol::Message& reply) {
+                ReadCache::getInstance().invalidate(id);
+                return reply.header.status == protocol::STATUS_OK;
+            });
+        }
+    }
+    setValue(val);
+    promise<bool> ready;
+    ready.set_value(true);
+    return ready.get_future();
+}
+
+template <typename T>
+RemoteAwaitable<T> MPointer<T>::getAwaitable() const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary())
+            return RemoteAwaitable<T>(getMessage(), decodeGet);
+    }
+    return RemoteAwaitable<T>(getValue());
+}
+
+template <typename T>
+RemoteAwaitable<bool> MPointer<T>::setAwaitable(const T& val) const {
+    if constexpr (binaryEncodable) {
+        if (ConnectionPool::getInstance().supportsBinary()) {
+            int id = blockID;
+            return RemoteAwaitable<bool>(setMessage(val), [id](protocol::Message& reply) {
+                ReadCache::getInstance().invalidate(id);
+                return reply.header.status == protocol::STATUS_OK;
+            });
+        }
+    }
+    setValue(val);
+    return RemoteAwaitable<bool>(true);
+}
+
+// NewAsync: OP_CREATE por AsyncClient; el bloque se registra en RefDeltaTable al llegar su ID
+template <typename T>
+future<MPointer<T>> MPointer<T>::NewAsync() {
+    if (ConnectionPool::getInstance().supportsBinary()) {
+        protocol::Message msg = newMessage();
+        return AsyncClient::getInstance().request<MPointer<T>>(msg, decodeNew);
+    }
+    promise<MPointer<T>> ready;
+    ready.set_value(New());
+    return ready.get_future();
+}
+
+template <typename T>
+RemoteAwaitable<MPointer<T>> MPointer<T>::NewAwaitable() {
+    if (ConnectionPool::getInstance().supportsBinary())
+        return RemoteAwaitable<MPointer<T>>(newMessage(), decodeNew);
+    return RemoteAwaitable<MPointer<T>>(New());
+}
+
+template <typename T>
+protocol::Message MPointer<T>::getMessage() const {
+    protocol::Message msg;
+    msg.header.opcode = protocol::OP_GET;
+    msg.header.blockId = blockID;
+    return msg;
+}
+
+template <typename T>
+protocol::Message MPointer<T>::setMessage(const T& val) const {
+    protocol::Message msg;
+    msg.header.opcode = protocol::OP_SET;
+    msg.header.blockId = blockID;
+    encodeValue(val, msg.payload);
+    return msg;
+}
+
+template <typename T>
+protocol::Message MPointer<T>::newMessage() {
+    protocol::Message msg;
+    msg.header.opcode = protocol::OP_CREATE;
+    msg.payload.resize(4);
+    protocol::putU32(&msg.payload[0], static_cast<uint32_t>(sizeof(T)));
+    msg.payload += typeName();
+    return msg;
+}
+
+template <typename T>
+T MPointer<T>::decodeGet(protocol::Message& reply) {
+    T result{};
+    if (reply.header.status == protocol::STATUS_OK) decodeValue(reply.payload, result);
+    return result;
+}
+
+template <typename T>
+MPointer<T> MPointer<T>::decodeNew(protocol::Message& reply) {
+    MPointer<T> mp;
+    if (reply.header.status == protocol::STATUS_OK) mp.blockID = reply.header.blockId;
+    RefDeltaTable::getInstance().track(mp.blockID);
+    return mp;
+}
+
+// increaseRef: suma una referencia (RefDeltaTable la enva acumulada)
 template <typename T>
 void MPointer<T>::increaseRef(int id) {
     if (id < 0) return;
-    ostringstream oss;
-    oss << "increase " << id;
-    sendRequest(oss.str());
+    MPointerStats::increases++;
+    RefDeltaTable::getInstance().increase(id);
 }
 
-// decreaseRef: enva "decrease <id>" al servidor
+// decreaseRef: resta una referencia (si el bloque se queda sin MPointers se avisa de inmediato)
 template <typename T>
 void MPointer<T>::decreaseRef(int id) {
     if (id < 0) return;
-    ostringstream oss;
-    oss << "decrease " << id;
-    sendRequest(oss.str());
+    MPointerStats::decreases++;
+    RefDeltaTable::getInstance().decrease(id);
 }
 
 // typeName: mapea el tipo T a un string para el comando "create"
@@ -268,35 +631,272 @@ string MPointer<T>::typeName() {
     return "raw";
 }
 
-// sendRequest: se conecta al servidor, enva el comando y retorna la respuesta
+// sendBinary: enva un mensaje binario sin payload; false si el servidor solo habla texto
+template <typename T>
+bool MPointer<T>::sendBinary(uint8_t opcode, int id, protocol::Message& msg) {
+    if (!ConnectionPool::getInstance().supportsBinary()) return false;
+    msg.header.opcode = opcode;
+    msg.header.blockId = id;
+    msg.payload.clear();
+    return ConnectionPool::getInstance().call(msg);
+}
+
+// encodeValue: codifica T con el ancho fijo del protocolo binario
+template <typename T>
+void MPointer<T>::encodeValue(const T& val, string& out) {
+    if constexpr (is_same_v<T, string>) {
+        out = val;
+    }
+    else if constexpr (is_same_v<T, long>) {
+        out.resize(8);
+        protocol::putU64(&out[0], static_cast<uint64_t>(static_cast<int64_t>(val)));
+    }
+    else if constexpr (is_same_v<T, double>) {
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        out.resize(8);
+        protocol::putU64(&out[0], bits);
+    }
+    else if constexpr (is_same_v<T, float>) {
+        uint32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        out.resize(4);
+        protocol::putU32(&out[0], bits);
+    }
+    else if constexpr (is_same_v<T, int>) {
+        out.resize(4);
+        protocol::putU32(&out[0], static_cast<uint32_t>(val));
+    }
+    else if constexpr (is_same_v<T, bool>) {
+        out.assign(1, val ? '\1' : '\0');
+    }
+    else {
+        // char y unsigned char: un byte
+        out.assign(1, static_cast<char>(val));
+    }
+}
+
+// decodeValue: inverso de encodeValue; false si el tamao no corresponde al tipo
+template <typename T>
+bool MPointer<T>::decodeValue(const string& in, T& out) {
+    if constexpr (is_same_v<T, string>) {
+        out = in;
+    }
+    else if constexpr (is_same_v<T, long>) {
+        if (in.size() != 8) return false;
+        out = static_cast<long>(static_cast<int64_t>(protocol::getU64(in.data())));
+    }
+    else if constexpr (is_same_v<T, double>) {
+        if (in.size() != 8) return false;
+        uint64_t bits = protocol::getU64(in.data());
+        memcpy(&out, &bits, sizeof(bits));
+    }
+    else if constexpr (is_same_v<T, float>) {
+        if (in.size() != 4) return false;
+        uint32_t bits = protocol::getU32(in.data());
+        memcpy(&out, &bits, sizeof(bits));
+    }
+    else if constexpr (is_same_v<T, int>) {
+        if (in.size() != 4) return false;
+        out = static_cast<int>(protocol::getU32(in.data()));
+    }
+    else if constexpr (is_same_v<T, bool>) {
+        if (in.size() != 1) return false;
+        out = in[0] != 0;
+    }
+    else {
+        if (in.empty()) return false;
+        out = static_cast<T>(in[0]);
+    }
+    return true;
+}
+
+// sendRequest: enva el comando por una conexin persistente del pool y retorna la respuesta
 template <typename T>
 string MPointer<T>::sendRequest(const string& command) {
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == INVALID_SOCKET) {
-        return "Error: socket()";
+    return ConnectionPool::getInstance().request(command);
+}
+
+/*
+  MPointer<T[]>: arreglo remoto de 'count' elementos contiguos en un nico bloque del servidor.
+
+  Un solo create reserva count * sizeof(T) bytes y un solo ID (y una sola entrada en la tabla de
+  bloques) cubre todo el arreglo. read()/write() mueven un rango de elementos como bytes crudos
+  en un mensaje (o en pocos, si el rango supera el tamao mximo de un frame); p[i] lee o
+  escribe un elemento.
+
+  Admite int, double, float, bool, char y unsigned char. Los bytes viajan tal cual, as que
+  cliente y servidor deben ser little-endian (x86/x64, igual que el resto del protocolo binario).
+  Requiere el protocolo binario: con un servidor que solo habla texto las operaciones fallan.
+  Copiar, mover y destruir ajustan el refCount igual que en MPointer<T>.
+*/
+template <typename T>
+class MPointer<T[]> {
+    static_assert(is_same_v<T, int> || is_same_v<T, double> || is_same_v<T, float> || is_same_v<T, bool>
+        || is_same_v<T, char> || is_same_v<T, unsigned char>,
+        "MPointer<T[]> admite int, double, float, bool, char y unsigned char");
+
+public:
+    MPointer() : blockID(-1), count_(0) {}
+
+    MPointer(const MPointer<T[]>& other) : blockID(other.blockID), count_(other.count_) {
+        increaseRef(blockID);
+    }
+
+    MPointer(MPointer<T[]>&& other) noexcept : blockID(other.blockID), count_(other.count_) {
+        other.blockID = -1;
+        other.count_ = 0;
+    }
+
+    MPointer<T[]>& operator=(const MPointer<T[]>& other) {
+        if (this != addressof(other)) {
+            decreaseRef(blockID);
+            blockID = other.blockID;
+            count_ = other.count_;
+            increaseRef(blockID);
+        }
+        return *this;
+    }
+
+    MPointer<T[]>& operator=(MPointer<T[]>&& other) noexcept {
+        if (this != addressof(other)) {
+            decreaseRef(blockID);
+            blockID = other.blockID;
+            count_ = other.count_;
+            other.blockID = -1;
+            other.count_ = 0;
+        }
+        return *this;
+    }
+
+    ~MPointer() { reset(); }
+
+    // Elemento remoto: se convierte a T (lee) o se le asigna un T (escribe)
+    class ElementProxy {
+    public:
+        ElementProxy(const MPointer<T[]>& mp, size_t index) : mp(mp), index(index) {}
+        operator T() const {
+            T val{};
+            mp.read(index, 1, &val);
+            return val;
+        }
+        ElementProxy& operator=(const T& val) {
+            mp.write(index, 1, &val);
+            return *this;
+        }
+    private:
+        const MPointer<T[]>& mp;
+        size_t index;
+    };
+
+    ElementProxy operator[](size_t index) const { return ElementProxy(*this, index); }
+
+    // Lee los elementos [begin, begin + n) en 'out'; false si el rango se sale del arreglo
+    bool read(size_t begin, size_t n, T* out) const {
+        if (isNull() || begin > count_ || n > count_ - begin) return false;
+        while (n > 0) {
+            size_t chunk = min(n, kMaxChunkElems);
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_READ_RANGE;
+            msg.header.blockId = blockID;
+            msg.payload.resize(8);
+            protocol::putU32(&msg.payload[0], static_cast<uint32_t>(begin));
+            protocol::putU32(&msg.payload[4], static_cast<uint32_t>(chunk));
+            if (!ConnectionPool::getInstance().call(msg) || msg.header.status != protocol::STATUS_OK
+                || msg.payload.size() != chunk * sizeof(T))
+                return false;
+            memcpy(out, msg.payload.data(), msg.payload.size());
+            out += chunk;
+            begin += chunk;
+            n -= chunk;
+        }
+        return true;
+    }
+
+    // Escribe 'n' elementos de 'in' a partir de 'begin'; false si el rango se sale del arreglo
+    bool write(size_t begin, size_t n, const T* in) const {
+        if (isNull() || begin > count_ || n > count_ - begin) return false;
+        while (n > 0) {
+            size_t chunk = min(n, kMaxChunkElems);
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_WRITE_RANGE;
+            msg.header.blockId = blockID;
+            msg.payload.resize(4 + chunk * sizeof(T));
+            protocol::putU32(&msg.payload[0], static_cast<uint32_t>(begin));
+            memcpy(&msg.payload[4], in, chunk * sizeof(T));
+            if (!ConnectionPool::getInstance().call(msg) || msg.header.status != protocol::STATUS_OK)
+                return false;
+            ReadCache::getInstance().invalidate(blockID);
+            in += chunk;
+            begin += chunk;
+            n -= chunk;
+        }
+        return true;
+    }
+
+    // Cantidad de elementos
+    size_t size() const { return count_; }
+
+    int getID() const { return blockID; }
+    int operator&() const { return blockID; }
+    bool isNull() const { return blockID < 0; }
+
+    void swap(MPointer<T[]>& other) noexcept {
+        std::swap(blockID, other.blockID);
+        std::swap(count_, other.count_);
+    }
+
+    // Suelta el arreglo (decrease) y queda nulo
+    void reset() {
+        decreaseRef(blockID);
+        blockID = -1;
+        count_ = 0;
+    }
+
+    static void Init(const string& ip, int port) {
+        ConnectionPool::getInstance().configure(ip, port);
+    }
+
+    // Crea un arreglo remoto de 'count' elementos (un solo bloque de count * sizeof(T) bytes)
+    static MPointer<T[]> New(size_t count) {
+        MPointer<T[]> mp;
+        if (count == 0 || count > UINT32_MAX / sizeof(T)) return mp;
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_CREATE_ARRAY;
+        msg.payload.resize(4);
+        protocol::putU32(&msg.payload[0], static_cast<uint32_t>(count));
+        msg.payload += MPointer<T>::typeName();
+        if (ConnectionPool::getInstance().call(msg) && msg.header.status == protocol::STATUS_OK) {
+            mp.blockID = msg.header.blockId;
+            mp.count_ = count;
+            RefDeltaTable::getInstance().track(mp.blockID);
+        }
+        return mp;
     }
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(serverPort);
-    inet_pton(AF_INET, serverIP.c_str(), &serverAddr.sin_addr);
 
-    if (connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        closesocket(sock);
-        return "Error: connect()";
+private:
+    // Elementos por mensaje, para no pasar del tamao mximo de un frame
+    static constexpr size_t kMaxChunkElems = (protocol::kMaxFrameSize - 64) / sizeof(T);
+
+    static void increaseRef(int id) {
+        if (id < 0) return;
+        MPointerStats::increases++;
+        RefDeltaTable::getInstance().increase(id);
     }
-    send(sock, command.c_str(), static_cast<int>(command.size()), 0);
 
-    char buffer[1024];
-    int bytesReceived = recv(sock, buffer, 1023, 0);
-    if (bytesReceived <= 0) {
-        closesocket(sock);
-        return "Error: recv()";
+    static void decreaseRef(int id) {
+        if (id < 0) return;
+        MPointerStats::decreases++;
+        RefDeltaTable::getInstance().decrease(id);
     }
-    buffer[bytesReceived] = '\0';
-    string response(buffer);
 
-    closesocket(sock);
-    return response;
+    int blockID;
+    size_t count_;
+};
+
+template <typename T>
+void swap(MPointer<T[]>& a, MPointer<T[]>& b) noexcept {
+    a.swap(b);
 }
 
 #endif // MPOINTER_H
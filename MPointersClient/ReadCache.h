@@ -0,0 +1,183 @@
+#ifndef READ_CACHE_H
+#define READ_CACHE_H
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include "ConnectionPool.h"
+
+using namespace std;
+
+/*
+  ReadCache: caché opcional de lecturas de MPointers, por blockID, con leases del servidor.
+
+  Al activarlo (enable()) se abre una conexión de suscripción propia (OP_SUBSCRIBE) y un hilo
+  que escucha en ella los avisos del servidor. Desde entonces MPointer<T>::getValue pide las
+  lecturas con lease (OP_GET_LEASE): el servidor entrega el valor y un plazo durante el cual el
+  cliente puede reutilizarlo sin preguntar. Si otro cliente escribe el bloque antes de que venza,
+  el servidor empuja un OP_INVALIDATE; el hilo lo saca del caché y lo confirma devolviéndolo, y
+  recién entonces (o al vencer el lease) el servidor le responde al que escribió.
+
+  Coherencia:
+    - Un valor cacheado nunca se usa después de su lease (el plazo se cuenta desde que se envió
+      la petición, no desde que llegó la respuesta).
+    - Una lectura cuya respuesta llega después de un aviso no se guarda (epoch): así un aviso
+      que se adelanta a la respuesta no deja un valor viejo en el caché.
+    - Las escrituras propias borran la entrada de inmediato.
+    - Si se pierde la conexión de suscripción, el caché se vacía y se desactiva; al cerrarla
+      a propósito se vacía antes, porque el servidor da por confirmados los avisos de una
+      suscripción cerrada.
+  Una escritura de otro cliente se ve en cuanto llega su aviso (el tiempo de un mensaje).
+
+  Solo cachea los tipos del protocolo binario; sin servidor binario enable() retorna false.
+*/
+class ReadCache {
+public:
+    static ReadCache& getInstance() {
+        static ReadCache instance;
+        return instance;
+    }
+
+    // Abre la suscripción con el servidor configurado en ConnectionPool; true si quedó activo
+    bool enable() {
+        lock_guard<mutex> control(controlMtx_);
+        if (subscriber_.load(memory_order_acquire) != 0) return true;
+        stopListener();
+
+        SOCKET sock = ConnectionPool::getInstance().openDedicated();
+        if (sock == INVALID_SOCKET) return false;
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_SUBSCRIBE;
+        if (!protocol::sendMessage(sock, msg) || !protocol::recvMessage(sock, msg)
+            || msg.header.status != protocol::STATUS_OK || msg.payload.size() < 4) {
+            closesocket(sock);
+            return false;
+        }
+        sock_ = sock;
+        subscriber_.store(protocol::getU32(msg.payload.data()), memory_order_release);
+        listener_ = thread(&ReadCache::listen, this);
+        return true;
+    }
+
+    // Cierra la suscripción y vacía el caché
+    void disable() {
+        lock_guard<mutex> control(controlMtx_);
+        stopListener();
+    }
+
+    // Número de suscriptor para pedir leases; 0 si el caché no está activo
+    uint32_t subscriber() const { return subscriber_.load(memory_order_acquire); }
+
+    // Valor codificado del bloque si tiene un lease vigente
+    bool lookup(int id, string& value) {
+        lock_guard<mutex> lock(mtx_);
+        auto it = entries_.find(id);
+        if (it == entries_.end() || chrono::steady_clock::now() >= it->second.expiry) {
+            if (it != entries_.end()) entries_.erase(it);
+            misses_.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        value = it->second.value;
+        hits_.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Se toma antes de pedir un lease y se pasa a store()
+    uint64_t epoch() {
+        lock_guard<mutex> lock(mtx_);
+        return epoch_;
+    }
+
+    // Guarda el valor recibido con su lease, salvo que haya llegado algún aviso desde 'epoch'
+    void store(int id, const string& value, uint32_t leaseMs, chrono::steady_clock::time_point requested,
+        uint64_t epoch) {
+        if (leaseMs == 0) return;
+        lock_guard<mutex> lock(mtx_);
+        if (epoch != epoch_ || subscriber_.load(memory_order_relaxed) == 0) return;
+        if (entries_.size() >= kMaxEntries && entries_.find(id) == entries_.end()) entries_.clear();
+        Entry& entry = entries_[id];
+        entry.value = value;
+        entry.expiry = requested + chrono::milliseconds(leaseMs);
+    }
+
+    // Descarta el valor cacheado (escritura propia)
+    void invalidate(int id) {
+        lock_guard<mutex> lock(mtx_);
+        entries_.erase(id);
+        epoch_++;
+    }
+
+    unsigned long long hits() const { return hits_.load(memory_order_relaxed); }
+    unsigned long long misses() const { return misses_.load(memory_order_relaxed); }
+    unsigned long long invalidations() const { return invalidations_.load(memory_order_relaxed); }
+
+    ~ReadCache() {
+        disable();
+    }
+
+private:
+    ReadCache() : sock_(INVALID_SOCKET), subscriber_(0), epoch_(0), hits_(0), misses_(0), invalidations_(0) {}
+    ReadCache(const ReadCache&) = delete;
+    ReadCache& operator=(const ReadCache&) = delete;
+
+    // Máximo de bloques cacheados; al llenarse se vacía entero
+    static constexpr size_t kMaxEntries = 4096;
+
+    struct Entry {
+        string value;
+        chrono::steady_clock::time_point expiry;
+    };
+
+    // Hilo que recibe los avisos del servidor
+    void listen() {
+        protocol::Message msg;
+        while (protocol::recvMessage(sock_, msg)) {
+            if (msg.header.opcode != protocol::OP_INVALIDATE) continue;
+            invalidations_.fetch_add(1, memory_order_relaxed);
+            invalidate(msg.header.blockId);
+            // La escritura de otro cliente espera esta confirmación
+            msg.payload.clear();
+            if (!protocol::sendMessage(sock_, msg)) break;
+        }
+        // Sin canal de avisos ya no se puede confiar en lo cacheado
+        lock_guard<mutex> lock(mtx_);
+        subscriber_.store(0, memory_order_release);
+        entries_.clear();
+        epoch_++;
+    }
+
+    // Vacía el caché, corta la suscripción y espera al hilo (con controlMtx_ tomado)
+    void stopListener() {
+        {
+            lock_guard<mutex> lock(mtx_);
+            subscriber_.store(0, memory_order_release);
+            entries_.clear();
+            epoch_++;
+        }
+        if (listener_.joinable()) {
+            net::shutdownBoth(sock_);
+            listener_.join();
+        }
+        if (sock_ != INVALID_SOCKET) {
+            closesocket(sock_);
+            sock_ = INVALID_SOCKET;
+        }
+    }
+
+    mutex controlMtx_;
+    mutex mtx_;
+    SOCKET sock_;
+    thread listener_;
+    atomic<uint32_t> subscriber_;
+    unordered_map<int, Entry> entries_;
+    // Se incrementa con cada aviso o escritura propia
+    uint64_t epoch_;
+    atomic<unsigned long long> hits_;
+    atomic<unsigned long long> misses_;
+    atomic<unsigned long long> invalidations_;
+};
+
+#endif // READ_CACHE_H
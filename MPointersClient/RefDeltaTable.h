@@ -0,0 +1,201 @@
+#ifndef REF_DELTA_TABLE_H
+#define REF_DELTA_TABLE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include "ConnectionPool.h"
+
+using namespace std;
+
+/*
+  RefDeltaTable acumula los cambios de refCount de los MPointers del proceso y los envía
+  al servidor como cambios netos en un solo mensaje "refdelta <id> <+n|-n> ...".
+
+  Por cada bloque se lleva:
+    - 'local': cuántos MPointers del proceso apuntan al bloque (1 al crearlo, +1 por copia,
+      -1 por destrucción), y
+    - 'pending': el cambio neto que el servidor todavía no conoce.
+  Una copia seguida de una destrucción se cancela sin salir del proceso.
+
+  Mientras 'local' sea mayor que 0 el refCount del servidor nunca llega a 0 por culpa de los
+  cambios atrasados (solo le faltan incrementos o le sobran decrementos ya acumulados), así que
+  atrasarlos es seguro. Cuando 'local' llega a 0 se envía todo lo pendiente de inmediato, para
+  que el servidor libere el bloque sin demora.
+
+  Lo pendiente también se envía al acumular maxPending bloques distintos o cuando el cambio más
+  viejo supera maxDelay (se revisa en cada operación; flush() lo envía a mano).
+  configure(0, ...) desactiva el acumulado: cada cambio se envía solo.
+
+  Los bloques que la tabla no conoce (no creados con MPointer<T>::New ni con MPointerBatch)
+  se envían de inmediato.
+*/
+class RefDeltaTable {
+public:
+    static RefDeltaTable& getInstance() {
+        static RefDeltaTable instance;
+        return instance;
+    }
+
+    // Límites del acumulado: bloques distintos pendientes y antigüedad del cambio más viejo
+    void configure(size_t maxPending, chrono::milliseconds maxDelay) {
+        lock_guard<mutex> lock(mtx_);
+        maxPending_ = maxPending;
+        maxDelay_ = maxDelay;
+    }
+
+    // Registra un bloque recién creado (el servidor ya le dio refCount 1)
+    void track(int id) {
+        if (id < 0) return;
+        lock_guard<mutex> lock(mtx_);
+        Entry& entry = entries_[id];
+        entry.local = 1;
+        entry.pending = 0;
+    }
+
+    // Un MPointer más apunta al bloque
+    void increase(int id) { change(id, +1); }
+
+    // Un MPointer dejó de apuntar al bloque
+    void decrease(int id) { change(id, -1); }
+
+    // Envía todos los cambios pendientes en un mensaje
+    void flush() {
+        // flushMtx_ mantiene el orden de los mensajes: un refdelta posterior (por ejemplo, el que
+        // libera un bloque) no puede adelantarse a uno anterior que todavía no se envió
+        lock_guard<mutex> flushLock(flushMtx_);
+        vector<pair<int, int>> deltas;
+        {
+            lock_guard<mutex> lock(mtx_);
+            takePendingLocked(deltas);
+        }
+        send(deltas);
+    }
+
+    // Mensajes refdelta enviados
+    unsigned long long messagesSent() const { return messages_.load(memory_order_relaxed); }
+
+    // Bloques con cambios sin enviar
+    size_t pendingCount() {
+        lock_guard<mutex> lock(mtx_);
+        return dirty_.size();
+    }
+
+private:
+    RefDeltaTable() : maxPending_(kDefaultMaxPending), maxDelay_(kDefaultMaxDelay), messages_(0) {}
+    RefDeltaTable(const RefDeltaTable&) = delete;
+    RefDeltaTable& operator=(const RefDeltaTable&) = delete;
+
+    static constexpr size_t kDefaultMaxPending = 1024;
+    static constexpr chrono::milliseconds kDefaultMaxDelay{ 50 };
+
+    struct Entry {
+        long long local = 0;
+        long long pending = 0;
+        bool dirty = false;     // está en dirty_
+    };
+
+    void change(int id, int step) {
+        if (id < 0) return;
+        bool sendNow = false;
+        bool flushNow = false;
+        {
+            lock_guard<mutex> lock(mtx_);
+            auto it = entries_.find(id);
+            if (it == entries_.end() || maxPending_ == 0) {
+                // Bloque desconocido o acumulado desactivado: el cambio se envía ya
+                sendNow = true;
+                if (it != entries_.end()) {
+                    it->second.local += step;
+                    if (it->second.local <= 0 && !it->second.dirty) entries_.erase(it);
+                }
+            }
+            else {
+                Entry& entry = it->second;
+                entry.local += step;
+                entry.pending += step;
+                if (!entry.dirty) {
+                    entry.dirty = true;
+                    if (dirty_.empty()) oldest_ = chrono::steady_clock::now();
+                    dirty_.push_back(id);
+                }
+                flushNow = entry.local <= 0 || dirty_.size() >= maxPending_
+                    || chrono::steady_clock::now() - oldest_ >= maxDelay_;
+            }
+        }
+        if (sendNow) {
+            lock_guard<mutex> flushLock(flushMtx_);
+            vector<pair<int, int>> deltas;
+            {
+                // Lo acumulado de otros bloques viaja antes, en el mismo mensaje
+                lock_guard<mutex> lock(mtx_);
+                takePendingLocked(deltas);
+            }
+            deltas.emplace_back(id, step);
+            send(deltas);
+        }
+        else if (flushNow) {
+            flush();
+        }
+    }
+
+    // Saca los cambios pendientes (los netos en 0 no viajan) y olvida los bloques sin MPointers
+    void takePendingLocked(vector<pair<int, int>>& deltas) {
+        deltas.reserve(dirty_.size());
+        for (int id : dirty_) {
+            auto it = entries_.find(id);
+            if (it == entries_.end()) continue;
+            Entry& entry = it->second;
+            if (entry.pending != 0) deltas.emplace_back(id, static_cast<int>(entry.pending));
+            entry.pending = 0;
+            entry.dirty = false;
+            if (entry.local <= 0) entries_.erase(it);
+        }
+        dirty_.clear();
+    }
+
+    // Envía los cambios en un mensaje OP_REFDELTA (o "refdelta" de texto)
+    void send(const vector<pair<int, int>>& deltas) {
+        if (deltas.empty()) return;
+        ConnectionPool& pool = ConnectionPool::getInstance();
+        messages_.fetch_add(1, memory_order_relaxed);
+        if (pool.supportsBinary()) {
+            protocol::Message msg;
+            msg.header.opcode = protocol::OP_REFDELTA;
+            msg.payload.resize(4 + deltas.size() * 8);
+            protocol::putU32(&msg.payload[0], static_cast<uint32_t>(deltas.size()));
+            char* out = &msg.payload[4];
+            for (const auto& d : deltas) {
+                protocol::putU32(out, static_cast<uint32_t>(d.first));
+                protocol::putU32(out + 4, static_cast<uint32_t>(d.second));
+                out += 8;
+            }
+            pool.call(msg);
+            return;
+        }
+        string command = "refdelta";
+        for (const auto& d : deltas) {
+            command += ' ';
+            command += to_string(d.first);
+            command += (d.second > 0 ? " +" : " ");
+            command += to_string(d.second);
+        }
+        pool.request(command);
+    }
+
+    mutex mtx_;
+    // Serializa los envíos para que lleguen en orden
+    mutex flushMtx_;
+    unordered_map<int, Entry> entries_;
+    // Bloques con cambios pendientes, en el orden en que se ensuciaron
+    vector<int> dirty_;
+    chrono::steady_clock::time_point oldest_;
+    size_t maxPending_;
+    chrono::milliseconds maxDelay_;
+    atomic<unsigned long long> messages_;
+};
+
+#endif // REF_DELTA_TABLE_H
@@ -0,0 +1,213 @@
+#include "Allocator.h"
+#include <algorithm>
+
+// Usamos namespace std
+using namespace std;
+
+// ----------------------------------------------------------------------------------
+// Constructor
+// ----------------------------------------------------------------------------------
+Allocator::Allocator() : freeBytes_(0), lastSearch_(0) {
+    fill(begin(heads_), end(heads_), kNil);
+}
+
+// ----------------------------------------------------------------------------------
+// Reinicia con un único rango libre
+// ----------------------------------------------------------------------------------
+void Allocator::reset(size_t base, size_t size) {
+    ranges_.clear();
+    spare_.clear();
+    byStart_.clear();
+    byEnd_.clear();
+    large_.clear();
+    fill(begin(heads_), end(heads_), kNil);
+    freeBytes_ = 0;
+
+    // Solo se administran bytes alineados
+    size_t start = (base + kAlignment - 1) & ~(kAlignment - 1);
+    size_t usable = (base + size > start) ? (base + size - start) & ~(kAlignment - 1) : 0;
+    if (usable > 0) insertRange(start, usable);
+}
+
+// ----------------------------------------------------------------------------------
+// Reconstruye los rangos libres a partir de los bloques ocupados
+// ----------------------------------------------------------------------------------
+void Allocator::rebuild(size_t base, size_t size, vector<pair<size_t, size_t>>& used) {
+    reset(base, 0);
+    sort(used.begin(), used.end());
+    size_t cursor = (base + kAlignment - 1) & ~(kAlignment - 1);
+    size_t end = (base + size) & ~(kAlignment - 1);
+    for (auto& block : used) {
+        if (block.first > cursor) insertRange(cursor, block.first - cursor);
+        cursor = max(cursor, block.first + roundUp(block.second));
+    }
+    if (end > cursor) insertRange(cursor, end - cursor);
+}
+
+size_t Allocator::roundUp(size_t size) {
+    // Un bloque de 0 bytes también ocupa una unidad, para que cada bloque tenga su propio offset
+    if (size == 0) return kAlignment;
+    return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// ----------------------------------------------------------------------------------
+// Reserva un rango: primero la menor clase chica que alcance, luego best-fit en el árbol
+// ----------------------------------------------------------------------------------
+size_t Allocator::allocate(size_t size) {
+    size = roundUp(size);
+    uint32_t index = kNil;
+    lastSearch_ = 0;
+
+    if (isSmall(size)) {
+        for (size_t c = classOf(size); c < kSmallClasses; c++) {
+            lastSearch_++;
+            if (heads_[c] != kNil) {
+                index = heads_[c];
+                break;
+            }
+        }
+    }
+    if (index == kNil) {
+        lastSearch_++;
+        auto it = large_.lower_bound({ size, 0 });
+        if (it == large_.end()) return kNoSpace;
+        index = byStart_.at(it->second);
+    }
+
+    size_t offset = ranges_[index].offset;
+    size_t rangeSize = ranges_[index].size;
+    removeRange(index);
+    // Lo que sobra vuelve como un rango libre más chico
+    if (rangeSize > size) {
+        insertRange(offset + size, rangeSize - size);
+    }
+    return offset;
+}
+
+// ----------------------------------------------------------------------------------
+// Libera un rango fusionándolo con los vecinos libres que lo toquen
+// ----------------------------------------------------------------------------------
+void Allocator::release(size_t offset, size_t size) {
+    size = roundUp(size);
+
+    auto left = byEnd_.find(offset);
+    if (left != byEnd_.end()) {
+        uint32_t index = left->second;
+        offset = ranges_[index].offset;
+        size += ranges_[index].size;
+        removeRange(index);
+    }
+    auto right = byStart_.find(offset + size);
+    if (right != byStart_.end()) {
+        uint32_t index = right->second;
+        size += ranges_[index].size;
+        removeRange(index);
+    }
+    insertRange(offset, size);
+}
+
+// ----------------------------------------------------------------------------------
+// Consultas
+// ----------------------------------------------------------------------------------
+size_t Allocator::largestFree() const {
+    if (!large_.empty()) return large_.rbegin()->first;
+    for (size_t c = kSmallClasses; c-- > 0;) {
+        if (heads_[c] != kNil) return (c + 1) * kAlignment;
+    }
+    return 0;
+}
+
+size_t Allocator::metadataBytes() const {
+    // Nodo de tabla hash: el par y el enlace al siguiente; nodo del árbol: el par, tres
+    // punteros y el color (alineado como un puntero)
+    size_t hashNode = sizeof(pair<const size_t, uint32_t>) + sizeof(void*);
+    size_t treeNode = sizeof(pair<size_t, size_t>) + 4 * sizeof(void*);
+    return sizeof(*this)
+        + ranges_.capacity() * sizeof(Range) + spare_.capacity() * sizeof(uint32_t)
+        + (byStart_.bucket_count() + byEnd_.bucket_count()) * sizeof(void*)
+        + (byStart_.size() + byEnd_.size()) * hashNode
+        + large_.size() * treeNode;
+}
+
+double Allocator::fragmentation() const {
+    if (freeBytes_ == 0) return 0.0;
+    return 1.0 - static_cast<double>(largestFree()) / static_cast<double>(freeBytes_);
+}
+
+size_t Allocator::freeBefore(size_t offset) const {
+    auto it = byEnd_.find(offset);
+    return it == byEnd_.end() ? kNoSpace : ranges_[it->second].offset;
+}
+
+// ----------------------------------------------------------------------------------
+// Desliza un bloque sobre el rango libre que lo precede
+// ----------------------------------------------------------------------------------
+void Allocator::slideDown(size_t freeStart, size_t offset, size_t size) {
+    size = roundUp(size);
+    auto it = byStart_.find(freeStart);
+    if (it == byStart_.end() || ranges_[it->second].offset + ranges_[it->second].size != offset) return;
+    removeRange(it->second);
+    // El hueco queda detrás del bloque; release lo une con el rango libre que siga
+    release(freeStart + size, offset - freeStart);
+}
+
+vector<pair<size_t, size_t>> Allocator::freeRanges() const {
+    vector<pair<size_t, size_t>> result;
+    result.reserve(byStart_.size());
+    for (auto& kv : byStart_) {
+        result.emplace_back(kv.first, ranges_[kv.second].size);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+// ----------------------------------------------------------------------------------
+// Alta y baja de rangos en los índices
+// ----------------------------------------------------------------------------------
+uint32_t Allocator::newRange(size_t offset, size_t size) {
+    uint32_t index;
+    if (!spare_.empty()) {
+        index = spare_.back();
+        spare_.pop_back();
+    }
+    else {
+        index = static_cast<uint32_t>(ranges_.size());
+        ranges_.push_back({});
+    }
+    ranges_[index] = { offset, size, kNil, kNil };
+    return index;
+}
+
+void Allocator::insertRange(size_t offset, size_t size) {
+    uint32_t index = newRange(offset, size);
+    byStart_[offset] = index;
+    byEnd_[offset + size] = index;
+    freeBytes_ += size;
+
+    if (isSmall(size)) {
+        uint32_t& head = heads_[classOf(size)];
+        ranges_[index].next = head;
+        if (head != kNil) ranges_[head].prev = index;
+        head = index;
+    }
+    else {
+        large_.insert({ size, offset });
+    }
+}
+
+void Allocator::removeRange(uint32_t index) {
+    Range& range = ranges_[index];
+    byStart_.erase(range.offset);
+    byEnd_.erase(range.offset + range.size);
+    freeBytes_ -= range.size;
+
+    if (isSmall(range.size)) {
+        if (range.prev != kNil) ranges_[range.prev].next = range.next;
+        else heads_[classOf(range.size)] = range.next;
+        if (range.next != kNil) ranges_[range.next].prev = range.prev;
+    }
+    else {
+        large_.erase({ range.size, range.offset });
+    }
+    spare_.push_back(index);
+}
@@ -0,0 +1,111 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Allocator: administra los rangos libres de una porción del bloque principal.
+
+  - Los tamaños se redondean a múltiplos de 8 (los valores quedan alineados para double/long).
+  - Rangos libres chicos (hasta 256 bytes): una lista doblemente enlazada por tamaño exacto;
+    asignar toma la primera lista no vacía desde la clase pedida.
+  - Rangos libres grandes: un árbol ordenado por (tamaño, offset); asignar busca el menor que
+    alcance (best-fit) en O(log n).
+  - Metadatos de borde fuera de banda: dos tablas hash indexan cada rango libre por su inicio
+    y por su fin, así que al liberar se encuentran y fusionan los vecinos en O(1).
+
+  Asignar y liberar cuestan O(1) u O(log n) sin importar cuántos bloques haya.
+  No es thread-safe: cada shard lo usa con su propio mutex tomado.
+*/
+class Allocator {
+public:
+    // Valor que retorna allocate() cuando no hay un rango libre suficiente
+    static constexpr size_t kNoSpace = SIZE_MAX;
+    static constexpr size_t kAlignment = 8;
+
+    Allocator();
+
+    // Reinicia con un único rango libre [base, base + size)
+    void reset(size_t base, size_t size);
+
+    // Reinicia con los huecos que dejan los rangos ocupados 'used' (offset, tamaño pedido) dentro
+    // de [base, base + size); se usa al reabrir una arena persistida. Ordena 'used'.
+    void rebuild(size_t base, size_t size, vector<pair<size_t, size_t>>& used);
+
+    // Reserva 'size' bytes (redondeados con roundUp); retorna el offset o kNoSpace
+    size_t allocate(size_t size);
+
+    // Devuelve un rango reservado con allocate() y lo fusiona con sus vecinos libres
+    void release(size_t offset, size_t size);
+
+    // Bytes que ocupa realmente un bloque de 'size' bytes
+    static size_t roundUp(size_t size);
+
+    // Pasos de la última búsqueda de allocate(): listas chicas revisadas más la consulta al árbol
+    size_t lastSearchLength() const { return lastSearch_; }
+
+    size_t freeBytes() const { return freeBytes_; }
+    size_t freeRangeCount() const { return byStart_.size(); }
+
+    // Bytes aproximados de las estructuras del allocator: rangos, tablas hash y árbol (los
+    // nodos se estiman con el tamaño de una implementación típica de la biblioteca estándar)
+    size_t metadataBytes() const;
+
+    // Tamaño del mayor rango libre
+    size_t largestFree() const;
+
+    // Fragmentación: 1 - mayor rango libre / bytes libres (0 = todo el espacio libre es contiguo)
+    double fragmentation() const;
+
+    // Inicio del rango libre que termina justo en 'offset', o kNoSpace si no hay
+    size_t freeBefore(size_t offset) const;
+
+    // Compactación: el bloque [offset, offset + size) pasa a empezar en 'freeStart' (el inicio
+    // del rango libre que lo precede, ver freeBefore) y el hueco queda detrás de él, fusionado
+    // con el rango libre siguiente. No copia datos.
+    void slideDown(size_t freeStart, size_t offset, size_t size);
+
+    // Rangos libres (offset, tamaño) ordenados por offset, para el mapa de memoria
+    vector<pair<size_t, size_t>> freeRanges() const;
+
+private:
+    // Rangos de hasta kSmallClasses * kAlignment bytes van a las listas por tamaño
+    static constexpr size_t kSmallClasses = 32;
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct Range {
+        size_t offset;
+        size_t size;
+        uint32_t prev;   // enlaces de la lista de su clase (solo rangos chicos)
+        uint32_t next;
+    };
+
+    void insertRange(size_t offset, size_t size);
+    void removeRange(uint32_t index);
+    uint32_t newRange(size_t offset, size_t size);
+    static bool isSmall(size_t size) { return size <= kSmallClasses * kAlignment; }
+    static size_t classOf(size_t size) { return size / kAlignment - 1; }
+
+    // Rangos libres; los índices de 'spare_' se reutilizan
+    vector<Range> ranges_;
+    vector<uint32_t> spare_;
+    // Metadatos de borde: offset de inicio -> rango, offset de fin -> rango
+    unordered_map<size_t, uint32_t> byStart_;
+    unordered_map<size_t, uint32_t> byEnd_;
+    // Cabezas de las listas de rangos chicos, una por tamaño exacto
+    uint32_t heads_[kSmallClasses];
+    // Rangos grandes ordenados por (tamaño, offset)
+    set<pair<size_t, size_t>> large_;
+    size_t freeBytes_;
+    size_t lastSearch_;
+};
+
+#endif // ALLOCATOR_H
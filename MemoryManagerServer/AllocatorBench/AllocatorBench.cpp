@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../MemoryManager.h"
+#include "../Metrics.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  AllocatorBench: mide el camino de asignación y liberación del MemoryManager dentro del
+  mismo proceso, sin sockets, sin dumps ni log y sin compactación automática, con trazas
+  sintéticas:
+    - churn:     un conjunto fijo de bloques chicos (1..64 bytes); cada paso libera uno al azar
+                 y crea otro;
+    - powerlaw:  tamaños con distribución de Pareto (muchos chicos, pocos de hasta 64 KB);
+                 se llena hasta la mitad de la arena y después se libera y crea al azar;
+    - sawtooth:  se llena hasta el 90% con tamaños de 16 bytes a 4 KB, se libera el 80% en
+                 orden aleatorio y se repite;
+    - lifetimes: uno de cada diez bloques vive hasta el final de la traza (hasta el 40% de la
+                 arena) y el resto se libera unas mil asignaciones después, así que los de
+                 larga vida van dejando huecos entre medio.
+
+  Por traza informa asignaciones por segundo (contando solo el tiempo dentro de createBlock),
+  latencia p50/p99 y máxima de una asignación, liberaciones por segundo y la peor liberación,
+  la fragmentación máxima observada (1 - mayor rango libre / bytes libres, como en el
+  allocator), los metadatos por bloque vivo en el momento de más bloques vivos (tabla de
+  bloques más estructuras del allocator, ver MemoryManager::getAllocatorStats) y las
+  asignaciones que fallaron. Al terminar cada traza se liberan todos sus bloques: si el espacio
+  libre no vuelve a quedar en un solo rango por shard, las fusiones tienen un error y se avisa.
+
+  Las trazas corren una tras otra sobre el mismo MemoryManager y la tabla de bloques no se
+  achica: con --trace all, los metadatos de una traza incluyen los slots que dejó la anterior.
+  Para comparar ese valor entre versiones conviene correr cada traza por separado.
+
+  Uso: AllocatorBench [--memsize 64] [--shards 1] [--ops 1000000] [--trace all|churn|...]
+                      [--format table|csv|json] [--seed 1]
+*/
+
+struct Config {
+    size_t memsizeMB = 64;
+    size_t shards = 1;
+    size_t ops = 1000000;
+    string trace = "all";
+    string format = "table";
+    uint64_t seed = 1;
+};
+
+// Cada cuántas asignaciones se mira la fragmentación y los metadatos
+static constexpr size_t kSampleEvery = 256;
+
+struct Result {
+    string name;
+    Histogram allocNs;
+    Histogram freeNs;
+    uint64_t allocTotalNs = 0;
+    uint64_t freeTotalNs = 0;
+    size_t failed = 0;
+    double peakFragmentation = 0.0;
+    size_t peakLive = 0;
+    size_t metadataAtPeak = 0;
+};
+
+// ----------------------------------------------------------------------------------
+// Estado de una traza: bloques vivos y mediciones
+// ----------------------------------------------------------------------------------
+class Bench {
+public:
+    Bench(const Config& config, Result& result)
+        : rng(config.seed), arenaSize(config.memsizeMB * 1024 * 1024), liveBytes(0),
+          mm_(MemoryManager::getInstance()), result_(result), allocations_(0) {}
+
+    struct Block {
+        int id;
+        size_t size;
+    };
+
+    // Crea un bloque de 'size' bytes; -1 si no hubo lugar
+    int allocate(size_t size) {
+        uint64_t start = Metrics::nowNs();
+        int id = mm_.createBlock(size, "raw");
+        uint64_t elapsed = Metrics::nowNs() - start;
+        result_.allocNs.record(elapsed);
+        result_.allocTotalNs += elapsed;
+        if (id < 0) {
+            result_.failed++;
+        }
+        else {
+            liveBytes += size;
+        }
+        if (++allocations_ % kSampleEvery == 0) sample();
+        return id;
+    }
+
+    void release(const Block& block) {
+        uint64_t start = Metrics::nowNs();
+        mm_.decreaseRefCount(block.id);
+        uint64_t elapsed = Metrics::nowNs() - start;
+        result_.freeNs.record(elapsed);
+        result_.freeTotalNs += elapsed;
+        liveBytes -= block.size;
+    }
+
+    // Libera el bloque 'index' de 'blocks' (el último ocupa su lugar)
+    void releaseAt(vector<Block>& blocks, size_t index) {
+        release(blocks[index]);
+        blocks[index] = blocks.back();
+        blocks.pop_back();
+    }
+
+    void releaseAll(vector<Block>& blocks) {
+        for (const Block& block : blocks) release(block);
+        blocks.clear();
+    }
+
+    size_t allocations() const { return allocations_; }
+
+    size_t uniform(size_t low, size_t high) {
+        return uniform_int_distribution<size_t>(low, high)(rng);
+    }
+
+    // Pareto con mínimo 'low' e índice 'alpha', cortada en 'high'
+    size_t pareto(size_t low, size_t high, double alpha) {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double size = static_cast<double>(low) / pow(1.0 - u, 1.0 / alpha);
+        return min(high, static_cast<size_t>(size));
+    }
+
+    // Fragmentación máxima y metadatos en el momento de más bloques vivos
+    void sample() {
+        MemoryManager::AllocatorStats stats = mm_.getAllocatorStats();
+        result_.peakFragmentation = max(result_.peakFragmentation, stats.fragmentation);
+        if (stats.liveBlocks > result_.peakLive) {
+            result_.peakLive = stats.liveBlocks;
+            result_.metadataAtPeak = stats.metadataBytes;
+        }
+    }
+
+    mt19937_64 rng;
+    const size_t arenaSize;
+    // Bytes pedidos por los bloques vivos de la traza
+    size_t liveBytes;
+
+private:
+    MemoryManager& mm_;
+    Result& result_;
+    size_t allocations_;
+};
+
+// ----------------------------------------------------------------------------------
+// Trazas
+// ----------------------------------------------------------------------------------
+static void runChurn(Bench& bench, size_t ops) {
+    const size_t kLive = 10000;
+    vector<Bench::Block> blocks;
+    while (bench.allocations() < ops) {
+        if (blocks.size() >= kLive) bench.releaseAt(blocks, bench.uniform(0, blocks.size() - 1));
+        size_t size = bench.uniform(1, 64);
+        int id = bench.allocate(size);
+        if (id >= 0) blocks.push_back({ id, size });
+    }
+    bench.releaseAll(blocks);
+}
+
+static void runPowerLaw(Bench& bench, size_t ops) {
+    size_t target = bench.arenaSize / 2;
+    vector<Bench::Block> blocks;
+    while (bench.allocations() < ops) {
+        if (bench.liveBytes >= target && !blocks.empty()) {
+            bench.releaseAt(blocks, bench.uniform(0, blocks.size() - 1));
+            continue;
+        }
+        size_t size = bench.pareto(16, 64 * 1024, 1.1);
+        int id = bench.allocate(size);
+        if (id >= 0) blocks.push_back({ id, size });
+    }
+    bench.releaseAll(blocks);
+}
+
+static void runSawtooth(Bench& bench, size_t ops) {
+    size_t high = bench.arenaSize / 10 * 9;
+    vector<Bench::Block> blocks;
+    while (bench.allocations() < ops) {
+        // Subida: se llena hasta el 90% (o hasta que una asignación falle)
+        while (bench.allocations() < ops && bench.liveBytes < high) {
+            size_t size = bench.uniform(16, 4096);
+            int id = bench.allocate(size);
+            if (id < 0) break;
+            blocks.push_back({ id, size });
+        }
+        bench.sample();
+        // Bajada: se libera el 80% en orden aleatorio
+        shuffle(blocks.begin(), blocks.end(), bench.rng);
+        size_t keep = blocks.size() / 5;
+        while (blocks.size() > keep) {
+            bench.release(blocks.back());
+            blocks.pop_back();
+        }
+        bench.sample();
+    }
+    bench.releaseAll(blocks);
+}
+
+static void runLifetimes(Bench& bench, size_t ops) {
+    const size_t kShortLife = 1000;
+    size_t longBudget = bench.arenaSize / 10 * 4;
+    size_t longBytes = 0;
+    vector<Bench::Block> longLived;
+    deque<Bench::Block> shortLived;
+    while (bench.allocations() < ops) {
+        size_t size = bench.uniform(16, 1024);
+        bool isLong = bench.uniform(0, 9) == 0 && longBytes + size <= longBudget;
+        int id = bench.allocate(size);
+        if (id >= 0) {
+            if (isLong) {
+                longLived.push_back({ id, size });
+                longBytes += size;
+            }
+            else {
+                shortLived.push_back({ id, size });
+            }
+        }
+        if (shortLived.size() > kShortLife) {
+            bench.release(shortLived.front());
+            shortLived.pop_front();
+        }
+    }
+    while (!shortLived.empty()) {
+        bench.release(shortLived.front());
+        shortLived.pop_front();
+    }
+    bench.releaseAll(longLived);
+}
+
+struct Trace {
+    const char* name;
+    void (*run)(Bench&, size_t);
+};
+
+static const Trace kTraces[] = {
+    { "churn", runChurn },
+    { "powerlaw", runPowerLaw },
+    { "sawtooth", runSawtooth },
+    { "lifetimes", runLifetimes },
+};
+
+// ----------------------------------------------------------------------------------
+// Argumentos
+// ----------------------------------------------------------------------------------
+static bool parseArguments(int argc, char** argv, Config& config) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        string value = argv[++i];
+        if (arg == "--memsize") config.memsizeMB = stoul(value);
+        else if (arg == "--shards") config.shards = stoul(value);
+        else if (arg == "--ops") config.ops = stoul(value);
+        else if (arg == "--trace") {
+            bool known = value == "all" || any_of(begin(kTraces), end(kTraces),
+                [&](const Trace& trace) { return value == trace.name; });
+            if (!known) return false;
+            config.trace = value;
+        }
+        else if (arg == "--format") {
+            if (value != "table" && value != "csv" && value != "json") return false;
+            config.format = value;
+        }
+        else if (arg == "--seed") config.seed = stoull(value);
+        else return false;
+    }
+    return config.memsizeMB > 0 && config.shards > 0 && config.ops > 0;
+}
+
+// ----------------------------------------------------------------------------------
+// Resultados
+// ----------------------------------------------------------------------------------
+static double perSecond(uint64_t count, uint64_t ns) {
+    return ns == 0 ? 0.0 : static_cast<double>(count) * 1e9 / static_cast<double>(ns);
+}
+
+static double metadataPerBlock(const Result& r) {
+    return r.peakLive == 0 ? 0.0 : static_cast<double>(r.metadataAtPeak) / static_cast<double>(r.peakLive);
+}
+
+static void writeTable(const vector<unique_ptr<Result>>& results) {
+    cout << left << setw(11) << "Traza" << right << setw(10) << "asign." << setw(12) << "asign/s"
+         << setw(9) << "p50" << setw(9) << "p99" << setw(10) << "máx" << setw(12) << "liber/s"
+         << setw(10) << "máx lib" << setw(8) << "frag" << setw(11) << "meta/blq" << setw(8) << "fallas" << "\n";
+    for (const auto& r : results) {
+        cout << left << setw(11) << r->name << right << setw(10) << r->allocNs.count()
+             << fixed << setprecision(0) << setw(12) << perSecond(r->allocNs.count(), r->allocTotalNs)
+             << setw(9) << r->allocNs.percentile(0.5) << setw(9) << r->allocNs.percentile(0.99)
+             << setw(10) << r->allocNs.maxValue()
+             << setw(12) << perSecond(r->freeNs.count(), r->freeTotalNs) << setw(10) << r->freeNs.maxValue()
+             << setprecision(3) << setw(8) << r->peakFragmentation
+             << setprecision(1) << setw(11) << metadataPerBlock(*r) << setw(8) << r->failed << "\n";
+    }
+    cout << "(tiempos en ns; frag = fragmentación máxima; meta/blq = bytes de metadatos por bloque vivo)\n";
+}
+
+static void writeCsv(const vector<unique_ptr<Result>>& results) {
+    cout << "trace,allocs,allocs_per_sec,p50_alloc_ns,p99_alloc_ns,max_alloc_ns,frees,frees_per_sec,"
+            "max_free_ns,peak_fragmentation,peak_live_blocks,metadata_bytes_per_block,failed\n";
+    for (const auto& r : results) {
+        cout << r->name << "," << r->allocNs.count() << "," << fixed << setprecision(0)
+             << perSecond(r->allocNs.count(), r->allocTotalNs) << "," << r->allocNs.percentile(0.5) << ","
+             << r->allocNs.percentile(0.99) << "," << r->allocNs.maxValue() << "," << r->freeNs.count() << ","
+             << perSecond(r->freeNs.count(), r->freeTotalNs) << "," << r->freeNs.maxValue() << ","
+             << setprecision(4) << r->peakFragmentation << "," << r->peakLive << ","
+             << setprecision(1) << metadataPerBlock(*r) << "," << r->failed << "\n";
+    }
+}
+
+static void writeJson(const Config& config, const vector<unique_ptr<Result>>& results) {
+    cout << "{\"config\":{\"memsizeMB\":" << config.memsizeMB << ",\"shards\":" << config.shards
+         << ",\"ops\":" << config.ops << ",\"seed\":" << config.seed << "},\"results\":{";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = *results[i];
+        cout << (i ? "," : "") << "\"" << r.name << "\":{\"allocs\":" << r.allocNs.count()
+             << ",\"allocsPerSec\":" << fixed << setprecision(0) << perSecond(r.allocNs.count(), r.allocTotalNs)
+             << ",\"p50AllocNs\":" << r.allocNs.percentile(0.5) << ",\"p99AllocNs\":" << r.allocNs.percentile(0.99)
+             << ",\"maxAllocNs\":" << r.allocNs.maxValue() << ",\"frees\":" << r.freeNs.count()
+             << ",\"freesPerSec\":" << perSecond(r.freeNs.count(), r.freeTotalNs)
+             << ",\"maxFreeNs\":" << r.freeNs.maxValue()
+             << ",\"peakFragmentation\":" << setprecision(4) << r.peakFragmentation
+             << ",\"peakLiveBlocks\":" << r.peakLive
+             << ",\"metadataBytesPerBlock\":" << setprecision(1) << metadataPerBlock(r)
+             << ",\"failed\":" << r.failed << "}";
+    }
+    cout << "}}\n";
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    if (!parseArguments(argc, argv, config)) {
+        cerr << "Uso: " << argv[0]
+             << " [--memsize <MB>] [--shards <N>] [--ops <N>]"
+             << " [--trace all|churn|powerlaw|sawtooth|lifetimes] [--format table|csv|json] [--seed <N>]" << endl;
+        return 1;
+    }
+
+    // El mensaje de init() va a stderr para no mezclarse con el CSV o el JSON
+    MemoryManager& mm = MemoryManager::getInstance();
+    streambuf* out = cout.rdbuf(cerr.rdbuf());
+    mm.init(config.memsizeMB * 1024 * 1024, config.shards);
+    cout.rdbuf(out);
+    // Se mide el allocator tal cual: la compactación solo correría entre peticiones del servidor
+    mm.setCompactionThreshold(0);
+
+    vector<unique_ptr<Result>> results;
+    bool leaked = false;
+    for (const Trace& trace : kTraces) {
+        if (config.trace != "all" && config.trace != trace.name) continue;
+        cerr << "[BENCH] Traza " << trace.name << " (" << config.ops << " asignaciones)..." << endl;
+        auto result = make_unique<Result>();
+        result->name = trace.name;
+        Bench bench(config, *result);
+        trace.run(bench, config.ops);
+
+        // Sin bloques vivos, cada shard debe quedar con un único rango libre
+        MemoryManager::AllocatorStats stats = mm.getAllocatorStats();
+        if (stats.liveBlocks != 0 || stats.usedBytes != 0 || stats.freeRanges != mm.getShardCount()) {
+            cerr << "[BENCH] Aviso: tras la traza " << trace.name << " quedan " << stats.liveBlocks
+                 << " bloques, " << stats.usedBytes << " bytes usados y " << stats.freeRanges
+                 << " rangos libres en " << mm.getShardCount() << " shard(s)." << endl;
+            leaked = true;
+        }
+        results.push_back(move(result));
+    }
+
+    if (config.format == "json") writeJson(config, results);
+    else if (config.format == "csv") writeCsv(results);
+    else writeTable(results);
+    return leaked ? 2 : 0;
+}
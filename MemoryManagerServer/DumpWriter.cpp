@@ -0,0 +1,241 @@
+#include "DumpWriter.h"
+#include "TypeCodec.h"
+#include "Metrics.h"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Usamos namespace std
+using namespace std;
+
+// ----------------------------------------------------------------------------------
+// Constructor y destructor
+// ----------------------------------------------------------------------------------
+DumpWriter::DumpWriter()
+    : enqueuePos_(0), dequeuePos_(0), dropped_(0),
+      mode_(DumpMode::Off), every_(0), running_(false), sleeping_(false), cachedSecond_(-1) {
+}
+
+DumpWriter::~DumpWriter() {
+    stop();
+}
+
+// ----------------------------------------------------------------------------------
+// Abre el archivo y arranca el hilo de dump
+// ----------------------------------------------------------------------------------
+bool DumpWriter::start(const string& path, DumpMode mode, size_t every, function<string()> snapshot) {
+    stop();
+    if (mode == DumpMode::Off) return true;
+
+    file_.open(path, ios::app | ios::binary);
+    if (!file_) {
+        cerr << "DumpWriter: No se pudo abrir/crear el archivo de dump." << endl;
+        return false;
+    }
+    // El anillo se reserva recién aquí: con --dumpMode off no ocupa memoria
+    if (!cells_) {
+        cells_.reset(new Cell[kCapacity]);
+        for (size_t i = 0; i < kCapacity; i++) {
+            cells_[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+    mode_ = mode;
+    every_ = (mode == DumpMode::Full && every == 0) ? 1 : every;
+    snapshot_ = move(snapshot);
+    running_.store(true, memory_order_release);
+    worker_ = thread(&DumpWriter::run, this);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Detiene el hilo después de escribir todo lo encolado
+// ----------------------------------------------------------------------------------
+void DumpWriter::stop() {
+    if (!worker_.joinable()) return;
+    {
+        lock_guard<mutex> lock(sleepMtx_);
+        running_.store(false, memory_order_release);
+    }
+    wakeup_.notify_one();
+    worker_.join();
+    file_.close();
+}
+
+// ----------------------------------------------------------------------------------
+// Anillo acotado de varios productores y un consumidor: cada celda tiene un número de
+// secuencia que indica si está libre para la vuelta actual o ya tiene un registro listo.
+// ----------------------------------------------------------------------------------
+bool DumpWriter::push(const DumpRecord& record) {
+    size_t pos = enqueuePos_.load(memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells_[pos & (kCapacity - 1)];
+        size_t sequence = cell->sequence.load(memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            // Anillo lleno: se descarta antes que hacer esperar al cliente
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        else {
+            pos = enqueuePos_.load(memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->sequence.store(pos + 1, memory_order_release);
+
+    if (sleeping_.load(memory_order_acquire)) {
+        lock_guard<mutex> lock(sleepMtx_);
+        wakeup_.notify_one();
+    }
+    return true;
+}
+
+bool DumpWriter::pop(DumpRecord& record) {
+    Cell& cell = cells_[dequeuePos_ & (kCapacity - 1)];
+    if (cell.sequence.load(memory_order_acquire) != dequeuePos_ + 1) return false;
+    record = cell.record;
+    cell.sequence.store(dequeuePos_ + kCapacity, memory_order_release);
+    dequeuePos_++;
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Bucle del hilo de dump
+// ----------------------------------------------------------------------------------
+void DumpWriter::run() {
+    size_t sinceSnapshot = 0;
+    DumpRecord record;
+    while (true) {
+        // Vacía el anillo
+        uint64_t passStart = Metrics::nowNs();
+        bool wrote = false;
+        int64_t lastTime = 0;
+        while (pop(record)) {
+            writeRecord(record);
+            lastTime = record.timeMs;
+            wrote = true;
+            sinceSnapshot++;
+        }
+
+        uint64_t dropped = dropped_.exchange(0, memory_order_relaxed);
+        if (dropped > 0) {
+            lastTime = nowMs();
+            file_ << "[" << formatTimestamp(lastTime) << "] AVISO: " << dropped
+                << " registros descartados (anillo lleno)\n";
+            wrote = true;
+            if (every_ > 0) sinceSnapshot = every_;
+        }
+
+        // Una sola instantánea por pasada aunque se hayan acumulado varias
+        if (every_ > 0 && sinceSnapshot >= every_) {
+            writeSnapshot(lastTime);
+            sinceSnapshot = 0;
+        }
+        if (wrote) {
+            file_.flush();
+            Metrics::getInstance().record(Metrics::DUMP_PASS, Metrics::nowNs() - passStart);
+        }
+
+        // Duerme hasta que llegue un registro; la espera acotada cubre la carrera entre el
+        // último pop y la marca de 'sleeping_'
+        unique_lock<mutex> lock(sleepMtx_);
+        if (!running_.load(memory_order_acquire)) {
+            lock.unlock();
+            while (pop(record)) writeRecord(record);
+            file_.flush();
+            return;
+        }
+        sleeping_.store(true, memory_order_release);
+        Cell& next = cells_[dequeuePos_ & (kCapacity - 1)];
+        if (next.sequence.load(memory_order_acquire) != dequeuePos_ + 1) {
+            wakeup_.wait_for(lock, chrono::milliseconds(100));
+        }
+        sleeping_.store(false, memory_order_release);
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Formatea un registro como una línea del dump
+// ----------------------------------------------------------------------------------
+void DumpWriter::writeRecord(const DumpRecord& record) {
+    string type(record.type, strnlen(record.type, sizeof(record.type)));
+    file_ << "[" << formatTimestamp(record.timeMs) << "] ";
+    switch (record.op) {
+    case DumpRecord::CREATE:
+        file_ << "CREATE -> ID=" << record.blockID << ", size=" << record.arg << ", type=" << type;
+        break;
+    case DumpRecord::SET: {
+        file_ << "SET -> ID=" << record.blockID << ", newValue=";
+        // Mismo formato que getValue (los primeros bytes del bloque, ver MemoryManager::recordDump)
+        const TypeCodec& codec = codecFor(record.typeTag);
+        if (record.arg >= codec.minSize) {
+            value_.clear();
+            codec.formatText(record.data, record.arg, value_);
+            file_ << value_;
+        }
+        break;
+    }
+    case DumpRecord::INCREASE:
+        file_ << "INCREASE -> ID=" << record.blockID << ", newRefCount=" << record.arg;
+        break;
+    case DumpRecord::DECREASE:
+        file_ << "DECREASE -> ID=" << record.blockID << ", newRefCount=" << record.arg;
+        if (record.liberated) file_ << " (LIBERATED)";
+        break;
+    }
+    file_ << "\n";
+}
+
+void DumpWriter::writeSnapshot(int64_t timeMs) {
+    if (!snapshot_) return;
+    if (timeMs == 0) timeMs = nowMs();
+    file_ << "[" << formatTimestamp(timeMs) << "] SNAPSHOT\n" << snapshot_() << "\n";
+}
+
+// ----------------------------------------------------------------------------------
+// Timestamp con fecha y hora (ms incluidos); la parte de fecha se recalcula una vez por segundo
+// ----------------------------------------------------------------------------------
+const string& DumpWriter::formatTimestamp(int64_t timeMs) {
+    int64_t second = timeMs / 1000;
+    if (second != cachedSecond_) {
+        time_t t = static_cast<time_t>(second);
+        tm localTm;
+#ifdef _WIN32
+        localtime_s(&localTm, &t);
+#else
+        localtime_r(&t, &localTm);
+#endif
+        ostringstream oss;
+        oss << put_time(&localTm, "%Y-%m-%d %H:%M:%S") << ".";
+        cachedPrefix_ = oss.str();
+        cachedSecond_ = second;
+    }
+    int ms = static_cast<int>(timeMs % 1000);
+    cachedTimestamp_ = cachedPrefix_;
+    cachedTimestamp_ += static_cast<char>('0' + ms / 100);
+    cachedTimestamp_ += static_cast<char>('0' + ms / 10 % 10);
+    cachedTimestamp_ += static_cast<char>('0' + ms % 10);
+    return cachedTimestamp_;
+}
+
+// ----------------------------------------------------------------------------------
+// Utilidades
+// ----------------------------------------------------------------------------------
+bool DumpWriter::parseMode(const string& name, DumpMode& mode) {
+    if (name == "off")   { mode = DumpMode::Off;   return true; }
+    if (name == "delta") { mode = DumpMode::Delta; return true; }
+    if (name == "full")  { mode = DumpMode::Full;  return true; }
+    return false;
+}
+
+int64_t DumpWriter::nowMs() {
+    return chrono::duration_cast<chrono::milliseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+}
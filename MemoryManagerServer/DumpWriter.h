@@ -0,0 +1,118 @@
+#ifndef DUMP_WRITER_H
+#define DUMP_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  DumpWriter: escribe el archivo de dump en un hilo propio.
+
+  Las operaciones del MemoryManager ya no formatean ni escriben nada: solo encolan un registro
+  compacto (DumpRecord) en un anillo sin locks de varios productores y un consumidor. El hilo
+  de dump vacía el anillo, formatea cada registro como una línea y la agrega al archivo, que
+  queda abierto todo el tiempo.
+
+  Modos (--dumpMode):
+    - off:   no se escribe nada.
+    - delta: una línea por operación (CREATE, SET, INCREASE, DECREASE); con --dumpEvery N > 0
+             además se escribe el estado completo cada N operaciones.
+    - full:  como delta, pero el estado completo (status + mapa de memoria) se escribe cada
+             N operaciones (por defecto N = 1, como el dump original). Si el hilo va atrasado,
+             las instantáneas pendientes se juntan en una sola con el estado del momento.
+
+  Si el anillo se llena, los registros nuevos se descartan (el servidor nunca espera al disco) y
+  el archivo lo indica; en modo full se fuerza una instantánea para volver a un estado conocido.
+*/
+enum class DumpMode { Off, Delta, Full };
+
+// Registro de una operación (72 bytes)
+struct DumpRecord {
+    enum Op : uint8_t { CREATE, SET, INCREASE, DECREASE };
+
+    int64_t timeMs = 0;     // milisegundos desde epoch
+    int32_t blockID = -1;
+    uint32_t arg = 0;       // CREATE: tamaño; INCREASE/DECREASE: refCount nuevo; SET: bytes en 'data'
+    uint8_t op = CREATE;
+    bool liberated = false; // DECREASE que liberó el bloque
+    uint8_t typeTag = 0;    // SET: tag del tipo para formatear 'data' (ver TypeCodec)
+    char type[13] = {};     // nombre del tipo (truncado, terminado en '\0' si cabe)
+    char data[40] = {};     // SET: primeros bytes del bloque tal como quedaron en memoria
+};
+
+class DumpWriter {
+public:
+    DumpWriter();
+    ~DumpWriter();
+
+    // Abre 'path' en modo append y arranca el hilo. 'snapshot' arma el estado completo; se
+    // llama desde el hilo de dump sin ningún lock tomado.
+    bool start(const string& path, DumpMode mode, size_t every, function<string()> snapshot);
+
+    // Escribe lo pendiente y detiene el hilo
+    void stop();
+
+    // Indica si hay que generar registros
+    bool enabled() const { return running_.load(memory_order_relaxed); }
+
+    // Encola un registro sin bloquear; false si el anillo estaba lleno
+    bool push(const DumpRecord& record);
+
+    // Convierte un nombre de modo ("off", "delta", "full"); false si no es válido
+    static bool parseMode(const string& name, DumpMode& mode);
+
+    // Milisegundos desde epoch para DumpRecord::timeMs
+    static int64_t nowMs();
+
+private:
+    DumpWriter(const DumpWriter&) = delete;
+    DumpWriter& operator=(const DumpWriter&) = delete;
+
+    // Capacidad del anillo (potencia de 2)
+    static constexpr size_t kCapacity = 1 << 16;
+
+    struct Cell {
+        atomic<size_t> sequence;
+        DumpRecord record;
+    };
+
+    bool pop(DumpRecord& record);
+    void run();
+    void writeRecord(const DumpRecord& record);
+    void writeSnapshot(int64_t timeMs);
+    const string& formatTimestamp(int64_t timeMs);
+
+    unique_ptr<Cell[]> cells_;
+    atomic<size_t> enqueuePos_;
+    size_t dequeuePos_;           // solo lo usa el hilo de dump
+    atomic<uint64_t> dropped_;
+
+    DumpMode mode_;
+    size_t every_;
+    function<string()> snapshot_;
+    ofstream file_;
+    string value_;                // buffer reutilizado para formatear valores
+    thread worker_;
+    atomic<bool> running_;
+
+    // El hilo duerme cuando el anillo está vacío; los productores lo despiertan solo si duerme
+    mutex sleepMtx_;
+    condition_variable wakeup_;
+    atomic<bool> sleeping_;
+
+    // Caché del timestamp formateado (cambia una vez por milisegundo como mucho)
+    int64_t cachedSecond_;
+    string cachedPrefix_;
+    string cachedTimestamp_;
+};
+
+#endif // DUMP_WRITER_H
@@ -0,0 +1,353 @@
+#ifndef HANDLE_TABLE_H
+#define HANDLE_TABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  HandleTable: tabla densa de metadatos de bloques de un shard.
+
+  Cada bloque ocupa un slot de 24 bytes en un arreglo contiguo y el ID del bloque lleva el
+  índice del slot, así que buscar un bloque es un acceso indexado. Cada slot tiene un número
+  de generación que se incrementa al liberarlo: un ID viejo (de un bloque ya liberado cuyo slot
+  se reutilizó) no coincide con la generación actual y se rechaza.
+
+  Los slots libres forman una cola enlazada intrusiva a través del campo 'offset', de modo
+  que los IDs se reutilizan sin memoria adicional. La cola es FIFO y un slot libre solo se
+  reutiliza si hay al menos kReuseDistance libres (o la tabla ya no puede crecer): como la
+  generación tiene 7 bits, un ID viejo recién volvería a ser válido después de unos
+  127 * kReuseDistance create/free, no de 127 como con una pila.
+
+  Por defecto los slots viven en memoria propia que crece a demanda. Con attach() la tabla usa
+  memoria externa de capacidad fija (el encabezado de un archivo mapeado, ver MappedFile): los
+  slots y los contadores (State) no tienen punteros, así que al reabrir el archivo la tabla
+  queda tal como estaba, sin reconstruir nada.
+
+  Lecturas sin lock: la versión de cada slot funciona además como secuencia de un seqlock.
+  Toda modificación del slot o del valor de su bloque que pueda ver un lector se hace dentro
+  de un SeqWrite, que deja la versión impar mientras dura; readConsistent() copia el slot (y lo
+  que haga falta del bloque) y reintenta si la versión cambió. Para que esa copia nunca lea
+  memoria liberada, la memoria propia crece a un arreglo nuevo sin liberar el anterior (se
+  libera en reset()); los slots del anterior quedan con versión impar y los lectores que
+  todavía lo usaban reintentan sobre el nuevo.
+
+  Fuera de readConsistent() no es thread-safe: se usa con el mutex del shard tomado.
+*/
+class HandleTable {
+public:
+    // Metadatos de un bloque (24 bytes)
+    struct Slot {
+        uint64_t offset;        // offset en el bloque principal; si el slot está libre, siguiente slot libre
+        uint32_t size;          // tamaño pedido en bytes
+        uint32_t refCount;      // contador de referencias
+        uint16_t generation;    // generación actual del slot (kMinGeneration..kMaxGeneration)
+        uint8_t typeTag;        // índice del nombre de tipo en la tabla del MemoryManager
+        uint8_t flags;          // SLOT_LIVE, SLOT_LEASED, SLOT_ARRAY
+        uint32_t version;       // avanza de a 2 con cada escritura o movimiento; impar durante ella (SeqWrite)
+    };
+
+    static_assert(sizeof(Slot) == 24, "HandleTable::Slot debe ocupar 24 bytes");
+
+    // Contadores de la tabla (16 bytes); en memoria externa se guardan junto a los slots
+    struct State {
+        uint32_t used;          // slots usados alguna vez: los índices [0, used) son válidos
+        uint32_t freeHead;      // primer slot de la lista libre (kNone si está vacía)
+        uint64_t live;          // slots vivos
+    };
+
+    // SLOT_LEASED: algún cliente pudo recibir un lease de lectura (ver LeaseTable)
+    // SLOT_ARRAY: el bloque es un arreglo de elementos del tipo 'typeTag'
+    enum : uint8_t { SLOT_LIVE = 1, SLOT_LEASED = 2, SLOT_ARRAY = 4 };
+
+    // La generación viaja en 7 bits del ID; 0 no se usa para que ningún ID válido sea 0
+    static constexpr uint16_t kMinGeneration = 1;
+    static constexpr uint16_t kMaxGeneration = 127;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // Slots libres que tiene que haber para reutilizar uno en lugar de agregar otro
+    static constexpr uint32_t kReuseDistance = 1024;
+
+    // Intentos de readConsistent() antes de rendirse (el que llama toma el mutex)
+    static constexpr int kReadAttempts = 32;
+
+    explicit HandleTable(uint32_t maxSlots = 1u << 24) : published_(nullptr) {
+        reset(maxSlots);
+    }
+
+    HandleTable(const HandleTable&) = delete;
+    HandleTable& operator=(const HandleTable&) = delete;
+
+    // Vacía la tabla y vuelve a memoria propia, con a lo sumo 'maxSlots' slots
+    void reset(uint32_t maxSlots) {
+        owned_.reset();
+        retired_.clear();
+        capacity_ = 0;
+        retiredSlots_ = 0;
+        ownedState_ = State{ 0, kNone, 0 };
+        state_ = &ownedState_;
+        freeTail_ = kNone;
+        slots_ = nullptr;
+        published_.store(nullptr, memory_order_release);
+        maxSlots_ = maxSlots;
+        external_ = false;
+    }
+
+    // Usa memoria externa con lugar para 'capacity' slots. Si 'fresh', la tabla empieza vacía;
+    // si no, se retoma el contenido que ya tenía esa memoria.
+    void attach(State* state, Slot* slots, uint32_t capacity, bool fresh) {
+        reset(capacity);
+        state_ = state;
+        slots_ = slots;
+        published_.store(slots_, memory_order_release);
+        external_ = true;
+        if (fresh) *state_ = State{ 0, kNone, 0 };
+        else {
+            settleVersions();
+            findFreeTail();
+        }
+    }
+
+    // Reemplaza el contenido por 'state' y los slots [0, state.used) de 'slots' (un snapshot);
+    // false si no entran o la lista libre no apunta a un slot válido
+    bool load(const State& state, const Slot* slots) {
+        if (state.used > maxSlots_ || (state.freeHead != kNone && state.freeHead >= state.used)) return false;
+        uint32_t used = state.used;
+        if (!external_ && used > capacity_) grow(used);
+        if (used > 0) memcpy(slots_, slots, used * sizeof(Slot));
+        *state_ = state;
+        settleVersions();
+        findFreeTail();
+        return true;
+    }
+
+    // Escribe el slot 'index' tal cual (al aplicar el write-ahead log), agregando slots vacíos
+    // si hace falta; la lista libre y la cuenta de vivos se rehacen después con relink()
+    bool put(uint32_t index, const Slot& slot) {
+        if (index >= maxSlots_) return false;
+        if (!external_ && index >= capacity_) grow(index + 1);
+        while (state_->used <= index) {
+            slots_[state_->used] = Slot{};
+            slots_[state_->used].generation = kMinGeneration;
+            state_->used++;
+        }
+        slots_[index] = slot;
+        return true;
+    }
+
+    // Rehace la cola libre (en orden de índice) y la cuenta de vivos a partir de los flags
+    void relink() {
+        settleVersions();
+        state_->freeHead = kNone;
+        state_->live = 0;
+        freeTail_ = kNone;
+        for (uint32_t i = state_->used; i-- > 0;) {
+            if (slots_[i].flags & SLOT_LIVE) {
+                state_->live++;
+            }
+            else {
+                slots_[i].offset = state_->freeHead;
+                state_->freeHead = i;
+                if (freeTail_ == kNone) freeTail_ = i;
+            }
+        }
+    }
+
+    // Contadores y slots [0, state().used), para copiarlos a un snapshot
+    const State& state() const { return *state_; }
+    const Slot* data() const { return slots_; }
+
+    // Toma el slot libre más antiguo (o agrega uno nuevo, ver kReuseDistance) y lo marca vivo;
+    // kNone si la tabla está llena
+    uint32_t acquire() {
+        uint32_t index;
+        uint64_t freeSlots = state_->used - state_->live;
+        if (state_->freeHead != kNone && (freeSlots >= kReuseDistance || state_->used >= maxSlots_)) {
+            index = state_->freeHead;
+            state_->freeHead = static_cast<uint32_t>(slots_[index].offset);
+            if (state_->freeHead == kNone) freeTail_ = kNone;
+        }
+        else {
+            if (state_->used >= maxSlots_) return kNone;
+            index = state_->used;
+            if (!external_ && index >= capacity_) grow(index + 1);
+            slots_[index] = Slot{};
+            slots_[index].generation = kMinGeneration;
+            // Los lectores sin lock solo miran slots por debajo de 'used'
+            atomic_ref<uint32_t>(state_->used).store(index + 1, memory_order_release);
+        }
+        Slot& slot = slots_[index];
+        SeqWrite write(slot);
+        slot.offset = 0;
+        slot.size = 0;
+        slot.refCount = 1;
+        slot.typeTag = 0;
+        slot.flags = SLOT_LIVE;
+        state_->live++;
+        return index;
+    }
+
+    // Libera el slot: avanza su generación y lo pone al final de la cola libre
+    void release(uint32_t index) {
+        {
+            Slot& slot = slots_[index];
+            SeqWrite write(slot);
+            slot.flags = 0;
+            slot.generation = (slot.generation == kMaxGeneration) ? kMinGeneration : slot.generation + 1;
+            slot.offset = kNone;
+        }
+        if (freeTail_ == kNone) {
+            state_->freeHead = index;
+        }
+        else {
+            Slot& last = slots_[freeTail_];
+            SeqWrite write(last);
+            last.offset = index;
+        }
+        freeTail_ = index;
+        state_->live--;
+    }
+
+    // Slot vivo con esa generación, o nullptr si el ID ya no es válido
+    Slot* find(uint32_t index, uint16_t generation) {
+        if (index >= state_->used) return nullptr;
+        Slot& slot = slots_[index];
+        if (!(slot.flags & SLOT_LIVE) || slot.generation != generation) return nullptr;
+        return &slot;
+    }
+
+    // Slot por índice (debe estar vivo)
+    Slot& at(uint32_t index) { return slots_[index]; }
+
+    // Sección de escritura de un slot: la versión queda impar desde la construcción hasta la
+    // destrucción, y los lectores sin lock descartan lo que copiaron en ese lapso. No se anidan.
+    class SeqWrite {
+    public:
+        explicit SeqWrite(Slot& slot) : seq_(slot.version) {
+            seq_.store(seq_.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+        }
+        ~SeqWrite() {
+            seq_.store(seq_.load(memory_order_relaxed) + 1, memory_order_release);
+        }
+
+    private:
+        SeqWrite(const SeqWrite&) = delete;
+        SeqWrite& operator=(const SeqWrite&) = delete;
+
+        atomic_ref<uint32_t> seq_;
+    };
+
+    // Lectura sin lock: copia el slot 'index' en 'out' y llama a copy(out) para que copie lo
+    // que necesite del bloque; si un escritor tocó el slot mientras tanto, se repite. Un slot
+    // fuera de la tabla se lee como libre. 'copy' puede recibir un slot a medio escribir (que
+    // después se descarta), así que debe validar lo que use. false si en kReadAttempts intentos
+    // no hubo una lectura estable.
+    template <typename F>
+    bool readConsistent(uint32_t index, Slot& out, F&& copy) const {
+        for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+            if (index >= atomic_ref<uint32_t>(state_->used).load(memory_order_acquire)) {
+                out = Slot{};
+                return true;
+            }
+            // Leído después de 'used': el arreglo publicado tiene lugar para el slot
+            Slot* slot = published_.load(memory_order_acquire) + index;
+            atomic_ref<uint32_t> seq(slot->version);
+            uint32_t before = seq.load(memory_order_acquire);
+            if (before & 1) continue;
+            memcpy(&out, slot, sizeof(Slot));
+            copy(static_cast<const Slot&>(out));
+            atomic_thread_fence(memory_order_acquire);
+            if (seq.load(memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    // Recorre los slots vivos en orden de índice: fn(índice, slot)
+    template <typename F>
+    void forEachLive(F&& fn) const {
+        for (uint32_t i = 0; i < state_->used; i++) {
+            if (slots_[i].flags & SLOT_LIVE) fn(i, slots_[i]);
+        }
+    }
+
+    // Quita 'mask' de los flags de todos los slots (por ejemplo, leases de otra ejecución)
+    void clearFlags(uint8_t mask) {
+        for (uint32_t i = 0; i < state_->used; i++) {
+            slots_[i].flags &= static_cast<uint8_t>(~mask);
+        }
+    }
+
+    size_t liveCount() const { return static_cast<size_t>(state_->live); }
+
+    // Bytes que ocupan los slots (los liberados y los arreglos retirados también: la tabla no
+    // se achica)
+    size_t metadataBytes() const {
+        return (external_ ? state_->used : capacity_ + retiredSlots_) * sizeof(Slot);
+    }
+
+private:
+    // Pasa la memoria propia a un arreglo de al menos 'needed' slots (y a lo sumo maxSlots_).
+    // El anterior se retira sin liberarlo, con sus slots en versión impar para que los lectores
+    // que lo estaban usando reintenten sobre el nuevo.
+    void grow(uint32_t needed) {
+        uint32_t capacity = max(needed, min(maxSlots_, max<uint32_t>(64, capacity_ * 2)));
+        unique_ptr<Slot[]> slots(new Slot[capacity]());
+        if (state_->used > 0) memcpy(slots.get(), slots_, state_->used * sizeof(Slot));
+        Slot* old = slots_;
+        slots_ = slots.get();
+        published_.store(slots_, memory_order_release);
+        for (uint32_t i = 0; i < state_->used; i++) {
+            atomic_ref<uint32_t>(old[i].version).store(old[i].version | 1, memory_order_release);
+        }
+        if (owned_) {
+            retired_.push_back(move(owned_));
+            retiredSlots_ += capacity_;
+        }
+        owned_ = move(slots);
+        capacity_ = capacity;
+    }
+
+    // El final de la cola libre no se guarda en State (que va tal cual al archivo y a los
+    // snapshots): se busca recorriendo la cola al cargar, con a lo sumo 'used' pasos
+    void findFreeTail() {
+        freeTail_ = kNone;
+        uint32_t index = state_->freeHead;
+        for (uint32_t steps = 0; index != kNone && index < state_->used && steps < state_->used; steps++) {
+            freeTail_ = index;
+            index = static_cast<uint32_t>(slots_[index].offset);
+        }
+    }
+
+    // Una versión impar en una tabla cargada es una escritura que no terminó (el proceso se
+    // cortó con el mutex tomado); se deja par para que los lectores sin lock no la esperen
+    void settleVersions() {
+        for (uint32_t i = 0; i < state_->used; i++) {
+            slots_[i].version += slots_[i].version & 1;
+        }
+    }
+
+    unique_ptr<Slot[]> owned_;
+    uint32_t capacity_;
+    vector<unique_ptr<Slot[]>> retired_;
+    size_t retiredSlots_;
+    State ownedState_;
+    // Apuntan a owned_/ownedState_ o a la memoria externa
+    State* state_;
+    Slot* slots_;
+    // Último slot de la cola libre (kNone si está vacía)
+    uint32_t freeTail_;
+    // slots_ para los lectores sin lock
+    atomic<Slot*> published_;
+    uint32_t maxSlots_;
+    bool external_;
+};
+
+#endif // HANDLE_TABLE_H
@@ -0,0 +1,200 @@
+#include "LeaseTable.h"
+#include <algorithm>
+#include <thread>
+
+// Usamos namespace std
+using namespace std;
+
+// ----------------------------------------------------------------------------------
+// Constructor
+// ----------------------------------------------------------------------------------
+thread_local vector<pair<int, LeaseTable::Holder>> LeaseTable::pending_;
+
+LeaseTable::LeaseTable() : nextSubscriber_(1), nextNotice_(1), duration_(kDefaultDuration) {
+}
+
+// ----------------------------------------------------------------------------------
+// Suscriptores
+// ----------------------------------------------------------------------------------
+uint32_t LeaseTable::subscribe(SOCKET sock, Notifier notify) {
+    lock_guard<mutex> lock(mtx_);
+    uint32_t id = nextSubscriber_++;
+    if (nextSubscriber_ == 0) nextSubscriber_ = 1;
+    subscribers_[id] = Subscriber{ sock, move(notify), 0 };
+    return id;
+}
+
+void LeaseTable::unsubscribe(SOCKET sock) {
+    vector<shared_ptr<Wait>> released;
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = find_if(subscribers_.begin(), subscribers_.end(), [sock](const auto& kv) {
+            return kv.second.sock == sock;
+        });
+        if (it == subscribers_.end()) return;
+        // Sus leases quedan huérfanos y se descartan en el próximo invalidate/grant
+        uint32_t id = it->first;
+        subscribers_.erase(it);
+        for (auto n = notices_.begin(); n != notices_.end();) {
+            if (n->second.subscriber == id) {
+                released.push_back(move(n->second.wait));
+                n = notices_.erase(n);
+            }
+            else {
+                ++n;
+            }
+        }
+    }
+    for (auto& wait : released) {
+        wait->confirm();
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Entrega un lease (o lo renueva si el suscriptor ya tenía uno sobre el bloque)
+// ----------------------------------------------------------------------------------
+bool LeaseTable::grant(int blockID, uint32_t subscriber) {
+    lock_guard<mutex> lock(mtx_);
+    if (subscribers_.find(subscriber) == subscribers_.end()) return false;
+
+    auto now = chrono::steady_clock::now();
+    vector<Holder>& holders = leases_[blockID];
+    // Se aprovecha para descartar leases vencidos o de suscriptores que ya no existen
+    holders.erase(remove_if(holders.begin(), holders.end(), [&](const Holder& h) {
+        return h.expiry <= now || subscribers_.find(h.subscriber) == subscribers_.end();
+    }), holders.end());
+    for (Holder& h : holders) {
+        if (h.subscriber == subscriber) {
+            h.expiry = now + duration_;
+            return true;
+        }
+    }
+    holders.push_back(Holder{ subscriber, now + duration_ });
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Olvida los leases del bloque; los vigentes quedan como avisos pendientes del hilo
+// ----------------------------------------------------------------------------------
+void LeaseTable::invalidate(int blockID) {
+    lock_guard<mutex> lock(mtx_);
+    auto it = leases_.find(blockID);
+    if (it == leases_.end()) return;
+
+    auto now = chrono::steady_clock::now();
+    for (const Holder& h : it->second) {
+        if (h.expiry > now) pending_.emplace_back(blockID, h);
+    }
+    leases_.erase(it);
+}
+
+// ----------------------------------------------------------------------------------
+// Encola los avisos pendientes del hilo (fuera de los locks de los shards)
+// ----------------------------------------------------------------------------------
+shared_ptr<LeaseTable::Wait> LeaseTable::notify(function<void()> wake) {
+    if (pending_.empty()) return nullptr;
+
+    auto wait = make_shared<Wait>();
+    bool waiting = false;
+    {
+        lock_guard<mutex> lock(mtx_);
+        // Mientras se tenga mtx_ nadie puede confirmar estos avisos (confirm() los busca con él)
+        lock_guard<mutex> waitLock(wait->mtx_);
+        wait->wake_ = move(wake);
+        auto now = chrono::steady_clock::now();
+        for (const auto& entry : pending_) {
+            const Holder& h = entry.second;
+            if (h.expiry <= now) continue;
+            auto sub = subscribers_.find(h.subscriber);
+            // Un suscriptor que ya se fue vació su caché al perder la conexión
+            if (sub == subscribers_.end()) continue;
+            waiting = true;
+            if (sub->second.unconfirmed >= kMaxUnconfirmed) {
+                // No se le puede avisar: la respuesta espera a que venza su lease
+                wait->notBefore_ = max(wait->notBefore_, h.expiry);
+                continue;
+            }
+
+            // El aviso es un encabezado sin payload; requestId identifica la confirmación
+            uint32_t id = nextNotice_++;
+            protocol::Header header;
+            header.opcode = protocol::OP_INVALIDATE;
+            header.requestId = id;
+            header.blockId = entry.first;
+            string frame(protocol::kHeaderSize, '\0');
+            protocol::encodeHeader(header, &frame[0]);
+
+            notices_[id] = Notice{ h.subscriber, wait };
+            sub->second.unconfirmed++;
+            wait->unconfirmed_++;
+            wait->confirmBy_ = max(wait->confirmBy_, h.expiry);
+            sub->second.notify(move(frame));
+        }
+    }
+    pending_.clear();
+    return waiting ? wait : nullptr;
+}
+
+// ----------------------------------------------------------------------------------
+// Confirmación de un aviso por parte de su suscriptor
+// ----------------------------------------------------------------------------------
+void LeaseTable::confirm(SOCKET sock, uint32_t notice) {
+    shared_ptr<Wait> wait;
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = notices_.find(notice);
+        if (it == notices_.end()) return;
+        auto sub = subscribers_.find(it->second.subscriber);
+        if (sub == subscribers_.end() || sub->second.sock != sock) return;
+        sub->second.unconfirmed--;
+        wait = move(it->second.wait);
+        notices_.erase(it);
+    }
+    wait->confirm();
+}
+
+// ----------------------------------------------------------------------------------
+// Espera de la respuesta a una escritura
+// ----------------------------------------------------------------------------------
+bool LeaseTable::Wait::done() const {
+    lock_guard<mutex> lock(mtx_);
+    auto now = chrono::steady_clock::now();
+    return now >= notBefore_ && (unconfirmed_ == 0 || now >= confirmBy_);
+}
+
+void LeaseTable::Wait::wait() const {
+    unique_lock<mutex> lock(mtx_);
+    cv_.wait_until(lock, confirmBy_, [this]() { return unconfirmed_ == 0; });
+    auto notBefore = notBefore_;
+    lock.unlock();
+    this_thread::sleep_until(notBefore);
+}
+
+void LeaseTable::Wait::confirm() {
+    function<void()> wake;
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (unconfirmed_ == 0 || --unconfirmed_ > 0) return;
+        wake = wake_;
+    }
+    cv_.notify_all();
+    if (wake) wake();
+}
+
+// ----------------------------------------------------------------------------------
+// Configuración y consultas
+// ----------------------------------------------------------------------------------
+void LeaseTable::setDuration(chrono::milliseconds duration) {
+    lock_guard<mutex> lock(mtx_);
+    duration_ = duration;
+}
+
+chrono::milliseconds LeaseTable::duration() const {
+    lock_guard<mutex> lock(mtx_);
+    return duration_;
+}
+
+size_t LeaseTable::leasedBlocks() const {
+    lock_guard<mutex> lock(mtx_);
+    return leases_.size();
+}
@@ -0,0 +1,131 @@
+#ifndef LEASE_TABLE_H
+#define LEASE_TABLE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Protocol.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  LeaseTable: leases de lectura que el servidor entrega a los cachés de los clientes.
+
+  Un cliente que quiere cachear abre una conexión de suscripción (OP_SUBSCRIBE) y recibe un
+  número de suscriptor. Cada lectura con lease (OP_GET_LEASE) registra que ese suscriptor
+  puede usar el valor leído durante leaseDuration sin volver a preguntar. Cuando un bloque con
+  leases vigentes se modifica (o se libera), cada suscriptor recibe un OP_INVALIDATE por su
+  conexión de suscripción y lo confirma devolviendo el mismo mensaje.
+
+  La escritura solo registra los avisos (invalidate(), con el mutex del shard tomado); el hilo
+  que la hizo los encola con notify() ya sin locks, en el reactor de cada suscriptor, y recibe
+  una Wait: la respuesta al que escribió sale cuando todos confirmaron o, si alguno no
+  contesta, cuando vence su lease. Un suscriptor con demasiados avisos sin confirmar
+  (kMaxUnconfirmed) no recibe más: sus leases se esperan hasta que vencen. Así el que escribió
+  nunca recibe OK mientras otro cliente puede seguir usando el valor viejo.
+
+  Es thread-safe; invalidate() y grant() se llaman con el mutex del shard del bloque tomado,
+  así que no se cruzan para un mismo bloque.
+*/
+class LeaseTable {
+public:
+    // Duración de los leases por defecto
+    static constexpr chrono::milliseconds kDefaultDuration{ 2000 };
+
+    LeaseTable();
+
+    // Máximo de avisos sin confirmar por suscriptor
+    static constexpr size_t kMaxUnconfirmed = 1024;
+
+    // Envía un aviso ya codificado por la conexión del suscriptor (sin bloquear). Se llama con
+    // el mutex de la tabla tomado, así que no debe volver a entrar en la tabla.
+    using Notifier = function<void(string)>;
+
+    // Lo que espera la respuesta a una escritura que invalidó leases
+    class Wait {
+    public:
+        // true cuando todos los avisados confirmaron (o vencieron sus leases) y vencieron los
+        // leases de los que no se pudo avisar
+        bool done() const;
+        // Bloquea hasta done()
+        void wait() const;
+
+    private:
+        friend class LeaseTable;
+        void confirm();
+
+        mutable mutex mtx_;
+        mutable condition_variable cv_;
+        size_t unconfirmed_ = 0;
+        // Vencimiento del último lease avisado: después ya no hace falta la confirmación
+        chrono::steady_clock::time_point confirmBy_;
+        // Vencimiento del último lease del que no se pudo avisar
+        chrono::steady_clock::time_point notBefore_;
+        // Se llama al llegar la última confirmación (despierta al reactor del que escribió)
+        function<void()> wake_;
+    };
+
+    // Registra la conexión de suscripción y retorna su número (nunca 0)
+    uint32_t subscribe(SOCKET sock, Notifier notify);
+
+    // Olvida al suscriptor de esa conexión (se llama antes de cerrarla). El cliente vacía su
+    // caché al perderla, así que sus avisos pendientes se dan por confirmados.
+    void unsubscribe(SOCKET sock);
+
+    // Entrega un lease sobre el bloque; false si el suscriptor no existe
+    bool grant(int blockID, uint32_t subscriber);
+
+    // Olvida los leases vigentes sobre el bloque y deja sus avisos pendientes en el hilo actual
+    void invalidate(int blockID);
+
+    // Encola los avisos pendientes del hilo actual. Retorna nullptr si no hay nada que esperar;
+    // si no, la espera de la respuesta, que llama a 'wake' (si hay) al completarse
+    shared_ptr<Wait> notify(function<void()> wake);
+
+    // Confirmación de un aviso, recibida por la conexión de suscripción 'sock'
+    void confirm(SOCKET sock, uint32_t notice);
+
+    void setDuration(chrono::milliseconds duration);
+    chrono::milliseconds duration() const;
+
+    // Cantidad de bloques con leases registrados
+    size_t leasedBlocks() const;
+
+private:
+    struct Holder {
+        uint32_t subscriber;
+        chrono::steady_clock::time_point expiry;
+    };
+
+    struct Subscriber {
+        SOCKET sock;
+        Notifier notify;
+        size_t unconfirmed;
+    };
+
+    // Aviso enviado que espera la confirmación del suscriptor
+    struct Notice {
+        uint32_t subscriber;
+        shared_ptr<Wait> wait;
+    };
+
+    // Avisos de las escrituras del hilo que todavía no se encolaron (ver notify())
+    static thread_local vector<pair<int, Holder>> pending_;
+
+    mutable mutex mtx_;
+    unordered_map<uint32_t, Subscriber> subscribers_;
+    unordered_map<int, vector<Holder>> leases_;
+    unordered_map<uint32_t, Notice> notices_;
+    uint32_t nextSubscriber_;
+    uint32_t nextNotice_;
+    chrono::milliseconds duration_;
+};
+
+#endif // LEASE_TABLE_H
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Socket.h"
+#include "../Protocol.h"
+#include "../Metrics.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  LoadGenerator: genera carga contra un MemoryManagerServer y mide rendimiento y latencia.
+
+  Abre --connections conexiones binarias repartidas entre --threads hilos. Cada hilo envía una
+  petición por cada una de sus conexiones y después lee las respuestas (tantas peticiones en
+  vuelo como conexiones tenga), eligiendo cada vez la operación según --mix y el bloque según
+  --dist: uniforme o Zipf (pocos bloques muy usados, como un caché real).
+
+  Antes de medir se crean --blocks bloques int. Sobre ellos:
+    - set y get escriben y leen el bloque elegido;
+    - increase suma una referencia al bloque elegido y el hilo la recuerda;
+    - decrease suelta una de las referencias que el hilo tiene (si no tiene, hace un increase);
+    - create crea un bloque nuevo, que queda como referencia del hilo.
+  Al terminar se sueltan todas las referencias, así que una mezcla con más create/increase
+  que decrease hace crecer la memoria usada solo mientras dura la prueba.
+
+  La latencia de cada operación se cuenta desde que se envía hasta que llega su respuesta, en
+  histogramas como los del comando "stats" del servidor; los primeros --warmup segundos no se
+  cuentan. El resultado va a la salida estándar en CSV o JSON (--format); el avance, a stderr.
+
+  Uso: LoadGenerator [--host 127.0.0.1] [--port 8080] [--connections 8] [--threads 4]
+                     [--duration 10] [--warmup 1] [--blocks 10000]
+                     [--mix create=5,set=30,get=60,increase=3,decrease=2]
+                     [--dist uniform|zipf] [--theta 0.99] [--format csv|json] [--seed 1]
+*/
+
+enum OpKind { CREATE, SET, GET, INCREASE, DECREASE, kOpCount };
+static const char* const kOpNames[kOpCount] = { "create", "set", "get", "increase", "decrease" };
+
+struct Config {
+    string host = "127.0.0.1";
+    int port = 8080;
+    size_t connections = 8;
+    size_t threads = 4;
+    double duration = 10.0;
+    double warmup = 1.0;
+    size_t blocks = 10000;
+    double mix[kOpCount] = { 5, 30, 60, 3, 2 };
+    bool zipf = false;
+    double theta = 0.99;
+    bool json = false;
+    uint64_t seed = 1;
+};
+
+// ----------------------------------------------------------------------------------
+// Argumentos
+// ----------------------------------------------------------------------------------
+// "create=5,set=30,get=60": las operaciones que no aparecen quedan en 0
+static bool parseMix(const string& text, double mix[kOpCount]) {
+    fill(mix, mix + kOpCount, 0.0);
+    istringstream iss(text);
+    string item;
+    double total = 0;
+    while (getline(iss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string name = item.substr(0, eq);
+        auto it = find(begin(kOpNames), end(kOpNames), name);
+        if (it == end(kOpNames)) return false;
+        double weight = stod(item.substr(eq + 1));
+        if (weight < 0) return false;
+        mix[it - begin(kOpNames)] = weight;
+        total += weight;
+    }
+    return total > 0;
+}
+
+static bool parseArguments(int argc, char** argv, Config& config) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        string value = argv[++i];
+        if (arg == "--host") config.host = value;
+        else if (arg == "--port") config.port = stoi(value);
+        else if (arg == "--connections") config.connections = stoul(value);
+        else if (arg == "--threads") config.threads = stoul(value);
+        else if (arg == "--duration") config.duration = stod(value);
+        else if (arg == "--warmup") config.warmup = stod(value);
+        else if (arg == "--blocks") config.blocks = stoul(value);
+        else if (arg == "--mix") {
+            if (!parseMix(value, config.mix)) return false;
+        }
+        else if (arg == "--dist") {
+            if (value != "uniform" && value != "zipf") return false;
+            config.zipf = value == "zipf";
+        }
+        else if (arg == "--theta") config.theta = stod(value);
+        else if (arg == "--format") {
+            if (value != "csv" && value != "json") return false;
+            config.json = value == "json";
+        }
+        else if (arg == "--seed") config.seed = stoull(value);
+        else return false;
+    }
+    config.threads = min(config.threads, config.connections);
+    return config.port > 0 && config.connections > 0 && config.threads > 0 && config.blocks >= 2
+        && config.duration > config.warmup && config.warmup >= 0 && config.theta > 0 && config.theta < 1;
+}
+
+// ----------------------------------------------------------------------------------
+// Distribución Zipf (método de Gray et al., el mismo de YCSB): el rango 0 es el más pedido
+// ----------------------------------------------------------------------------------
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double theta) : n_(n) {
+        zetaN_ = zeta(n, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        eta_ = (1.0 - pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta(2, theta) / zetaN_);
+        half_ = 1.0 + pow(0.5, theta);
+    }
+
+    size_t next(mt19937_64& rng) const {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetaN_;
+        if (uz < 1.0) return 0;
+        if (uz < half_) return 1;
+        size_t rank = static_cast<size_t>(static_cast<double>(n_) * pow(eta_ * u - eta_ + 1.0, alpha_));
+        return min(rank, n_ - 1);
+    }
+
+private:
+    static double zeta(size_t n, double theta) {
+        double sum = 0;
+        for (size_t i = 1; i <= n; i++) sum += 1.0 / pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+    size_t n_;
+    double zetaN_;
+    double alpha_;
+    double eta_;
+    double half_;
+};
+
+// ----------------------------------------------------------------------------------
+// Conexiones
+// ----------------------------------------------------------------------------------
+static SOCKET openBinary(const Config& config) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config.port));
+    inet_pton(AF_INET, config.host.c_str(), &address.sin_addr);
+    string reply;
+    if (connect(sock, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR
+        || !protocol::sendFrame(sock, protocol::kBinaryHello) || !protocol::recvFrame(sock, reply)
+        || reply != protocol::kBinaryHello) {
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    protocol::setNoDelay(sock);
+    return sock;
+}
+
+static void setCreate(protocol::Message& msg) {
+    msg.header.opcode = protocol::OP_CREATE;
+    msg.header.blockId = -1;
+    msg.payload.resize(4);
+    protocol::putU32(&msg.payload[0], sizeof(int32_t));
+    msg.payload += "int";
+}
+
+// Crea los bloques de la prueba en lotes; vector vacío si el servidor no pudo crearlos
+static vector<int> createBlocks(SOCKET sock, size_t count) {
+    vector<int> ids;
+    ids.reserve(count);
+    while (ids.size() < count) {
+        uint32_t n = static_cast<uint32_t>(min<size_t>(count - ids.size(), 4096));
+        protocol::Message batch, op;
+        batch.header.opcode = protocol::OP_BATCH;
+        batch.payload.resize(4);
+        protocol::putU32(&batch.payload[0], n);
+        for (uint32_t i = 0; i < n; i++) {
+            setCreate(op);
+            protocol::appendMessage(batch.payload, op);
+        }
+        if (!protocol::sendMessage(sock, batch) || !protocol::recvMessage(sock, batch)) return {};
+        size_t pos = 4;
+        for (uint32_t i = 0; i < n; i++) {
+            if (!protocol::readMessage(batch.payload, pos, op) || op.header.status != protocol::STATUS_OK) return {};
+            ids.push_back(op.header.blockId);
+        }
+    }
+    return ids;
+}
+
+// Aplica 'delta' a cada bloque con mensajes refdelta
+static bool adjustRefs(SOCKET sock, const vector<int>& ids, int32_t delta) {
+    for (size_t first = 0; first < ids.size(); first += protocol::kMaxBatchOps) {
+        size_t n = min<size_t>(ids.size() - first, protocol::kMaxBatchOps);
+        protocol::Message msg;
+        msg.header.opcode = protocol::OP_REFDELTA;
+        msg.payload.resize(4 + n * 8);
+        protocol::putU32(&msg.payload[0], static_cast<uint32_t>(n));
+        for (size_t i = 0; i < n; i++) {
+            protocol::putU32(&msg.payload[4 + i * 8], static_cast<uint32_t>(ids[first + i]));
+            protocol::putU32(&msg.payload[8 + i * 8], static_cast<uint32_t>(delta));
+        }
+        if (!protocol::sendMessage(sock, msg) || !protocol::recvMessage(sock, msg)) return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Hilos de carga
+// ----------------------------------------------------------------------------------
+struct ThreadResult {
+    unique_ptr<Histogram> latency[kOpCount];
+    uint64_t errors[kOpCount] = {};
+    bool failed = false;
+
+    ThreadResult() {
+        for (auto& h : latency) h = make_unique<Histogram>();
+    }
+};
+
+struct Pending {
+    OpKind op = GET;
+    uint64_t sentAt = 0;
+};
+
+static void runWorker(const Config& config, size_t index, vector<SOCKET> socks, const vector<int>& pool,
+    const ZipfGenerator* zipf, uint64_t measureFrom, uint64_t deadline, ThreadResult& result) {
+    mt19937_64 rng(config.seed * 7919 + index);
+    discrete_distribution<int> pickOp(begin(config.mix), end(config.mix));
+    uniform_int_distribution<size_t> pickUniform(0, pool.size() - 1);
+    // Referencias que este hilo tiene (increase y create) y suelta con decrease
+    vector<int> held;
+    vector<Pending> pending(socks.size());
+    protocol::Message msg;
+    uint32_t requestId = 1;
+
+    while (Metrics::nowNs() < deadline) {
+        for (size_t c = 0; c < socks.size(); c++) {
+            OpKind op = static_cast<OpKind>(pickOp(rng));
+            if (op == DECREASE && held.empty()) op = INCREASE;
+            int block = pool[zipf ? zipf->next(rng) : pickUniform(rng)];
+
+            msg.header.requestId = requestId++;
+            msg.header.blockId = block;
+            msg.payload.clear();
+            switch (op) {
+            case CREATE:
+                setCreate(msg);
+                break;
+            case SET:
+                msg.header.opcode = protocol::OP_SET;
+                msg.payload.resize(4);
+                protocol::putU32(&msg.payload[0], static_cast<uint32_t>(requestId));
+                break;
+            case GET:
+                msg.header.opcode = protocol::OP_GET;
+                break;
+            case INCREASE:
+                msg.header.opcode = protocol::OP_INCREASE;
+                held.push_back(block);
+                break;
+            case DECREASE: {
+                size_t i = uniform_int_distribution<size_t>(0, held.size() - 1)(rng);
+                msg.header.opcode = protocol::OP_DECREASE;
+                msg.header.blockId = held[i];
+                held[i] = held.back();
+                held.pop_back();
+                break;
+            }
+            default:
+                break;
+            }
+            pending[c].op = op;
+            pending[c].sentAt = Metrics::nowNs();
+            if (!protocol::sendMessage(socks[c], msg)) {
+                result.failed = true;
+                return;
+            }
+        }
+        for (size_t c = 0; c < socks.size(); c++) {
+            if (!protocol::recvMessage(socks[c], msg)) {
+                result.failed = true;
+                return;
+            }
+            uint64_t now = Metrics::nowNs();
+            OpKind op = pending[c].op;
+            bool ok = msg.header.status == protocol::STATUS_OK;
+            if (op == CREATE && ok) held.push_back(msg.header.blockId);
+            if (pending[c].sentAt >= measureFrom) {
+                result.latency[op]->record(now - pending[c].sentAt);
+                if (!ok) result.errors[op]++;
+            }
+        }
+    }
+    // Se sueltan las referencias que quedaron (los bloques creados se liberan)
+    if (!held.empty() && !adjustRefs(socks[0], held, -1)) result.failed = true;
+}
+
+// ----------------------------------------------------------------------------------
+// Resultados
+// ----------------------------------------------------------------------------------
+// Una fila del resultado: una operación o el total
+struct Row {
+    const char* name;
+    const Histogram* latency;
+    uint64_t errors;
+};
+
+static void writeCsv(const vector<Row>& rows, double seconds) {
+    cout << "op,count,errors,ops_per_sec,mean_ns,p50_ns,p99_ns,p999_ns,max_ns\n";
+    for (const Row& row : rows) {
+        const Histogram& h = *row.latency;
+        cout << row.name << "," << h.count() << "," << row.errors << ","
+             << fixed << setprecision(1) << h.count() / seconds << "," << setprecision(0) << h.mean() << ","
+             << h.percentile(0.5) << "," << h.percentile(0.99) << "," << h.percentile(0.999) << ","
+             << h.maxValue() << "\n";
+    }
+}
+
+static void writeJson(const Config& config, const vector<Row>& rows, double seconds) {
+    cout << "{\"config\":{\"connections\":" << config.connections << ",\"threads\":" << config.threads
+         << ",\"durationS\":" << config.duration << ",\"warmupS\":" << config.warmup
+         << ",\"blocks\":" << config.blocks << ",\"distribution\":\"" << (config.zipf ? "zipf" : "uniform") << "\"";
+    if (config.zipf) cout << ",\"theta\":" << config.theta;
+    cout << ",\"mix\":{";
+    for (size_t i = 0; i < kOpCount; i++) {
+        cout << (i ? "," : "") << "\"" << kOpNames[i] << "\":" << config.mix[i];
+    }
+    cout << "}},\"results\":{";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Histogram& h = *rows[i].latency;
+        cout << (i ? "," : "") << "\"" << rows[i].name << "\":{\"count\":" << h.count()
+             << ",\"errors\":" << rows[i].errors << ",\"opsPerSec\":" << fixed << setprecision(1) << h.count() / seconds
+             << ",\"meanNs\":" << setprecision(0) << h.mean() << ",\"p50Ns\":" << h.percentile(0.5)
+             << ",\"p99Ns\":" << h.percentile(0.99) << ",\"p999Ns\":" << h.percentile(0.999)
+             << ",\"maxNs\":" << h.maxValue() << "}";
+    }
+    cout << "}}\n";
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    if (!parseArguments(argc, argv, config)) {
+        cerr << "Uso: " << argv[0]
+             << " [--host <ip>] [--port <puerto>] [--connections <N>] [--threads <N>]"
+             << " [--duration <s>] [--warmup <s>] [--blocks <N>]"
+             << " [--mix create=5,set=30,get=60,increase=3,decrease=2] [--dist uniform|zipf]"
+             << " [--theta <0..1>] [--format csv|json] [--seed <N>]" << endl;
+        return 1;
+    }
+    if (!net::startup()) {
+        cerr << "[CARGA] No se pudo inicializar los sockets." << endl;
+        return 1;
+    }
+    net::raiseDescriptorLimit();
+
+    vector<SOCKET> socks;
+    for (size_t i = 0; i < config.connections; i++) {
+        SOCKET sock = openBinary(config);
+        if (sock == INVALID_SOCKET) {
+            cerr << "[CARGA] No se pudo conectar a " << config.host << ":" << config.port
+                 << " con el protocolo binario." << endl;
+            for (SOCKET s : socks) closesocket(s);
+            net::cleanup();
+            return 1;
+        }
+        socks.push_back(sock);
+    }
+
+    cerr << "[CARGA] Creando " << config.blocks << " bloques..." << endl;
+    vector<int> pool = createBlocks(socks[0], config.blocks);
+    if (pool.empty()) {
+        cerr << "[CARGA] El servidor no pudo crear los bloques (¿--memsize muy chico?)." << endl;
+        for (SOCKET s : socks) closesocket(s);
+        net::cleanup();
+        return 1;
+    }
+    // Los rangos de Zipf se asignan a bloques al azar para que los más usados no caigan juntos
+    mt19937_64 shuffler(config.seed);
+    shuffle(pool.begin(), pool.end(), shuffler);
+    unique_ptr<ZipfGenerator> zipf;
+    if (config.zipf) zipf = make_unique<ZipfGenerator>(pool.size(), config.theta);
+
+    cerr << "[CARGA] " << config.connections << " conexiones, " << config.threads << " hilos, "
+         << config.duration << " s (" << config.warmup << " s de calentamiento)..." << endl;
+    uint64_t start = Metrics::nowNs();
+    uint64_t measureFrom = start + static_cast<uint64_t>(config.warmup * 1e9);
+    uint64_t deadline = start + static_cast<uint64_t>(config.duration * 1e9);
+    vector<ThreadResult> results(config.threads);
+    vector<thread> workers;
+    for (size_t t = 0; t < config.threads; t++) {
+        // Las conexiones se reparten en orden: el hilo t toma t, t + threads, ...
+        vector<SOCKET> own;
+        for (size_t c = t; c < socks.size(); c += config.threads) own.push_back(socks[c]);
+        workers.emplace_back(runWorker, cref(config), t, move(own), cref(pool), zipf.get(), measureFrom, deadline,
+            ref(results[t]));
+    }
+    for (thread& worker : workers) worker.join();
+    double seconds = static_cast<double>(Metrics::nowNs() - measureFrom) / 1e9;
+
+    bool failed = false;
+    Histogram totals[kOpCount + 1];
+    uint64_t errors[kOpCount + 1] = {};
+    for (ThreadResult& result : results) {
+        failed = failed || result.failed;
+        for (size_t i = 0; i < kOpCount; i++) {
+            totals[i].merge(*result.latency[i]);
+            totals[kOpCount].merge(*result.latency[i]);
+            errors[i] += result.errors[i];
+            errors[kOpCount] += result.errors[i];
+        }
+    }
+    if (failed) cerr << "[CARGA] Aviso: se perdió la conexión con el servidor durante la prueba." << endl;
+
+    // Se quitan de la tabla las operaciones que la mezcla no incluía
+    vector<Row> rows;
+    for (size_t i = 0; i < kOpCount; i++) {
+        if (totals[i].count() > 0) rows.push_back({ kOpNames[i], &totals[i], errors[i] });
+    }
+    rows.push_back({ "total", &totals[kOpCount], errors[kOpCount] });
+    if (config.json) writeJson(config, rows, seconds);
+    else writeCsv(rows, seconds);
+
+    adjustRefs(socks[0], pool, -1);
+    for (SOCKET s : socks) closesocket(s);
+    net::cleanup();
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,159 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <winsock2.h>
+#include <windows.h>
+#include <winioctl.h>
+#endif
+
+// Usamos namespace std
+using namespace std;
+
+// ----------------------------------------------------------------------------------
+// Constructor y destructor
+// ----------------------------------------------------------------------------------
+MappedFile::MappedFile()
+#ifdef _WIN32
+    : file_(INVALID_HANDLE_VALUE), mapping_(NULL),
+#else
+    : fd_(-1),
+#endif
+      data_(nullptr), size_(0) {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifndef _WIN32
+// ----------------------------------------------------------------------------------
+// POSIX: open + ftruncate (disperso) + mmap MAP_SHARED
+// ----------------------------------------------------------------------------------
+bool MappedFile::open(const string& path, size_t size, bool& created) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        cerr << "MappedFile: No se pudo abrir '" << path << "'." << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        close();
+        return false;
+    }
+    created = st.st_size == 0;
+    if (created) {
+        // ftruncate deja un archivo disperso: los bloques se reservan al escribirlos
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            cerr << "MappedFile: No se pudo dar " << size << " bytes a '" << path << "'." << endl;
+            close();
+            return false;
+        }
+    }
+    else {
+        size = static_cast<size_t>(st.st_size);
+    }
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+        cerr << "MappedFile: Error en mmap de '" << path << "'." << endl;
+        close();
+        return false;
+    }
+    data_ = static_cast<char*>(addr);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        msync(data_, size_, MS_SYNC);
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool MappedFile::flush() {
+    return data_ == nullptr || msync(data_, size_, MS_ASYNC) == 0;
+}
+
+#else
+// ----------------------------------------------------------------------------------
+// Windows: CreateFile + archivo disperso + CreateFileMapping/MapViewOfFile
+// ----------------------------------------------------------------------------------
+bool MappedFile::open(const string& path, size_t size, bool& created) {
+    close();
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        cerr << "MappedFile: No se pudo abrir '" << path << "'." << endl;
+        return false;
+    }
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file_, &current)) {
+        close();
+        return false;
+    }
+    created = current.QuadPart == 0;
+    if (created) {
+        // Disperso: las partes nunca escritas no ocupan disco
+        DWORD returned = 0;
+        DeviceIoControl(file_, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL);
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFilePointerEx(file_, end, NULL, FILE_BEGIN) || !SetEndOfFile(file_)) {
+            cerr << "MappedFile: No se pudo dar " << size << " bytes a '" << path << "'." << endl;
+            close();
+            return false;
+        }
+    }
+    else {
+        size = static_cast<size_t>(current.QuadPart);
+    }
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READWRITE, 0, 0, NULL);
+    if (mapping_ == NULL) {
+        cerr << "MappedFile: Error en CreateFileMapping de '" << path << "'." << endl;
+        close();
+        return false;
+    }
+    data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (data_ == nullptr) {
+        cerr << "MappedFile: Error en MapViewOfFile de '" << path << "'." << endl;
+        close();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        FlushViewOfFile(data_, 0);
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    if (mapping_ != NULL) {
+        CloseHandle(mapping_);
+        mapping_ = NULL;
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+}
+
+bool MappedFile::flush() {
+    return data_ == nullptr || FlushViewOfFile(data_, 0) != 0;
+}
+#endif
@@ -0,0 +1,53 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  MappedFile: archivo mapeado en memoria en modo compartido (mmap MAP_SHARED en POSIX,
+  CreateFileMapping/MapViewOfFile en Windows).
+
+  Lo que se escribe en la memoria mapeada llega al archivo sin llamadas explícitas: el sistema
+  escribe las páginas modificadas por su cuenta (y también si el proceso termina de golpe).
+  Las páginas se leen a demanda, así que el archivo puede ser más grande que la RAM. Un archivo
+  nuevo se crea disperso (sparse): las partes nunca escritas no ocupan disco.
+*/
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Abre y mapea el archivo completo. Si no existe (o está vacío) se crea con 'size' bytes
+    // y 'created' queda en true; si existe se mapea con su tamaño actual.
+    bool open(const string& path, size_t size, bool& created);
+
+    // Desmapea y cierra (escribiendo antes las páginas pendientes)
+    void close();
+
+    // Pide al sistema que escriba ya las páginas modificadas
+    bool flush();
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+    // HANDLE de Windows (como void* para no incluir windows.h antes que winsock2.h)
+    void* file_;
+    void* mapping_;
+#else
+    int fd_;
+#endif
+    char* data_;
+    size_t size_;
+};
+
+#endif // MAPPED_FILE_H
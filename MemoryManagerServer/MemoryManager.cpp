@@ -1,32 +1,90 @@
 #include "MemoryManager.h"
+#include "Snapshot.h"
+#include "Metrics.h"
 #include <iostream>
 #include <cstdlib>
-#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
 
 // Usamos namespace std
 using namespace std;
 
+// LSN del ltimo registro de log agregado por este hilo (lo espera syncLog)
+static thread_local uint64_t lastLogLsn = 0;
+
 // ----------------------------------------------------------------------------------
 // Funcin auxiliar para obtener la ruta de la carpeta del ejecutable.
 // Se utiliza para concatenar con el dumpFolder.
 // ----------------------------------------------------------------------------------
 static string getProjectDirectory() {
+#ifdef _WIN32
     char path[MAX_PATH];
     GetModuleFileNameA(NULL, path, MAX_PATH);
     string fullPath(path);
+#else
+    char path[PATH_MAX] = { 0 };
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    string fullPath(path, len > 0 ? static_cast<size_t>(len) : 0);
+#endif
     size_t lastSlash = fullPath.find_last_of("\\/");
     return fullPath.substr(0, lastSlash + 1);
 }
 
+// ----------------------------------------------------------------------------------
+// Archivo de respaldo: encabezado, State de la HandleTable de cada shard, slots de todos los
+// shards y, alineada a pgina, la arena. Todo sin punteros, para reabrirlo tal cual.
+// ----------------------------------------------------------------------------------
+static const char kArenaMagic[8] = { 'M', 'P', 'A', 'R', 'E', 'N', 'A', '1' };
+static constexpr uint32_t kArenaVersion = 1;
+static constexpr size_t kTypeNameSize = 32;
+static constexpr size_t kArenaPage = 4096;
+
+struct MemoryManager::ArenaHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t shardCount;
+    uint64_t arenaSize;
+    uint64_t arenaOffset;
+    uint32_t slotsPerShard;
+    uint32_t typeCount;
+    // Nombres de tipo internados, terminados en '\0'
+    char typeNames[kMaxTypes][kTypeNameSize];
+};
+
 // ----------------------------------------------------------------------------------
 // Constructor y destructor
 // ----------------------------------------------------------------------------------
 MemoryManager::MemoryManager()
-    : memoryBlock_(nullptr), totalSize_(0), usedSize_(0), nextID_(1) {
+    : memoryBlock_(nullptr), totalSize_(0), header_(nullptr), shardBits_(0), typeCount_(0), compactThreshold_(0.5),
+      checkpointLsn_(1), snapshotBusy_(false) {
+    // Los tipos conocidos quedan con el ndice de su TypeTag
+    for (int tag = 0; tag < TYPE_KNOWN_COUNT; tag++) {
+        internType(codecFor(static_cast<uint8_t>(tag)).name);
+    }
 }
 
 MemoryManager::~MemoryManager() {
-    if (memoryBlock_) {
+    // El hilo de dump lee la memoria al escribir instantneas: se detiene antes de liberarla
+    dumpWriter_.stop();
+    // Un snapshot en curso termina de escribirse (la copia o el hijo no dependen de la memoria)
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
+    wal_.close();
+    if (backing_.isOpen()) {
+        // La memoria es el archivo: basta con desmapearlo (escribe las pginas pendientes)
+        backing_.close();
+        header_ = nullptr;
+        memoryBlock_ = nullptr;
+    }
+    else if (memoryBlock_) {
         free(memoryBlock_);
         memoryBlock_ = nullptr;
     }
@@ -41,91 +99,393 @@ MemoryManager& MemoryManager::getInstance() {
 }
 
 // ----------------------------------------------------------------------------------
-// Inicializa el bloque principal de memoria
+// Inicializa el bloque principal de memoria y lo reparte entre los shards
 // ----------------------------------------------------------------------------------
-void MemoryManager::init(size_t totalSize) {
-    lock_guard<recursive_mutex> lock(mtx_);
+void MemoryManager::init(size_t totalSize, size_t shardCount, const string& backingPath) {
+    if (memoryBlock_) return;
+    if (shardCount == 0) shardCount = 1;
+    if (!backingPath.empty()) {
+        initBacked(totalSize, shardCount, backingPath);
+        return;
+    }
+
+    memoryBlock_ = malloc(totalSize);
     if (!memoryBlock_) {
-        memoryBlock_ = malloc(totalSize);
-        if (!memoryBlock_) {
-            cerr << "Error: No se pudo asignar memoria de "
-                << totalSize << " bytes." << endl;
-            return;
+        cerr << "Error: No se pudo asignar memoria de "
+            << totalSize << " bytes." << endl;
+        return;
+    }
+    totalSize_ = totalSize;
+
+    // Bits necesarios para codificar el ndice del shard en el ID
+    shardBits_ = 0;
+    while ((size_t(1) << shardBits_) < shardCount) shardBits_++;
+
+    // Cada shard recibe una porcin alineada a 8 bytes; el ltimo se queda con el resto.
+    // Los slots de todos los shards comparten los kIndexBits bits bajos del ID.
+    size_t slice = (totalSize / shardCount) & ~size_t(7);
+    uint32_t slotsPerShard = 1u << (kIndexBits - shardBits_);
+    for (size_t i = 0; i < shardCount; i++) {
+        auto shard = make_unique<Shard>();
+        shard->index = i;
+        shard->blocks.reset(slotsPerShard);
+        shard->base = i * slice;
+        shard->size = (i + 1 == shardCount) ? totalSize - shard->base : slice;
+        // Al inicio, toda la porcin est libre
+        shard->allocator.reset(shard->base, shard->size);
+        shards_.push_back(move(shard));
+    }
+
+    cout << "MemoryManager: Se ha reservado "
+        << totalSize << " bytes en " << shardCount << " shard(s)." << endl;
+}
+
+// ----------------------------------------------------------------------------------
+// Inicializa sobre un archivo mapeado: lo formatea si es nuevo o retoma su contenido
+// ----------------------------------------------------------------------------------
+bool MemoryManager::initBacked(size_t totalSize, size_t shardCount, const string& path) {
+    int bits = 0;
+    while ((size_t(1) << bits) < shardCount) bits++;
+    // Un shard no puede tener ms bloques vivos que unidades de su allocator; la tabla se
+    // dimensiona para ese mximo (en el archivo disperso solo ocupa disco lo que se usa)
+    uint32_t slotsPerShard = static_cast<uint32_t>(min<size_t>(size_t(1) << (kIndexBits - bits),
+        max<size_t>(64, totalSize / shardCount / Allocator::kAlignment)));
+    size_t tables = sizeof(ArenaHeader) + shardCount * sizeof(HandleTable::State)
+        + shardCount * size_t(slotsPerShard) * sizeof(HandleTable::Slot);
+    size_t arenaOffset = (tables + kArenaPage - 1) & ~(kArenaPage - 1);
+
+    bool created = false;
+    if (!backing_.open(path, arenaOffset + totalSize, created)) {
+        cerr << "Error: No se pudo usar el archivo de respaldo '" << path << "'." << endl;
+        return false;
+    }
+    header_ = reinterpret_cast<ArenaHeader*>(backing_.data());
+
+    if (created) {
+        memset(header_, 0, sizeof(ArenaHeader));
+        memcpy(header_->magic, kArenaMagic, sizeof(kArenaMagic));
+        header_->version = kArenaVersion;
+        header_->shardCount = static_cast<uint32_t>(shardCount);
+        header_->arenaSize = totalSize;
+        header_->arenaOffset = arenaOffset;
+        header_->slotsPerShard = slotsPerShard;
+        // Los tipos ya internados (los conocidos) quedan con el mismo ndice en el archivo
+        lock_guard<mutex> lock(typeMtx_);
+        size_t count = typeCount_.load(memory_order_relaxed);
+        for (size_t i = 0; i < count; i++) {
+            strncpy(header_->typeNames[i], typeNames_[i].c_str(), kTypeNameSize - 1);
+        }
+        header_->typeCount = static_cast<uint32_t>(count);
+    }
+    else {
+        // No se pisa un archivo que no sea una arena de esta versin
+        if (backing_.size() < sizeof(ArenaHeader) || memcmp(header_->magic, kArenaMagic, sizeof(kArenaMagic)) != 0
+            || header_->version != kArenaVersion || header_->shardCount == 0
+            || header_->arenaOffset + header_->arenaSize > backing_.size()
+            || header_->typeCount < TYPE_KNOWN_COUNT || header_->typeCount > kMaxTypes) {
+            cerr << "Error: '" << path << "' no es un archivo de respaldo vlido." << endl;
+            backing_.close();
+            header_ = nullptr;
+            return false;
         }
-        totalSize_ = totalSize;
-        usedSize_ = 0;
+        if (header_->arenaSize != totalSize || header_->shardCount != shardCount) {
+            cout << "MemoryManager: El archivo de respaldo tiene " << header_->arenaSize << " bytes en "
+                << header_->shardCount << " shard(s); se usa su configuracin." << endl;
+        }
+        shardCount = header_->shardCount;
+        totalSize = static_cast<size_t>(header_->arenaSize);
+        slotsPerShard = header_->slotsPerShard;
+        arenaOffset = static_cast<size_t>(header_->arenaOffset);
+        bits = 0;
+        while ((size_t(1) << bits) < shardCount) bits++;
 
-        // Al inicio, toda la memoria est libre
-        FreeBlock initialFree{ 0, totalSize };
-        freeBlocks_.push_back(initialFree);
+        // Los typeTag de los bloques guardados se refieren a la tabla de tipos del archivo
+        vector<string> names;
+        for (size_t i = 0; i < header_->typeCount; i++) {
+            names.emplace_back(header_->typeNames[i], strnlen(header_->typeNames[i], kTypeNameSize));
+        }
+        if (!loadTypeNames(names)) {
+            cerr << "Error: Los tipos de '" << path << "' no coinciden con los de este servidor." << endl;
+            backing_.close();
+            header_ = nullptr;
+            return false;
+        }
+    }
 
-        cout << "MemoryManager: Se ha reservado "
-            << totalSize << " bytes." << endl;
+    memoryBlock_ = backing_.data() + arenaOffset;
+    totalSize_ = totalSize;
+    shardBits_ = bits;
+
+    auto* states = reinterpret_cast<HandleTable::State*>(backing_.data() + sizeof(ArenaHeader));
+    auto* slots = reinterpret_cast<HandleTable::Slot*>(states + shardCount);
+    size_t slice = (totalSize / shardCount) & ~size_t(7);
+    size_t liveBlocks = 0;
+    for (size_t i = 0; i < shardCount; i++) {
+        auto shard = make_unique<Shard>();
+        shard->index = i;
+        shard->blocks.attach(&states[i], slots + i * slotsPerShard, slotsPerShard, created);
+        shard->base = i * slice;
+        shard->size = (i + 1 == shardCount) ? totalSize - shard->base : slice;
+        if (created) {
+            shard->allocator.reset(shard->base, shard->size);
+        }
+        else {
+            // Los leases eran de clientes de la ejecucin anterior
+            shard->blocks.clearFlags(HandleTable::SLOT_LEASED);
+            if (!rebuildShard(*shard, liveBlocks)) {
+                cerr << "Error: La tabla de bloques de '" << path << "' est daada." << endl;
+                shards_.clear();
+                backing_.close();
+                header_ = nullptr;
+                memoryBlock_ = nullptr;
+                totalSize_ = 0;
+                return false;
+            }
+        }
+        shards_.push_back(move(shard));
+    }
+
+    if (created) {
+        cout << "MemoryManager: Se cre el archivo de respaldo '" << path << "' con "
+            << totalSize << " bytes en " << shardCount << " shard(s)." << endl;
+    }
+    else {
+        cout << "MemoryManager: Se retom el archivo de respaldo '" << path << "' con "
+            << liveBlocks << " bloque(s) en " << totalSize << " bytes y " << shardCount << " shard(s)." << endl;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Recalcula el uso y los rangos libres de un shard a partir de sus bloques vivos
+// ----------------------------------------------------------------------------------
+bool MemoryManager::rebuildShard(Shard& shard, size_t& live) {
+    vector<pair<size_t, size_t>> used;
+    bool inside = true;
+    shard.usedSize = 0;
+    shard.blocks.forEachLive([&](uint32_t, const BlockInfo& info) {
+        size_t offset = static_cast<size_t>(info.offset);
+        if (offset < shard.base || offset + Allocator::roundUp(info.size) > shard.base + shard.size) {
+            inside = false;
+        }
+        used.emplace_back(offset, info.size);
+        shard.usedSize += Allocator::roundUp(info.size);
+    });
+    if (!inside) return false;
+    shard.allocator.rebuild(shard.base, shard.size, used);
+    live += used.size();
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Reemplaza la tabla de tipos (los conocidos deben quedar en su lugar)
+// ----------------------------------------------------------------------------------
+bool MemoryManager::loadTypeNames(const vector<string>& names) {
+    if (names.size() < TYPE_KNOWN_COUNT || names.size() > kMaxTypes) return false;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (i < TYPE_KNOWN_COUNT && names[i] != codecFor(static_cast<uint8_t>(i)).name) return false;
+        if (header_ != nullptr && names[i].size() >= kTypeNameSize) return false;
+    }
+
+    lock_guard<mutex> lock(typeMtx_);
+    for (size_t i = 0; i < names.size(); i++) {
+        typeNames_[i] = names[i];
+        if (header_ != nullptr) {
+            memset(header_->typeNames[i], 0, kTypeNameSize);
+            memcpy(header_->typeNames[i], names[i].data(), names[i].size());
+        }
+    }
+    if (header_ != nullptr) header_->typeCount = static_cast<uint32_t>(names.size());
+    typeCount_.store(names.size(), memory_order_release);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Shard al que pertenece un ID: los bits bajos del ID son el ndice del shard
+// ----------------------------------------------------------------------------------
+MemoryManager::Shard* MemoryManager::shardFor(int blockID) const {
+    if (blockID <= 0) return nullptr;
+    size_t index = static_cast<size_t>(blockID) & ((size_t(1) << shardBits_) - 1);
+    return index < shards_.size() ? shards_[index].get() : nullptr;
+}
+
+// ----------------------------------------------------------------------------------
+// Toma el mutex de un shard; solo se mide la espera cuando try_lock no lo consigue
+// ----------------------------------------------------------------------------------
+thread_local bool MemoryManager::holdsAllShards_ = false;
+
+template <typename Lock>
+static Lock lockTimed(shared_mutex& mtx) {
+    Metrics& metrics = Metrics::getInstance();
+    metrics.add(Metrics::LOCK_ACQUIRES, 1);
+    Lock lock(mtx, try_to_lock);
+    if (!lock.owns_lock()) {
+        uint64_t start = Metrics::nowNs();
+        lock.lock();
+        metrics.record(Metrics::LOCK_WAIT, Metrics::nowNs() - start);
     }
+    return lock;
+}
+
+unique_lock<shared_mutex> MemoryManager::lockShard(Shard& shard) {
+    if (holdsAllShards_) return unique_lock<shared_mutex>();
+    return lockTimed<unique_lock<shared_mutex>>(shard.mtx);
+}
+
+shared_lock<shared_mutex> MemoryManager::lockShardShared(Shard& shard) {
+    if (holdsAllShards_) return shared_lock<shared_mutex>();
+    return lockTimed<shared_lock<shared_mutex>>(shard.mtx);
 }
 
 // ----------------------------------------------------------------------------------
-// Determina el tamao mnimo requerido para un tipo dado
+// Busca un bloque tomando el mutex de su shard en 'lock'; nullptr si no existe
 // ----------------------------------------------------------------------------------
-size_t MemoryManager::getMinSizeForType(const string& type) {
-    if (type == "int")    return sizeof(int);
-    if (type == "double") return sizeof(double);
-    if (type == "float")  return sizeof(float);
-    if (type == "long")   return sizeof(long);
-    if (type == "bool")   return sizeof(bool);
-    if (type == "char")   return sizeof(char);
-    // Para un string, requerimos al menos 1 byte
-    if (type == "string") return 1;
-    // "raw" u otro, permitimos 0
-    return 0;
+MemoryManager::BlockInfo* MemoryManager::lockBlock(int blockID, unique_lock<shared_mutex>& lock) const {
+    Shard* shard = shardFor(blockID);
+    if (shard == nullptr) return nullptr;
+    lock = lockShard(*shard);
+    return findBlock(*shard, blockID);
+}
+
+const MemoryManager::BlockInfo* MemoryManager::lockBlockShared(int blockID, shared_lock<shared_mutex>& lock) const {
+    Shard* shard = shardFor(blockID);
+    if (shard == nullptr) return nullptr;
+    lock = lockShardShared(*shard);
+    return findBlock(*shard, blockID);
+}
+
+MemoryManager::BlockInfo* MemoryManager::findBlock(Shard& shard, int blockID) const {
+    return shard.blocks.find(slotOf(blockID), generationOf(blockID));
+}
+
+// ----------------------------------------------------------------------------------
+// Lectura sin lock de un bloque escalar. El slot copiado puede estar a medio escribir
+// mientras se copia el valor: solo se usa si cae dentro del shard, y si no era estable
+// readConsistent lo descarta.
+// ----------------------------------------------------------------------------------
+bool MemoryManager::readScalar(int blockID, BlockInfo& info, char (&value)[kScalarBytes]) const {
+    Shard* shard = shardFor(blockID);
+    if (shard == nullptr) {
+        info = BlockInfo{};
+        return true;
+    }
+    const char* base = static_cast<const char*>(memoryBlock_);
+    size_t limit = shard->base + shard->size;
+    bool stable = shard->blocks.readConsistent(slotOf(blockID), info, [&](const BlockInfo& seen) {
+        if ((seen.flags & HandleTable::SLOT_LIVE) && seen.size <= kScalarBytes
+            && seen.offset >= shard->base && seen.offset <= limit - kScalarBytes) {
+            memcpy(value, base + seen.offset, seen.size);
+        }
+    });
+    if (!stable) return false;
+    if (!(info.flags & HandleTable::SLOT_LIVE) || info.generation != generationOf(blockID)) {
+        info.flags = 0;
+        return true;
+    }
+    // Escalar: tipo numrico, bool o char que entra en 8 bytes; el resto va con el mutex
+    return !(info.flags & HandleTable::SLOT_ARRAY) && info.typeTag < TYPE_STRING
+        && info.size <= kScalarBytes && info.size >= codecFor(info.typeTag).minSize;
+}
+
+// ----------------------------------------------------------------------------------
+// ndice del nombre de tipo; los nombres ya publicados se buscan sin lock
+// ----------------------------------------------------------------------------------
+int MemoryManager::internType(const string& type) {
+    size_t count = typeCount_.load(memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+        if (typeNames_[i] == type) return static_cast<int>(i);
+    }
+
+    lock_guard<mutex> lock(typeMtx_);
+    count = typeCount_.load(memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        if (typeNames_[i] == type) return static_cast<int>(i);
+    }
+    if (count == kMaxTypes) return -1;
+    // Con archivo de respaldo el nombre se guarda en el encabezado, que tiene ancho fijo
+    if (header_ != nullptr && type.size() >= kTypeNameSize) return -1;
+    typeNames_[count] = type;
+    if (header_ != nullptr) {
+        strncpy(header_->typeNames[count], type.c_str(), kTypeNameSize - 1);
+        header_->typeCount = static_cast<uint32_t>(count + 1);
+    }
+    typeCount_.store(count + 1, memory_order_release);
+    logRecord(WriteAheadLog::TYPE, count, type.data(), type.size());
+    return static_cast<int>(count);
 }
 
 // ----------------------------------------------------------------------------------
 // Crea un bloque de 'size' bytes con tipo 'type'
 // ----------------------------------------------------------------------------------
 int MemoryManager::createBlock(size_t size, const string& type) {
-    lock_guard<recursive_mutex> lock(mtx_);
+    int typeTag = internType(type);
+    if (typeTag < 0) {
+        cerr << "Error: No se puede registrar el tipo '" << type
+            << "' (demasiados tipos distintos o nombre demasiado largo)." << endl;
+        return -1;
+    }
 
     // Verificar tamao mnimo segn el tipo
-    size_t minSize = getMinSizeForType(type);
+    size_t minSize = codecFor(static_cast<uint8_t>(typeTag)).minSize;
     if (minSize > size) {
         cerr << "Error: Se solicit un bloque de tipo '" << type
             << "' con tamao " << size << " bytes, pero se requiere al menos "
             << minSize << " bytes para almacenar ese tipo de dato." << endl;
         return -1;
     }
+    if (size > UINT32_MAX) {
+        cerr << "Error: Un bloque no puede superar " << UINT32_MAX << " bytes." << endl;
+        return -1;
+    }
+    return placeBlock(size, static_cast<uint8_t>(typeTag), 0);
+}
 
-    // Buscar en la lista de bloques libres
-    for (auto it = freeBlocks_.begin(); it != freeBlocks_.end(); ++it) {
-        if (it->size >= size) {
-            // Se puede usar este bloque libre
-            BlockInfo newBlock;
-            newBlock.offset = it->offset;
-            newBlock.size = size;
-            newBlock.type = type;
-            newBlock.refCount = 1; // Al crear, inicia con 1
-
-            int blockID = nextID_++;
-            blocks_[blockID] = newBlock;
+// ----------------------------------------------------------------------------------
+// Crea un bloque arreglo de 'count' elementos de tipo 'type'
+// ----------------------------------------------------------------------------------
+int MemoryManager::createArray(size_t count, const string& type) {
+    int typeTag = internType(type);
+    if (typeTag < 0) {
+        cerr << "Error: No se puede registrar el tipo '" << type
+            << "' (demasiados tipos distintos o nombre demasiado largo)." << endl;
+        return -1;
+    }
+    size_t elemSize = codecFor(static_cast<uint8_t>(typeTag)).arrayElemSize;
+    if (elemSize == 0) {
+        cerr << "Error: El tipo '" << type << "' no se admite en arreglos." << endl;
+        return -1;
+    }
+    if (count == 0 || count > UINT32_MAX / elemSize) {
+        cerr << "Error: Un arreglo debe tener entre 1 y " << UINT32_MAX / elemSize
+            << " elementos de tipo '" << type << "'." << endl;
+        return -1;
+    }
+    return placeBlock(count * elemSize, static_cast<uint8_t>(typeTag), HandleTable::SLOT_ARRAY);
+}
 
-            // Ajustar el bloque libre
-            it->offset += size;
-            it->size -= size;
+// ----------------------------------------------------------------------------------
+// Ubica un bloque nuevo en algn shard
+// ----------------------------------------------------------------------------------
+int MemoryManager::placeBlock(size_t size, uint8_t typeTag, uint8_t flags) {
+    // Cada hilo empieza por un shard distinto (round-robin local, sin contencin) y, si
+    // ese shard no tiene espacio, prueba con los siguientes
+    static thread_local size_t nextShard = 0;
+    size_t count = shards_.size();
+    size_t start = nextShard++;
+    for (size_t i = 0; i < count; i++) {
+        int blockID = createInShard((start + i) % count, size, typeTag, flags);
+        if (blockID >= 0) {
+            return blockID;
+        }
+    }
 
-            // Si el bloque libre qued en tamao 0, se elimina
-            if (it->size == 0) {
-                freeBlocks_.erase(it);
+    // Puede haber espacio libre suficiente pero partido en huecos: se compacta y se reintenta
+    if (compact() > 0) {
+        for (size_t i = 0; i < count; i++) {
+            int blockID = createInShard((start + i) % count, size, typeTag, flags);
+            if (blockID >= 0) {
+                return blockID;
             }
-
-            usedSize_ += size;
-
-            // Generar dump
-            ostringstream action;
-            action << "CREATE -> ID=" << blockID
-                << ", size=" << size
-                << ", type=" << type;
-            dumpMemory(action.str());
-            return blockID;
         }
     }
 
@@ -135,203 +495,562 @@ int MemoryManager::createBlock(size_t size, const string& type) {
     return -1;
 }
 
+// ----------------------------------------------------------------------------------
+// Crea el bloque en un shard con su allocator
+// ----------------------------------------------------------------------------------
+int MemoryManager::createInShard(size_t shardIndex, size_t size, uint8_t typeTag, uint8_t flags) {
+    Shard& shard = *shards_[shardIndex];
+    unique_lock<shared_mutex> lock = lockShard(shard);
+
+    size_t offset = shard.allocator.allocate(size);
+    Metrics& metrics = Metrics::getInstance();
+    metrics.record(Metrics::ALLOC_SEARCH, shard.allocator.lastSearchLength());
+    metrics.record(Metrics::FREE_RANGES, shard.allocator.freeRangeCount());
+    if (offset == Allocator::kNoSpace) {
+        return -1;
+    }
+    uint32_t slot = shard.blocks.acquire();
+    if (slot == HandleTable::kNone) {
+        shard.allocator.release(offset, size);
+        return -1;
+    }
+
+    BlockInfo& info = shard.blocks.at(slot);
+    {
+        HandleTable::SeqWrite write(info);
+        info.offset = offset;
+        info.size = static_cast<uint32_t>(size);
+        info.typeTag = typeTag;
+        info.flags |= flags;
+        info.refCount = 1; // Al crear, inicia con 1
+        if (flags & HandleTable::SLOT_ARRAY) {
+            // Los arreglos empiezan en cero, como un vector
+            memset(static_cast<char*>(memoryBlock_) + offset, 0, size);
+        }
+    }
+    if (flags & HandleTable::SLOT_ARRAY) {
+        uint64_t len = size;
+        logRecord(WriteAheadLog::ZERO, offset, reinterpret_cast<const char*>(&len), sizeof(len));
+    }
+    logSlot(shard, slot, info);
+    shard.usedSize += Allocator::roundUp(size);
+
+    int blockID = makeID(shardIndex, slot, info.generation);
+    recordDump(DumpRecord::CREATE, blockID, static_cast<uint32_t>(size), &info);
+    return blockID;
+}
+
 // ----------------------------------------------------------------------------------
 // setValue: Escribe 'value' en el bloque 'blockID'
 // ----------------------------------------------------------------------------------
 void MemoryManager::setValue(int blockID, const string& value) {
-    lock_guard<recursive_mutex> lock(mtx_);
-    auto it = blocks_.find(blockID);
-    if (it == blocks_.end()) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
         cerr << "setValue: Bloque " << blockID << " no encontrado." << endl;
         return;
     }
+    if (info->flags & HandleTable::SLOT_ARRAY) {
+        cerr << "setValue: El bloque " << blockID << " es un arreglo; se escribe por rangos." << endl;
+        return;
+    }
 
-    const string& type = it->second.type;
-    size_t offset = it->second.offset;
-    size_t blockSize = it->second.size;
+    const TypeCodec& codec = codecFor(info->typeTag);
+    size_t blockSize = info->size;
 
     // Verificar si el bloque es suficiente para escribir el tipo
-    size_t minSize = getMinSizeForType(type);
-    if (blockSize < minSize) {
+    if (blockSize < codec.minSize) {
         cerr << "Error: El bloque " << blockID << " es de " << blockSize
-            << " bytes, insuficiente para escribir un '" << type
+            << " bytes, insuficiente para escribir un '" << typeName(*info)
             << "' que requiere "
-            << minSize << " bytes." << endl;
+            << codec.minSize << " bytes." << endl;
         return;
     }
 
-    // Dependiendo del tipo, convertir y escribir
-    try {
-        if (type == "int") {
-            int num = stoi(value);
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &num, sizeof(int));
-        }
-        else if (type == "double") {
-            double num = stod(value);
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &num, sizeof(double));
-        }
-        else if (type == "float") {
-            float num = stof(value);
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &num, sizeof(float));
-        }
-        else if (type == "long") {
-            long num = stol(value);
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &num, sizeof(long));
-        }
-        else if (type == "bool") {
-            bool b = (value == "true" || value == "1");
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &b, sizeof(bool));
-        }
-        else if (type == "char") {
-            char c = (value.empty() ? '\0' : value[0]);
-            memcpy(static_cast<char*>(memoryBlock_) + offset, &c, sizeof(char));
-        }
-        else if (type == "string") {
-            // Copiamos la cadena, asegurando dejar espacio para el terminador nulo si cabe
-            size_t maxCopy = (blockSize > 0 ? blockSize - 1 : 0);
-            size_t copySize = min(maxCopy, value.size());
-            memcpy(static_cast<char*>(memoryBlock_) + offset, value.c_str(), copySize);
-
-            if (maxCopy > 0) {
-                // Terminador nulo si cabe
-                static_cast<char*>(memoryBlock_)[offset + copySize] = '\0';
-            }
-            if (copySize < value.size()) {
-                cerr << "Advertencia: La cadena '" << value
-                    << "' fue truncada al escribir en un bloque de "
-                    << blockSize << " bytes." << endl;
-            }
-        }
-        else {
-            // Para tipos no reconocidos, se trata como buffer de string crudo
-            size_t copySize = min(blockSize, value.size());
-            memcpy(static_cast<char*>(memoryBlock_) + offset, value.c_str(), copySize);
-            if (copySize < value.size()) {
-                cerr << "Advertencia: Datos truncados al escribir en un bloque de "
-                    << blockSize << " bytes." << endl;
-            }
-        }
+    // Convertir y escribir segn el codec del tipo
+    char* dst = static_cast<char*>(memoryBlock_) + info->offset;
+    TypeCodec::ParseResult parsed;
+    {
+        HandleTable::SeqWrite write(*info);
+        parsed = codec.parseText(value.data(), value.size(), dst, blockSize);
     }
-    catch (const exception& e) {
+    switch (parsed) {
+    case TypeCodec::PARSE_OK:
+        break;
+    case TypeCodec::PARSE_TRUNCATED:
+        cerr << "Advertencia: '" << value << "' fue truncado al escribir en un bloque de "
+            << blockSize << " bytes." << endl;
+        break;
+    case TypeCodec::PARSE_INVALID:
         cerr << "Error: No se pudo convertir '" << value
-            << "' al tipo '" << type << "'. Excepcin: "
-            << e.what() << endl;
+            << "' al tipo '" << typeName(*info) << "'." << endl;
         return;
     }
+    invalidateLeases(blockID, *info);
+    logData(info->offset, blockSize);
 
-    // Generar dump
-    ostringstream action;
-    action << "SET -> ID=" << blockID << ", newValue=" << value;
-    dumpMemory(action.str());
+    // Registrar para el dump
+    recordDump(DumpRecord::SET, blockID, 0, info);
 }
 
 // ----------------------------------------------------------------------------------
 // getValue: Lee el contenido del bloque 'blockID' y lo retorna como string
 // ----------------------------------------------------------------------------------
 string MemoryManager::getValue(int blockID) const {
-    lock_guard<recursive_mutex> lock(mtx_);
-    auto it = blocks_.find(blockID);
-    if (it == blocks_.end()) {
+    string out;
+    BlockInfo scalar;
+    char value[kScalarBytes];
+    if (readScalar(blockID, scalar, value)) {
+        if (!(scalar.flags & HandleTable::SLOT_LIVE)) {
+            cerr << "getValue: Bloque " << blockID << " no encontrado." << endl;
+            return out;
+        }
+        codecFor(scalar.typeTag).formatText(value, scalar.size, out);
+        return out;
+    }
+
+    shared_lock<shared_mutex> lock;
+    const BlockInfo* info = lockBlockShared(blockID, lock);
+    if (info == nullptr) {
         cerr << "getValue: Bloque " << blockID << " no encontrado." << endl;
-        return "";
+        return out;
     }
+    formatValue(*info, out);
+    return out;
+}
 
-    const string& type = it->second.type;
-    size_t offset = it->second.offset;
-    size_t blockSize = it->second.size;
+void MemoryManager::formatValue(const BlockInfo& info, string& out) const {
+    const TypeCodec& codec = codecFor(info.typeTag);
+    if (info.size < codec.minSize) {
+        out.append("[Error: bloque muy pequeo para ").append(typeName(info)).append("]");
+        return;
+    }
+    if (info.flags & HandleTable::SLOT_ARRAY) {
+        formatArray(info, out);
+        return;
+    }
+    codec.formatText(static_cast<const char*>(memoryBlock_) + info.offset, info.size, out);
+}
 
-    ostringstream oss;
+// ----------------------------------------------------------------------------------
+// setValueBinary: Escribe un valor codificado en binario (sin conversiones de texto).
+// El servidor corre en x86 (little-endian), as que los tipos de ancho fijo se copian
+// tal cual; solo "long" se convierte porque en el cable siempre ocupa 8 bytes.
+// ----------------------------------------------------------------------------------
+bool MemoryManager::setValueBinary(int blockID, const char* data, size_t len) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
+        cerr << "setValueBinary: Bloque " << blockID << " no encontrado." << endl;
+        return false;
+    }
 
-    if (type == "int") {
-        if (blockSize >= sizeof(int)) {
-            int val = 0;
-            memcpy(&val, static_cast<char*>(memoryBlock_) + offset, sizeof(int));
-            oss << val;
-        }
-        else {
-            oss << "[Error: bloque muy pequeo para int]";
-        }
+    char* dst = static_cast<char*>(memoryBlock_) + info->offset;
+    const TypeCodec& codec = codecFor(info->typeTag);
+    if (info->flags & HandleTable::SLOT_ARRAY) {
+        // Un arreglo completo viaja como sus bytes crudos
+        if (len != info->size) return false;
+        HandleTable::SeqWrite write(*info);
+        memcpy(dst, data, len);
     }
-    else if (type == "double") {
-        if (blockSize >= sizeof(double)) {
-            double val = 0.0;
-            memcpy(&val, static_cast<char*>(memoryBlock_) + offset, sizeof(double));
-            oss << val;
-        }
-        else {
-            oss << "[Error: bloque muy pequeo para double]";
-        }
+    else {
+        if (info->size < codec.minSize) return false;
+        HandleTable::SeqWrite write(*info);
+        if (!codec.decodeBinary(data, len, dst, info->size)) return false;
     }
-    else if (type == "float") {
-        if (blockSize >= sizeof(float)) {
-            float val = 0.0f;
-            memcpy(&val, static_cast<char*>(memoryBlock_) + offset, sizeof(float));
-            oss << val;
-        }
-        else {
-            oss << "[Error: bloque muy pequeo para float]";
+    invalidateLeases(blockID, *info);
+    logData(info->offset, info->size);
+
+    recordDump(DumpRecord::SET, blockID, 0, info);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// getValueBinary: Lee el valor del bloque con la misma codificacin de setValueBinary
+// ----------------------------------------------------------------------------------
+MemoryManager::ReadResult MemoryManager::getValueBinary(int blockID, string& out) const {
+    BlockInfo scalar;
+    char value[kScalarBytes];
+    if (readScalar(blockID, scalar, value)) {
+        if (!(scalar.flags & HandleTable::SLOT_LIVE)) {
+            cerr << "getValueBinary: Bloque " << blockID << " no encontrado." << endl;
+            return ReadResult::Failed;
         }
+        codecFor(scalar.typeTag).encodeBinary(value, scalar.size, out);
+        return ReadResult::Ok;
     }
-    else if (type == "long") {
-        if (blockSize >= sizeof(long)) {
-            long val = 0;
-            memcpy(&val, static_cast<char*>(memoryBlock_) + offset, sizeof(long));
-            oss << val;
-        }
-        else {
-            oss << "[Error: bloque muy pequeo para long]";
-        }
+
+    shared_lock<shared_mutex> lock;
+    const BlockInfo* info = lockBlockShared(blockID, lock);
+    if (info == nullptr) {
+        cerr << "getValueBinary: Bloque " << blockID << " no encontrado." << endl;
+        return ReadResult::Failed;
     }
-    else if (type == "bool") {
-        if (blockSize >= sizeof(bool)) {
-            bool b = false;
-            memcpy(&b, static_cast<char*>(memoryBlock_) + offset, sizeof(bool));
-            oss << (b ? "true" : "false");
-        }
-        else {
-            oss << "[Error: bloque muy pequeo para bool]";
+    if (info->size > kMaxReplyValue) {
+        return ReadResult::TooLarge;
+    }
+
+    const char* src = static_cast<const char*>(memoryBlock_) + info->offset;
+    if (info->flags & HandleTable::SLOT_ARRAY) {
+        out.assign(src, info->size);
+        return ReadResult::Ok;
+    }
+    const TypeCodec& codec = codecFor(info->typeTag);
+    if (info->size < codec.minSize) {
+        return ReadResult::Failed;
+    }
+    codec.encodeBinary(src, info->size, out);
+    return ReadResult::Ok;
+}
+
+// ----------------------------------------------------------------------------------
+// Operaciones atmicas. El valor anterior se copia a la pila antes de escribir, y los
+// operandos llegan ya convertidos al formato del bloque (a lo sumo 8 bytes).
+// ----------------------------------------------------------------------------------
+MemoryManager::BlockInfo* MemoryManager::lockAtomic(int blockID, AtomicOp op, unique_lock<shared_mutex>& lock,
+    const char* caller) const {
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
+        cerr << caller << ": Bloque " << blockID << " no encontrado." << endl;
+        return nullptr;
+    }
+    const TypeCodec& codec = codecFor(info->typeTag);
+    if ((info->flags & HandleTable::SLOT_ARRAY) || !codec.atomic || info->size < codec.minSize
+        || (op == AtomicOp::Add && codec.addValue == nullptr)) {
+        cerr << caller << ": El bloque " << blockID << " ('" << typeName(*info)
+            << "') no admite la operacin." << endl;
+        return nullptr;
+    }
+    return info;
+}
+
+bool MemoryManager::applyAtomic(int blockID, BlockInfo& info, AtomicOp op, const char* operand, const char* expected) {
+    const TypeCodec& codec = codecFor(info.typeTag);
+    char* dst = static_cast<char*>(memoryBlock_) + info.offset;
+    if (op == AtomicOp::CompareExchange && memcmp(dst, expected, codec.minSize) != 0) return false;
+    {
+        HandleTable::SeqWrite write(info);
+        if (op == AtomicOp::Add) codec.addValue(dst, operand);
+        else memcpy(dst, operand, codec.minSize);
+    }
+    invalidateLeases(blockID, info);
+    logData(info.offset, codec.minSize);
+
+    recordDump(DumpRecord::SET, blockID, 0, &info);
+    return true;
+}
+
+bool MemoryManager::atomicBinary(int blockID, AtomicOp op, const char* operand, size_t operandLen,
+    const char* expected, size_t expectedLen, string& previous, bool& swapped) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockAtomic(blockID, op, lock, "atomicBinary");
+    if (info == nullptr) return false;
+
+    const TypeCodec& codec = codecFor(info->typeTag);
+    char value[8] = {}, compare[8] = {};
+    if (!codec.decodeBinary(operand, operandLen, value, sizeof(value))) return false;
+    if (op == AtomicOp::CompareExchange && !codec.decodeBinary(expected, expectedLen, compare, sizeof(compare))) {
+        return false;
+    }
+    codec.encodeBinary(static_cast<const char*>(memoryBlock_) + info->offset, info->size, previous);
+    swapped = applyAtomic(blockID, *info, op, value, compare);
+    return true;
+}
+
+bool MemoryManager::atomicText(int blockID, AtomicOp op, const string& operand, const string& expected,
+    string& previous, bool& swapped) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockAtomic(blockID, op, lock, "atomicText");
+    if (info == nullptr) return false;
+
+    const TypeCodec& codec = codecFor(info->typeTag);
+    char value[8] = {}, compare[8] = {};
+    if (codec.parseText(operand.data(), operand.size(), value, sizeof(value)) != TypeCodec::PARSE_OK) {
+        cerr << "Error: No se pudo convertir '" << operand << "' al tipo '" << typeName(*info) << "'." << endl;
+        return false;
+    }
+    if (op == AtomicOp::CompareExchange
+        && codec.parseText(expected.data(), expected.size(), compare, sizeof(compare)) != TypeCodec::PARSE_OK) {
+        cerr << "Error: No se pudo convertir '" << expected << "' al tipo '" << typeName(*info) << "'." << endl;
+        return false;
+    }
+    previous.clear();
+    codec.formatText(static_cast<const char*>(memoryBlock_) + info->offset, info->size, previous);
+    swapped = applyAtomic(blockID, *info, op, value, compare);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Transacciones: las lecturas y escrituras solo toman el mutex del shard del bloque el
+// tiempo de copiar su valor y su versin
+// ----------------------------------------------------------------------------------
+const MemoryManager::BlockInfo* MemoryManager::lockTxBlock(int blockID, shared_lock<shared_mutex>& lock,
+    const char* caller) const {
+    const BlockInfo* info = lockBlockShared(blockID, lock);
+    if (info == nullptr) {
+        cerr << caller << ": Bloque " << blockID << " no encontrado." << endl;
+        return nullptr;
+    }
+    if ((info->flags & HandleTable::SLOT_ARRAY) || info->size < codecFor(info->typeTag).minSize) {
+        cerr << caller << ": El bloque " << blockID << " no se puede usar en una transaccin." << endl;
+        return nullptr;
+    }
+    return info;
+}
+
+uint32_t MemoryManager::txVersion(int blockID, const BlockInfo& info) const {
+    const Shard& shard = *shardFor(blockID);
+    uint32_t slot = slotOf(blockID);
+    uint32_t moved = slot < shard.moves.size() ? shard.moves[slot] : 0;
+    return info.version - 2 * moved;
+}
+
+bool MemoryManager::txGet(uint32_t tx, int blockID, bool binary, string& out) {
+    shared_lock<shared_mutex> lock;
+    const BlockInfo* info = lockTxBlock(blockID, lock, "txGet");
+    if (info == nullptr) return false;
+
+    // Si la transaccin ya escribi el bloque, se lee su propio valor pendiente
+    string staged;
+    bool found = false;
+    if (!transactions_.pending(tx, blockID, staged, found)) return false;
+    const char* src = static_cast<const char*>(memoryBlock_) + info->offset;
+    if (found) {
+        src = staged.data();
+    }
+    else if (!transactions_.observe(tx, blockID, txVersion(blockID, *info))) {
+        return false;
+    }
+    const TypeCodec& codec = codecFor(info->typeTag);
+    if (binary) {
+        codec.encodeBinary(src, info->size, out);
+    }
+    else {
+        out.clear();
+        codec.formatText(src, info->size, out);
+    }
+    return true;
+}
+
+bool MemoryManager::txSet(uint32_t tx, int blockID, bool binary, const char* data, size_t len) {
+    shared_lock<shared_mutex> lock;
+    const BlockInfo* info = lockTxBlock(blockID, lock, "txSet");
+    if (info == nullptr) return false;
+
+    // El valor nuevo se arma sobre una copia del bloque, igual que lo hara setValue
+    const TypeCodec& codec = codecFor(info->typeTag);
+    string bytes(static_cast<const char*>(memoryBlock_) + info->offset, info->size);
+    if (binary) {
+        if (!codec.decodeBinary(data, len, &bytes[0], info->size)) return false;
+    }
+    else if (codec.parseText(data, len, &bytes[0], info->size) == TypeCodec::PARSE_INVALID) {
+        cerr << "Error: No se pudo convertir '" << string(data, len)
+            << "' al tipo '" << typeName(*info) << "'." << endl;
+        return false;
+    }
+    return transactions_.stage(tx, blockID, txVersion(blockID, *info), move(bytes));
+}
+
+MemoryManager::TxResult MemoryManager::commitTransaction(uint32_t tx, int& conflictBlock) {
+    conflictBlock = 0;
+    TransactionTable::Transaction txn;
+    if (!transactions_.take(tx, txn)) return TxResult::Unknown;
+    if (txn.conflictBlock != 0) {
+        conflictBlock = txn.conflictBlock;
+        return TxResult::Conflict;
+    }
+
+    bool writes = any_of(txn.entries.begin(), txn.entries.end(),
+        [](const TransactionTable::Entry& entry) { return entry.written; });
+    if (!writes) {
+        // Solo lecturas: cada versin se compara con el mutex de su shard tomado un instante
+        for (const TransactionTable::Entry& entry : txn.entries) {
+            shared_lock<shared_mutex> lock;
+            const BlockInfo* info = lockBlockShared(entry.blockID, lock);
+            if (info == nullptr || txVersion(entry.blockID, *info) != entry.version) {
+                conflictBlock = entry.blockID;
+                return TxResult::Conflict;
+            }
         }
+        return TxResult::Committed;
     }
-    else if (type == "char") {
-        if (blockSize >= sizeof(char)) {
-            char val = 0;
-            memcpy(&val, static_cast<char*>(memoryBlock_) + offset, sizeof(char));
-            oss << val;
+
+    // Con escrituras: los shards involucrados se toman en orden (como runLocked), se comparan
+    // todas las versiones y recin entonces se escribe
+    vector<size_t> indexes;
+    for (const TransactionTable::Entry& entry : txn.entries) {
+        indexes.push_back(shardFor(entry.blockID)->index);
+    }
+    sort(indexes.begin(), indexes.end());
+    indexes.erase(unique(indexes.begin(), indexes.end()), indexes.end());
+    vector<unique_lock<shared_mutex>> locks;
+    locks.reserve(indexes.size());
+    for (size_t index : indexes) {
+        locks.push_back(lockShard(*shards_[index]));
+    }
+
+    vector<BlockInfo*> infos;
+    infos.reserve(txn.entries.size());
+    for (const TransactionTable::Entry& entry : txn.entries) {
+        BlockInfo* info = findBlock(*shardFor(entry.blockID), entry.blockID);
+        if (info == nullptr || txVersion(entry.blockID, *info) != entry.version) {
+            conflictBlock = entry.blockID;
+            return TxResult::Conflict;
         }
-        else {
-            oss << "[Error: bloque muy pequeo para char]";
+        infos.push_back(info);
+    }
+    for (size_t i = 0; i < txn.entries.size(); i++) {
+        const TransactionTable::Entry& entry = txn.entries[i];
+        if (!entry.written) continue;
+        BlockInfo* info = infos[i];
+        {
+            HandleTable::SeqWrite write(*info);
+            memcpy(static_cast<char*>(memoryBlock_) + info->offset, entry.bytes.data(), info->size);
         }
+        invalidateLeases(entry.blockID, *info);
+        logData(info->offset, info->size);
+
+        recordDump(DumpRecord::SET, entry.blockID, 0, info);
     }
-    else if (type == "string") {
-        // Para string: se asume que se guard la cadena con terminador nulo si caba
-        const char* start = static_cast<const char*>(memoryBlock_) + offset;
-        size_t len = strnlen(start, blockSize);
-        oss << string(start, len);
+    return TxResult::Committed;
+}
+
+bool MemoryManager::abortTransaction(uint32_t tx) {
+    TransactionTable::Transaction txn;
+    return transactions_.take(tx, txn);
+}
+
+// ----------------------------------------------------------------------------------
+// getValueLeased: lectura binaria que adems entrega un lease de lectura. El lease se
+// registra con el mutex del shard tomado, as que una escritura posterior siempre lo ve.
+// ----------------------------------------------------------------------------------
+MemoryManager::ReadResult MemoryManager::getValueLeased(int blockID, uint32_t subscriber, string& out,
+    uint32_t& leaseMs) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
+        cerr << "getValueLeased: Bloque " << blockID << " no encontrado." << endl;
+        return ReadResult::Failed;
+    }
+
+    const TypeCodec& codec = codecFor(info->typeTag);
+    if (info->size < codec.minSize) {
+        return ReadResult::Failed;
+    }
+    if (info->size > kMaxReplyValue) {
+        return ReadResult::TooLarge;
+    }
+    leaseMs = 0;
+    if (leases_.grant(blockID, subscriber)) {
+        info->flags |= HandleTable::SLOT_LEASED;
+        leaseMs = static_cast<uint32_t>(leases_.duration().count());
+    }
+    const char* src = static_cast<const char*>(memoryBlock_) + info->offset;
+    if (info->flags & HandleTable::SLOT_ARRAY) {
+        out.assign(src, info->size);
     }
     else {
-        // Para tipos no reconocidos, mostramos en hexadecimal
-        unsigned char* data = static_cast<unsigned char*>(memoryBlock_) + offset;
-        for (size_t i = 0; i < blockSize; i++) {
-            oss << hex << setw(2) << setfill('0') << (int)data[i] << " ";
-        }
+        codec.encodeBinary(src, info->size, out);
     }
-    return oss.str();
+    return ReadResult::Ok;
+}
+
+// ----------------------------------------------------------------------------------
+// Rango de elementos de un arreglo. Se valida sin desbordes: begin <= total y
+// count <= total - begin.
+// ----------------------------------------------------------------------------------
+bool MemoryManager::arrayRange(const BlockInfo& info, size_t begin, size_t count, size_t& offset, size_t& bytes) {
+    if (!(info.flags & HandleTable::SLOT_ARRAY)) return false;
+    size_t elemSize = codecFor(info.typeTag).arrayElemSize;
+    size_t total = info.size / elemSize;
+    if (begin > total || count > total - begin) return false;
+    offset = info.offset + begin * elemSize;
+    bytes = count * elemSize;
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// readRange: copia los elementos pedidos de un arreglo
+// ----------------------------------------------------------------------------------
+MemoryManager::ReadResult MemoryManager::readRange(int blockID, size_t begin, size_t count, string& out) const {
+    shared_lock<shared_mutex> lock;
+    const BlockInfo* info = lockBlockShared(blockID, lock);
+    if (info == nullptr) {
+        cerr << "readRange: Bloque " << blockID << " no encontrado." << endl;
+        return ReadResult::Failed;
+    }
+    size_t offset, bytes;
+    if (!arrayRange(*info, begin, count, offset, bytes)) {
+        return ReadResult::Failed;
+    }
+    if (bytes > kMaxReplyValue) {
+        return ReadResult::TooLarge;
+    }
+    out.assign(static_cast<const char*>(memoryBlock_) + offset, bytes);
+    return ReadResult::Ok;
+}
+
+// ----------------------------------------------------------------------------------
+// writeRange: escribe elementos consecutivos de un arreglo desde 'begin'
+// ----------------------------------------------------------------------------------
+bool MemoryManager::writeRange(int blockID, size_t begin, const char* data, size_t len) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
+        cerr << "writeRange: Bloque " << blockID << " no encontrado." << endl;
+        return false;
+    }
+    if (!(info->flags & HandleTable::SLOT_ARRAY)) {
+        return false;
+    }
+    size_t elemSize = codecFor(info->typeTag).arrayElemSize;
+    size_t offset, bytes;
+    if (len % elemSize != 0 || !arrayRange(*info, begin, len / elemSize, offset, bytes)) {
+        return false;
+    }
+    {
+        HandleTable::SeqWrite write(*info);
+        memcpy(static_cast<char*>(memoryBlock_) + offset, data, bytes);
+    }
+    invalidateLeases(blockID, *info);
+    logData(offset, bytes);
+
+    recordDump(DumpRecord::SET, blockID, 0, info);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Texto de un arreglo: los primeros elementos con el codec del tipo
+// ----------------------------------------------------------------------------------
+void MemoryManager::formatArray(const BlockInfo& info, string& out) const {
+    const TypeCodec& codec = codecFor(info.typeTag);
+    size_t elemSize = codec.arrayElemSize;
+    size_t total = info.size / elemSize;
+    const char* src = static_cast<const char*>(memoryBlock_) + info.offset;
+    out += '[';
+    for (size_t i = 0; i < total && i < kMaxArrayText; i++) {
+        if (i > 0) out += ", ";
+        codec.formatText(src + i * elemSize, elemSize, out);
+    }
+    if (total > kMaxArrayText) out += ", ...";
+    out += ']';
+}
+
+// ----------------------------------------------------------------------------------
+// Anota los avisos a los suscriptores con lease sobre el bloque (se envan sin el lock del
+// shard, con notifyLeaseHolders)
+// ----------------------------------------------------------------------------------
+void MemoryManager::invalidateLeases(int blockID, BlockInfo& info) {
+    if (!(info.flags & HandleTable::SLOT_LEASED)) return;
+    info.flags &= static_cast<uint8_t>(~HandleTable::SLOT_LEASED);
+    leases_.invalidate(blockID);
 }
 
 // ----------------------------------------------------------------------------------
 // Aumenta el contador de referencias
 // ----------------------------------------------------------------------------------
 void MemoryManager::increaseRefCount(int blockID) {
-    lock_guard<recursive_mutex> lock(mtx_);
-    auto it = blocks_.find(blockID);
-    if (it != blocks_.end()) {
-        it->second.refCount++;
-        ostringstream action;
-        action << "INCREASE -> ID=" << blockID
-            << ", newRefCount=" << it->second.refCount;
-        dumpMemory(action.str());
-    }
-    else {
+    if (!adjustRefCount(blockID, 1)) {
         cerr << "increaseRefCount: Bloque " << blockID << " no encontrado." << endl;
     }
 }
@@ -340,153 +1059,621 @@ void MemoryManager::increaseRefCount(int blockID) {
 // Disminuye el contador de referencias (libera si llega a 0)
 // ----------------------------------------------------------------------------------
 void MemoryManager::decreaseRefCount(int blockID) {
-    lock_guard<recursive_mutex> lock(mtx_);
-    auto it = blocks_.find(blockID);
-    if (it == blocks_.end()) {
+    if (!adjustRefCount(blockID, -1)) {
         cerr << "decreaseRefCount: Bloque " << blockID << " no encontrado." << endl;
-        return;
     }
-    if (it->second.refCount > 0) {
-        it->second.refCount--;
-        ostringstream action;
-        action << "DECREASE -> ID=" << blockID
-            << ", newRefCount=" << it->second.refCount;
-        if (it->second.refCount == 0) {
-            // Lo marcamos como bloque libre
-            freeBlocks_.push_back({ it->second.offset, it->second.size });
-            usedSize_ -= it->second.size;
-            blocks_.erase(it);
-            mergeFreeBlocks();
-            action << " (LIBERATED)";
+}
+
+// ----------------------------------------------------------------------------------
+// Aplica un cambio neto al contador de referencias con una sola toma del mutex
+// ----------------------------------------------------------------------------------
+bool MemoryManager::adjustRefCount(int blockID, int delta) {
+    unique_lock<shared_mutex> lock;
+    BlockInfo* info = lockBlock(blockID, lock);
+    if (info == nullptr) {
+        return false;
+    }
+    Shard& shard = *shardFor(blockID);
+    uint32_t slot = slotOf(blockID);
+    if (delta > 0) {
+        info->refCount += static_cast<uint32_t>(delta);
+        logSlot(shard, slot, *info);
+        recordDump(DumpRecord::INCREASE, blockID, static_cast<uint32_t>(info->refCount), info);
+        return true;
+    }
+    if (delta == 0 || info->refCount == 0) {
+        return true;
+    }
+    uint32_t drop = min(info->refCount, static_cast<uint32_t>(-static_cast<int64_t>(delta)));
+    info->refCount -= drop;
+    bool liberated = info->refCount == 0;
+    recordDump(DumpRecord::DECREASE, blockID, static_cast<uint32_t>(info->refCount), info, liberated);
+    if (!liberated) {
+        logSlot(shard, slot, *info);
+    }
+    else {
+        invalidateLeases(blockID, *info);
+        // Lo marcamos como bloque libre
+        shard.allocator.release(info->offset, info->size);
+        shard.usedSize -= Allocator::roundUp(info->size);
+        shard.blocks.release(slot);
+        logSlot(shard, slot, *info);
+        // Si el espacio libre qued muy partido, se compacta entre peticiones
+        if (compactThreshold_ > 0 && !shard.compactPending.load(memory_order_relaxed)
+            && shard.allocator.fragmentation() > compactThreshold_) {
+            shard.compactPending.store(true, memory_order_release);
         }
-        dumpMemory(action.str());
     }
+    return true;
 }
 
 // ----------------------------------------------------------------------------------
 // Retorna un resumen global de la memoria
 // ----------------------------------------------------------------------------------
 string MemoryManager::getStatus() const {
-    lock_guard<recursive_mutex> lock(mtx_);
+    // Se suman los shards uno a uno (nunca se tienen dos mutex de shard a la vez)
+    size_t usedSize = 0;
+    size_t blockCount = 0;
+    for (auto& shard : shards_) {
+        shared_lock<shared_mutex> lock = lockShardShared(*shard);
+        usedSize += shard->usedSize;
+        blockCount += shard->blocks.liveCount();
+    }
     ostringstream oss;
     oss << "Memory Status => [Total: " << totalSize_
-        << " bytes, Used: " << usedSize_
-        << " bytes, Free: " << (totalSize_ - usedSize_)
-        << " bytes, BlockCount: " << blocks_.size() << "]";
+        << " bytes, Used: " << usedSize
+        << " bytes, Free: " << (totalSize_ - usedSize)
+        << " bytes, BlockCount: " << blockCount << "]";
     return oss.str();
 }
 
+// ----------------------------------------------------------------------------------
+// Suma el estado de los allocators de todos los shards
+// ----------------------------------------------------------------------------------
+MemoryManager::AllocatorStats MemoryManager::getAllocatorStats() const {
+    AllocatorStats stats;
+    for (auto& shard : shards_) {
+        shared_lock<shared_mutex> lock = lockShardShared(*shard);
+        stats.usedBytes += shard->usedSize;
+        stats.freeBytes += shard->allocator.freeBytes();
+        stats.freeRanges += shard->allocator.freeRangeCount();
+        stats.liveBlocks += shard->blocks.liveCount();
+        stats.metadataBytes += shard->blocks.metadataBytes() + shard->allocator.metadataBytes();
+        stats.largestFree = max(stats.largestFree, shard->allocator.largestFree());
+        stats.fragmentation = max(stats.fragmentation, shard->allocator.fragmentation());
+    }
+    return stats;
+}
+
 // ----------------------------------------------------------------------------------
 // Devuelve un "mapa" de la memoria con informacin detallada
 // ----------------------------------------------------------------------------------
-string MemoryManager::getMemoryMap() const {
-    lock_guard<recursive_mutex> lock(mtx_);
+string MemoryManager::getMemoryMap(size_t maxBytes) const {
+    // Lugar para el aviso de truncado y el cierre
+    const size_t limit = maxBytes > 256 ? maxBytes - 256 : 0;
+    string out = "\n=== Memory Map ===\n";
+    size_t omitted = 0;
     ostringstream oss;
-    oss << "\n=== Memory Map ===\n";
-    for (auto& kv : blocks_) {
-        int bID = kv.first;
-        const BlockInfo& info = kv.second;
-        uintptr_t realAddr = computeRealAddress(info.offset);
-        oss << "ID=" << bID
-            << ", Offset=" << info.offset
-            << ", Address=0x" << hex << realAddr << dec
-            << ", Size=" << info.size
-            << ", Type=" << info.type
-            << ", RefCount=" << info.refCount
-            << ", Value=" << getValue(bID) << "\n";
-    }
-
-    if (!freeBlocks_.empty()) {
-        oss << "\n--- Free Blocks ---\n";
-        for (auto& fb : freeBlocks_) {
-            oss << "Offset=" << fb.offset << ", Size=" << fb.size << "\n";
-        }
-    }
-    oss << "==================\n";
-    return oss.str();
+    for (auto& shard : shards_) {
+        shared_lock<shared_mutex> lock = lockShardShared(*shard);
+        size_t shardIndex = &shard - &shards_[0];
+        shard->blocks.forEachLive([&](uint32_t slot, const BlockInfo& info) {
+            if (omitted > 0) {
+                omitted++;
+                return;
+            }
+            int bID = makeID(shardIndex, slot, info.generation);
+            uintptr_t realAddr = computeRealAddress(info.offset);
+            oss.str("");
+            oss << "ID=" << bID
+                << ", Offset=" << info.offset
+                << ", Address=0x" << hex << realAddr << dec
+                << ", Size=" << info.size
+                << ", Type=" << typeName(info);
+            if (info.flags & HandleTable::SLOT_ARRAY)
+                oss << "[" << info.size / codecFor(info.typeTag).arrayElemSize << "]";
+            string value;
+            formatValue(info, value);
+            oss << ", RefCount=" << info.refCount
+                << ", Value=" << value << "\n";
+            string line = oss.str();
+            if (out.size() + line.size() > limit) {
+                omitted = 1;
+                return;
+            }
+            out += line;
+        });
+    }
+    if (omitted > 0) {
+        out += "... " + to_string(omitted) + " bloques ms (el mapa no entra en una respuesta)\n";
+    }
+
+    bool header = false;
+    size_t omittedFree = 0;
+    for (auto& shard : shards_) {
+        shared_lock<shared_mutex> lock = lockShardShared(*shard);
+        for (auto& fb : shard->allocator.freeRanges()) {
+            if (omitted > 0 || omittedFree > 0) {
+                omittedFree++;
+                continue;
+            }
+            string line = (header ? "" : "\n--- Free Blocks ---\n")
+                + string("Offset=") + to_string(fb.first) + ", Size=" + to_string(fb.second) + "\n";
+            if (out.size() + line.size() > limit) {
+                omittedFree = 1;
+                continue;
+            }
+            out += line;
+            header = true;
+        }
+    }
+    if (omittedFree > 0) {
+        out += "... " + to_string(omittedFree) + " rangos libres ms\n";
+    }
+    out += "==================\n";
+    return out;
 }
 
 // ----------------------------------------------------------------------------------
-// Establece la carpeta de dumps
+// Compacta todos los shards de inmediato
 // ----------------------------------------------------------------------------------
-void MemoryManager::setDumpFolder(const string& folder) {
-    lock_guard<recursive_mutex> lock(mtx_);
-    dumpFolder_ = getProjectDirectory() + folder;
+size_t MemoryManager::compact() {
+    size_t moved = 0;
+    for (auto& shard : shards_) {
+        unique_lock<shared_mutex> lock = lockShard(*shard);
+        // Un ciclo nuevo desde el principio, sin lmite de tiempo
+        shard->compactQueue.clear();
+        shard->compactPos = 0;
+        moved += compactShard(*shard, chrono::steady_clock::time_point::max());
+    }
+    return moved;
+}
 
-    DWORD attrib = GetFileAttributesA(dumpFolder_.c_str());
-    if (attrib == INVALID_FILE_ATTRIBUTES) {
-        CreateDirectoryA(dumpFolder_.c_str(), NULL);
+// ----------------------------------------------------------------------------------
+// Compactacin automtica en pasos acotados (la llaman los reactores entre eventos)
+// ----------------------------------------------------------------------------------
+bool MemoryManager::compactStep(chrono::microseconds budget) {
+    auto deadline = chrono::steady_clock::now() + budget;
+    bool pending = false;
+    for (auto& shard : shards_) {
+        if (!shard->compactPending.load(memory_order_acquire)) continue;
+        // Si otro hilo est usando el shard, se deja para la prxima
+        unique_lock<shared_mutex> lock(shard->mtx, try_to_lock);
+        if (lock.owns_lock()) {
+            compactShard(*shard, deadline);
+        }
+        pending = pending || shard->compactPending.load(memory_order_relaxed);
+        if (chrono::steady_clock::now() >= deadline) {
+            return true;
+        }
     }
+    return pending;
 }
 
 // ----------------------------------------------------------------------------------
-// Genera un volcado de la memoria en un archivo "memory_dump.txt"
+// Un ciclo de compactacin recorre los bloques en orden de offset y desliza cada uno sobre
+// el hueco libre que tenga justo antes; los huecos se van acumulando detrs del ltimo bloque
+// movido, as que al terminar el ciclo el espacio libre del shard queda en un solo rango.
 // ----------------------------------------------------------------------------------
-void MemoryManager::dumpMemory(const string& action) const {
-    if (dumpFolder_.empty()) return;
+size_t MemoryManager::compactShard(Shard& shard, chrono::steady_clock::time_point deadline) {
+    if (shard.compactPos == 0 && shard.compactQueue.empty()) {
+        shard.blocks.forEachLive([&](uint32_t slot, const BlockInfo& info) {
+            shard.compactQueue.push_back({ static_cast<size_t>(info.offset), slot, info.generation });
+        });
+        sort(shard.compactQueue.begin(), shard.compactQueue.end(),
+            [](const Shard::CompactEntry& a, const Shard::CompactEntry& b) { return a.offset < b.offset; });
+    }
 
-    string filename = dumpFolder_ + "\\memory_dump.txt";
-    HANDLE hFile = CreateFileA(filename.c_str(),
-        FILE_APPEND_DATA,
-        0,
-        NULL,
-        OPEN_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        NULL);
-
-    if (hFile == INVALID_HANDLE_VALUE) {
-        cerr << "dumpMemory: No se pudo abrir/crear el archivo de dump." << endl;
-        return;
+    char* base = static_cast<char*>(memoryBlock_);
+    size_t moved = 0;
+    while (shard.compactPos < shard.compactQueue.size()) {
+        const Shard::CompactEntry& entry = shard.compactQueue[shard.compactPos++];
+        BlockInfo* info = shard.blocks.find(entry.slot, entry.generation);
+        if (info == nullptr || info->offset != entry.offset) continue;
+
+        size_t freeStart = shard.allocator.freeBefore(entry.offset);
+        if (freeStart == Allocator::kNoSpace) continue;
+
+        // Los rangos pueden solaparse: memmove. La versin avanza (SeqWrite) y el movimiento se
+        // cuenta aparte para que las transacciones abiertas sobre el bloque no entren en conflicto
+        size_t size = Allocator::roundUp(info->size);
+        {
+            HandleTable::SeqWrite write(*info);
+            memmove(base + freeStart, base + entry.offset, size);
+            info->offset = freeStart;
+        }
+        if (shard.moves.size() <= entry.slot) shard.moves.resize(entry.slot + 1);
+        shard.moves[entry.slot]++;
+        shard.allocator.slideDown(freeStart, entry.offset, size);
+        uint64_t move[2] = { entry.offset, size };
+        logRecord(WriteAheadLog::MOVE, freeStart, reinterpret_cast<const char*>(move), sizeof(move));
+        logSlot(shard, entry.slot, *info);
+        moved++;
+
+        // Se consulta el reloj cada algunos bloques para no pagarlo en cada uno
+        if ((moved & 15) == 0 && chrono::steady_clock::now() >= deadline) {
+            return moved;
+        }
     }
 
-    ostringstream oss;
-    oss << "[" << getCurrentTimestamp() << "] " << action << "\n"
-        << getStatus() << "\n"
-        << getMemoryMap() << "\n";
+    shard.compactQueue.clear();
+    shard.compactPos = 0;
+    shard.compactPending.store(false, memory_order_release);
+    return moved;
+}
 
-    string entry = oss.str();
+// ----------------------------------------------------------------------------------
+// Cabecera, tipos y tablas de bloques de un snapshot (con los mutex de los shards tomados)
+// ----------------------------------------------------------------------------------
+string MemoryManager::snapshotTables(uint64_t logLsn) const {
+    size_t typeCount = typeCount_.load(memory_order_acquire);
+    snapshot::Header header = snapshot::makeHeader(shards_.size(), totalSize_, typeCount, logLsn);
+    string out(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (size_t i = 0; i < typeCount; i++) {
+        uint32_t len = static_cast<uint32_t>(typeNames_[i].size());
+        out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+        out += typeNames_[i];
+    }
+    for (const auto& shard : shards_) {
+        const HandleTable::State& state = shard->blocks.state();
+        out.append(reinterpret_cast<const char*>(&state), sizeof(state));
+        out.append(reinterpret_cast<const char*>(shard->blocks.data()), state.used * sizeof(BlockInfo));
+    }
+    return out;
+}
 
-    DWORD bytesWritten;
-    WriteFile(hFile, entry.c_str(), static_cast<DWORD>(entry.size()), &bytesWritten, NULL);
-    CloseHandle(hFile);
+// Espera al proceso hijo que escribe un snapshot; true si termin bien
+static bool waitSnapshotChild(long child) {
+#ifndef _WIN32
+    int status = 0;
+    return waitpid(static_cast<pid_t>(child), &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+    (void)child;
+    return false;
+#endif
 }
 
 // ----------------------------------------------------------------------------------
-// Fusiona bloques libres adyacentes
+// Snapshot: se congela la memoria con los shards bloqueados solo mientras dura el fork o
+// la copia de la arena; el archivo se escribe en segundo plano y reemplaza al anterior
+// recin cuando est completo
 // ----------------------------------------------------------------------------------
-void MemoryManager::mergeFreeBlocks() {
-    if (freeBlocks_.empty()) return;
+bool MemoryManager::snapshot(const string& path, string& error) {
+    if (!memoryBlock_) {
+        error = "la memoria no est inicializada";
+        return false;
+    }
+    if (backing_.isOpen()) {
+        // El mapeo es compartido: el hijo de un fork vera los cambios, y copiar la arena entera
+        // dejara a todos los clientes esperando. El archivo de respaldo ya guarda la memoria.
+        error = "no disponible con --backing (el archivo de respaldo ya persiste la memoria)";
+        return false;
+    }
+    if (snapshotBusy_.exchange(true)) {
+        error = "ya hay un snapshot en curso";
+        return false;
+    }
+    if (snapshotThread_.joinable()) {
+        snapshotThread_.join();
+    }
 
-    sort(freeBlocks_.begin(), freeBlocks_.end(), [](const FreeBlock& a, const FreeBlock& b) {
-        return a.offset < b.offset;
-        });
+    string tmpPath = path + ".tmp";
+    int fd = snapshot::openWrite(tmpPath);
+    if (fd < 0) {
+        snapshotBusy_.store(false);
+        error = "no se pudo crear '" + tmpPath + "'";
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    string tables;
+    // Copia de la arena cuando no se usa fork
+    vector<char> arena;
+    long child = -1;
+    // El log sigue en un segmento nuevo: el snapshot incluye todo lo anterior a logLsn
+    uint64_t logLsn = 0;
+    runLocked([&]() {
+        if (wal_.isOpen()) logLsn = wal_.rotate();
+        tables = snapshotTables(logLsn);
+#ifndef _WIN32
+        // El hijo ve la memoria tal como est ahora (copy-on-write) mientras el servidor sigue
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Hijo: solo llamadas al sistema, sin reservar memoria ni tomar locks
+            snapshot::Checksum sum;
+            bool ok = snapshot::writeAll(fd, tables.data(), tables.size(), sum)
+                && snapshot::writeAll(fd, static_cast<const char*>(memoryBlock_), totalSize_, sum)
+                && snapshot::writeChecksum(fd, sum);
+            _exit(ok ? 0 : 1);
+        }
+        child = static_cast<long>(pid);
+        if (pid > 0) return;
+#endif
+        const char* base = static_cast<const char*>(memoryBlock_);
+        arena.assign(base, base + totalSize_);
+    });
+    auto paused = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    if (child > 0) {
+        // El hijo tiene su propio descriptor
+        snapshot::closeFile(fd);
+    }
 
-    for (size_t i = 0; i < freeBlocks_.size() - 1;) {
-        if (freeBlocks_[i].offset + freeBlocks_[i].size == freeBlocks_[i + 1].offset) {
-            freeBlocks_[i].size += freeBlocks_[i + 1].size;
-            freeBlocks_.erase(freeBlocks_.begin() + i + 1);
+    snapshotThread_ = thread([this, fd, child, tmpPath, path, start, paused, logLsn,
+        tables = move(tables), arena = move(arena)]() {
+        bool ok;
+        if (child > 0) {
+            ok = waitSnapshotChild(child);
         }
         else {
-            i++;
+            snapshot::Checksum sum;
+            ok = snapshot::writeAll(fd, tables.data(), tables.size(), sum)
+                && snapshot::writeAll(fd, arena.data(), arena.size(), sum)
+                && snapshot::writeChecksum(fd, sum);
+            snapshot::closeFile(fd);
+        }
+        ok = ok && snapshot::replace(tmpPath, path);
+        auto total = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        if (ok && logLsn > 0) {
+            // Los segmentos anteriores al snapshot ya no hacen falta
+            wal_.dropBefore(logLsn);
+        }
+        if (ok) {
+            cout << "MemoryManager: Snapshot escrito en '" << path << "' (" << tables.size() + totalSize_
+                << " bytes, pausa " << paused << " us, total " << total << " ms)." << endl;
+        }
+        else {
+            snapshot::removeFile(tmpPath);
+            cerr << "Error: No se pudo escribir el snapshot '" << path << "'." << endl;
+        }
+        snapshotBusy_.store(false);
+    });
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Restaura un snapshot: tablas y arena se leen directo a su lugar en trozos grandes
+// ----------------------------------------------------------------------------------
+bool MemoryManager::restore(const string& path, const string& backingPath) {
+    if (memoryBlock_) return false;
+    auto start = chrono::steady_clock::now();
+    int fd = snapshot::openRead(path);
+    if (fd < 0) {
+        cerr << "Error: No se pudo abrir el snapshot '" << path << "'." << endl;
+        return false;
+    }
+
+    snapshot::Checksum sum;
+    snapshot::Header header;
+    bool ok = snapshot::readAll(fd, reinterpret_cast<char*>(&header), sizeof(header), sum)
+        && snapshot::isValid(header) && header.typeCount <= kMaxTypes;
+    vector<string> names;
+    for (uint32_t i = 0; ok && i < header.typeCount; i++) {
+        uint32_t len = 0;
+        ok = snapshot::readAll(fd, reinterpret_cast<char*>(&len), sizeof(len), sum) && len <= 4096;
+        if (ok) {
+            string name(len, '\0');
+            ok = snapshot::readAll(fd, &name[0], len, sum);
+            names.push_back(move(name));
+        }
+    }
+    if (!ok) {
+        cerr << "Error: '" << path << "' no es un snapshot vlido." << endl;
+        snapshot::closeFile(fd);
+        return false;
+    }
+
+    // La memoria toma el tamao y los shards del snapshot
+    init(static_cast<size_t>(header.arenaSize), header.shardCount, backingPath);
+    if (!memoryBlock_ || totalSize_ != header.arenaSize || shards_.size() != header.shardCount) {
+        cerr << "Error: La memoria no coincide con el snapshot '" << path << "' ("
+            << header.arenaSize << " bytes en " << header.shardCount << " shard(s))." << endl;
+        snapshot::closeFile(fd);
+        return false;
+    }
+
+    ok = loadTypeNames(names);
+    vector<BlockInfo> slots;
+    for (auto& shard : shards_) {
+        if (!ok) break;
+        HandleTable::State state;
+        ok = snapshot::readAll(fd, reinterpret_cast<char*>(&state), sizeof(state), sum)
+            && state.used <= (1u << kIndexBits);
+        if (ok) {
+            slots.resize(state.used);
+            ok = snapshot::readAll(fd, reinterpret_cast<char*>(slots.data()), slots.size() * sizeof(BlockInfo), sum)
+                && shard->blocks.load(state, slots.data());
+        }
+    }
+    ok = ok && snapshot::readAll(fd, static_cast<char*>(memoryBlock_), totalSize_, sum)
+        && snapshot::verifyChecksum(fd, sum);
+    snapshot::closeFile(fd);
+
+    size_t liveBlocks = 0;
+    for (auto& shard : shards_) {
+        if (!ok) break;
+        // Los leases eran de clientes de la ejecucin que hizo el snapshot
+        shard->blocks.clearFlags(HandleTable::SLOT_LEASED);
+        ok = rebuildShard(*shard, liveBlocks);
+    }
+    if (!ok) {
+        cerr << "Error: El snapshot '" << path << "' est incompleto o daado; la memoria queda vaca." << endl;
+        for (auto& shard : shards_) {
+            shard->blocks.load(HandleTable::State{ 0, HandleTable::kNone, 0 }, nullptr);
+            shard->allocator.reset(shard->base, shard->size);
+            shard->usedSize = 0;
         }
+        return false;
     }
+
+    checkpointLsn_ = header.logLsn;
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    cout << "MemoryManager: Se restaur el snapshot '" << path << "' con " << liveBlocks << " bloque(s) en "
+        << totalSize_ << " bytes y " << shards_.size() << " shard(s) (" << elapsed << " ms)." << endl;
+    return true;
 }
 
 // ----------------------------------------------------------------------------------
-// Genera un timestamp con fecha y hora (ms incluidos)
+// Write-ahead log: se aplica lo registrado desde el checkpoint y se sigue en un segmento nuevo
 // ----------------------------------------------------------------------------------
-string MemoryManager::getCurrentTimestamp() const {
-    auto now = chrono::system_clock::now();
-    auto ms = chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    time_t t = chrono::system_clock::to_time_t(now);
+bool MemoryManager::openLog(const string& path, WalSync mode, chrono::milliseconds interval) {
+    if (!memoryBlock_) return false;
+    if (backing_.isOpen()) {
+        cerr << "Error: El log no se combina con un archivo de respaldo (el archivo ya guarda la memoria)." << endl;
+        return false;
+    }
 
-    tm localTm;
-    localtime_s(&localTm, &t);
+    auto start = chrono::steady_clock::now();
+    size_t applied = 0;
+    uint64_t nextLsn = 0;
+    string error;
+    bool ok = WriteAheadLog::replay(path, shards_.size(), totalSize_, checkpointLsn_,
+        [&](const WriteAheadLog::RecordHeader& record, const char* data) {
+            applied++;
+            return applyLog(record, data);
+        }, nextLsn, error);
+    if (!ok) {
+        cerr << "Error: No se pudo aplicar el log '" << path << "': " << error << "." << endl;
+        return false;
+    }
 
-    ostringstream oss;
-    oss << put_time(&localTm, "%Y-%m-%d %H:%M:%S")
-        << "." << setw(3) << setfill('0') << ms.count();
-    return oss.str();
+    size_t liveBlocks = 0;
+    for (auto& shard : shards_) {
+        shard->blocks.relink();
+        shard->blocks.clearFlags(HandleTable::SLOT_LEASED);
+        if (!rebuildShard(*shard, liveBlocks)) {
+            cerr << "Error: El log '" << path << "' deja bloques fuera de su shard." << endl;
+            return false;
+        }
+    }
+    if (!wal_.open(path, shards_.size(), totalSize_, max<uint64_t>(nextLsn, 1), mode, interval)) {
+        return false;
+    }
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    cout << "MemoryManager: Se aplicaron " << applied << " registro(s) del log '" << path << "' ("
+        << liveBlocks << " bloque(s), " << elapsed << " ms)." << endl;
+    return true;
+}
+
+bool MemoryManager::syncLog() {
+    if (lastLogLsn == 0) return true;
+    bool ok = wal_.waitDurable(lastLogLsn);
+    lastLogLsn = 0;
+    return ok;
+}
+
+// ----------------------------------------------------------------------------------
+// Registros del log
+// ----------------------------------------------------------------------------------
+void MemoryManager::logRecord(uint8_t type, uint64_t target, const char* data, size_t len) {
+    if (!wal_.isOpen()) return;
+    lastLogLsn = wal_.append(type, target, data, len);
+}
+
+void MemoryManager::logSlot(const Shard& shard, uint32_t slot, const BlockInfo& info) {
+    logRecord(WriteAheadLog::SLOT, (uint64_t(shard.index) << 32) | slot, reinterpret_cast<const char*>(&info),
+        sizeof(info));
+}
+
+void MemoryManager::logData(size_t offset, size_t len) {
+    logRecord(WriteAheadLog::DATA, offset, static_cast<const char*>(memoryBlock_) + offset, len);
+}
+
+// ----------------------------------------------------------------------------------
+// Aplica un registro del log (al arrancar, sin clientes)
+// ----------------------------------------------------------------------------------
+bool MemoryManager::applyLog(const WriteAheadLog::RecordHeader& record, const char* data) {
+    char* base = static_cast<char*>(memoryBlock_);
+    // Rango [offset, offset + len) dentro de la arena, sin desbordes
+    auto inArena = [this](uint64_t offset, uint64_t len) {
+        return offset <= totalSize_ && len <= totalSize_ - offset;
+    };
+
+    switch (record.type) {
+    case WriteAheadLog::TYPE: {
+        if (record.target >= kMaxTypes) return false;
+        lock_guard<mutex> lock(typeMtx_);
+        typeNames_[record.target].assign(data, record.length);
+        if (record.target >= typeCount_.load(memory_order_relaxed)) {
+            typeCount_.store(static_cast<size_t>(record.target) + 1, memory_order_release);
+        }
+        return true;
+    }
+    case WriteAheadLog::SLOT: {
+        size_t shardIndex = static_cast<size_t>(record.target >> 32);
+        if (shardIndex >= shards_.size() || record.length != sizeof(BlockInfo)) return false;
+        BlockInfo info;
+        memcpy(&info, data, sizeof(info));
+        return shards_[shardIndex]->blocks.put(static_cast<uint32_t>(record.target), info);
+    }
+    case WriteAheadLog::DATA:
+        if (!inArena(record.target, record.length)) return false;
+        memcpy(base + record.target, data, record.length);
+        return true;
+    case WriteAheadLog::ZERO: {
+        uint64_t len;
+        if (record.length != sizeof(len)) return false;
+        memcpy(&len, data, sizeof(len));
+        if (!inArena(record.target, len)) return false;
+        memset(base + record.target, 0, static_cast<size_t>(len));
+        return true;
+    }
+    case WriteAheadLog::MOVE: {
+        uint64_t move[2];
+        if (record.length != sizeof(move)) return false;
+        memcpy(move, data, sizeof(move));
+        if (!inArena(record.target, move[1]) || !inArena(move[0], move[1])) return false;
+        memmove(base + record.target, base + move[0], static_cast<size_t>(move[1]));
+        return true;
+    }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------------
+// Establece la carpeta de dumps y arranca el hilo que escribe "memory_dump.txt"
+// ----------------------------------------------------------------------------------
+void MemoryManager::setDumpFolder(const string& folder, DumpMode mode, size_t every) {
+    dumpFolder_ = getProjectDirectory() + folder;
+
+#ifdef _WIN32
+    DWORD attrib = GetFileAttributesA(dumpFolder_.c_str());
+    if (attrib == INVALID_FILE_ATTRIBUTES) {
+        CreateDirectoryA(dumpFolder_.c_str(), NULL);
+    }
+    string filename = dumpFolder_ + "\\memory_dump.txt";
+#else
+    mkdir(dumpFolder_.c_str(), 0755);
+    string filename = dumpFolder_ + "/memory_dump.txt";
+#endif
+
+    // La instantnea completa se arma en el hilo de dump, tomando los shards de a uno
+    dumpWriter_.start(filename, mode, every, [this]() {
+        return getStatus() + "\n" + getMemoryMap();
+    });
+}
+
+// ----------------------------------------------------------------------------------
+// Encola el registro de una operacin para el hilo de dump
+// ----------------------------------------------------------------------------------
+void MemoryManager::recordDump(uint8_t op, int blockID, uint32_t arg, const BlockInfo* info, bool liberated) {
+    if (!dumpWriter_.enabled()) return;
+
+    DumpRecord record;
+    record.timeMs = DumpWriter::nowMs();
+    record.blockID = blockID;
+    record.arg = arg;
+    record.op = op;
+    record.liberated = liberated;
+    record.typeTag = info->typeTag;
+    const string& type = typeName(*info);
+    memcpy(record.type, type.data(), min(type.size(), sizeof(record.type)));
+    if (op == DumpRecord::SET) {
+        size_t len = min<size_t>(info->size, sizeof(record.data));
+        memcpy(record.data, static_cast<const char*>(memoryBlock_) + info->offset, len);
+        record.arg = static_cast<uint32_t>(len);
+    }
+    dumpWriter_.push(record);
 }
 
 // ----------------------------------------------------------------------------------
@@ -2,16 +2,28 @@
 #define MEMORY_MANAGER_H
 
 #include <cstddef>
-#include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <vector>
 #include <string>
-#include <windows.h>
+#include <cstring>
+#include <cstdint>
 #include <atomic>
 #include <sstream>
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
+#include <memory>
+#include <thread>
+#include "DumpWriter.h"
+#include "Allocator.h"
+#include "HandleTable.h"
+#include "TypeCodec.h"
+#include "LeaseTable.h"
+#include "MappedFile.h"
+#include "WriteAheadLog.h"
+#include "TransactionTable.h"
+#include "Protocol.h"
 
 // Usamos namespace std
 using namespace std;
@@ -20,32 +32,179 @@ class MemoryManager {
 public:
     static MemoryManager& getInstance();
 
-    // Inicializa el bloque principal de memoria
-    void init(size_t totalSize);
+    // Inicializa el bloque principal de memoria, repartido en 'shardCount' shards independientes.
+    // Cada shard tiene su porcin del bloque, su lista libre, su tabla de bloques y su mutex,
+    // y el ndice del shard va en los bits bajos del ID, as que encontrarlo no cuesta nada.
+    //
+    // Con 'backingPath' la memoria es un archivo mapeado (ver MappedFile) que guarda tambin la
+    // tabla de bloques y los nombres de tipo: al reiniciar con el mismo archivo los bloques y sus
+    // IDs siguen ah, sin repetir ninguna operacin. Si el archivo ya existe, manda su tamao y
+    // su cantidad de shards.
+    void init(size_t totalSize, size_t shardCount = 1, const string& backingPath = "");
 
     // Crea un bloque de 'size' bytes con un tipo 'type' (ej: "int", "double", "string", etc.)
     int createBlock(size_t size, const string& type);
 
+    // Crea un bloque arreglo de 'count' elementos contiguos del tipo 'type' (int, double, float,
+    // bool, char o crudo de a un byte); el ID es uno solo para todo el arreglo
+    int createArray(size_t count, const string& type);
+
     // Escribe 'value' en el bloque identificado por blockID
     void setValue(int blockID, const string& value);
 
-    // Lee el contenido del bloque identificado por blockID
+    // Lee el contenido del bloque identificado por blockID. Los bloques escalares (int, double,
+    // float, long, bool o char de hasta 8 bytes) se leen sin tomar el mutex de su shard.
     string getValue(int blockID) const;
 
+    // Resultado de las lecturas que arman la respuesta de un pedido binario: TooLarge si el
+    // valor no entra en un frame del protocolo (ms de kMaxReplyValue bytes)
+    enum class ReadResult { Ok, Failed, TooLarge };
+    // Deja lugar para el encabezado y para los 4 bytes del lease de OP_GET_LEASE
+    static constexpr size_t kMaxReplyValue = protocol::kMaxFrameSize - protocol::kHeaderSize - 4;
+
+    // Variantes del protocolo binario: el valor viaja en little-endian con ancho fijo
+    // (int 4, long 8, float 4, double 8, bool 1, char 1; string y crudos tal cual)
+    bool setValueBinary(int blockID, const char* data, size_t len);
+    ReadResult getValueBinary(int blockID, string& out) const;
+
+    // Elementos [begin, begin + count) de un arreglo como bytes crudos, en una sola copia.
+    // writeRange escribe len / tamao del elemento elementos a partir de 'begin'.
+    ReadResult readRange(int blockID, size_t begin, size_t count, string& out) const;
+    bool writeRange(int blockID, size_t begin, const char* data, size_t len);
+
+    // Operaciones atmicas sobre bloques escalares int, long, float, double y bool: cada una
+    // lee y escribe el bloque con el mutex de su shard tomado, as que no se intercala con
+    // ninguna otra operacin. 'previous' recibe el valor que tena el bloque.
+    //   Add:             suma 'operand' (no aplica a bool)
+    //   CompareExchange: escribe 'operand' solo si el valor actual es igual (byte a byte) a
+    //                    'expected'; 'swapped' indica si lo escribi
+    //   Exchange:        escribe 'operand'
+    // atomicBinary recibe y entrega los valores en el formato del protocolo binario y atomicText
+    // en texto. false si el bloque no existe, no es de un tipo que lo admita o un valor no es vlido.
+    enum class AtomicOp : uint8_t { Add, CompareExchange, Exchange };
+    bool atomicBinary(int blockID, AtomicOp op, const char* operand, size_t operandLen,
+        const char* expected, size_t expectedLen, string& previous, bool& swapped);
+    bool atomicText(int blockID, AtomicOp op, const string& operand, const string& expected,
+        string& previous, bool& swapped);
+
+    // Transacciones optimistas sobre varios bloques (ver TransactionTable). Las lecturas y
+    // escrituras se hacen con 'tx' y las escrituras quedan pendientes hasta confirmar; no
+    // admiten arreglos. Con 'binary' los valores van en el formato del protocolo binario y si
+    // no, en texto. false si la transaccin o el bloque no existen o el valor no es vlido.
+    // commitTransaction aplica todas las escrituras a la vez si ningn bloque cambi desde que
+    // la transaccin lo toc; si no, la descarta y deja en 'conflictBlock' el bloque que cambi.
+    enum class TxResult { Committed, Conflict, Unknown };
+    uint32_t beginTransaction() { return transactions_.begin(); }
+    bool txGet(uint32_t tx, int blockID, bool binary, string& out);
+    bool txSet(uint32_t tx, int blockID, bool binary, const char* data, size_t len);
+    TxResult commitTransaction(uint32_t tx, int& conflictBlock);
+    bool abortTransaction(uint32_t tx);
+
+    // Leases de lectura para los cachs de los clientes (ver LeaseTable).
+    // getValueLeased lee como getValueBinary y entrega un lease de 'leaseMs' al suscriptor; al
+    // modificar o liberar el bloque se le avisa por su conexin de suscripcin. Despus de
+    // cada peticin, notifyLeaseHolders() enva los avisos de lo que escribi este hilo y
+    // retorna lo que debe esperar su respuesta (nullptr si nada).
+    ReadResult getValueLeased(int blockID, uint32_t subscriber, string& out, uint32_t& leaseMs);
+    uint32_t subscribe(SOCKET sock, LeaseTable::Notifier notify) { return leases_.subscribe(sock, move(notify)); }
+    void unsubscribe(SOCKET sock) { leases_.unsubscribe(sock); }
+    shared_ptr<LeaseTable::Wait> notifyLeaseHolders(function<void()> wake) { return leases_.notify(move(wake)); }
+    void confirmInvalidation(SOCKET sock, uint32_t notice) { leases_.confirm(sock, notice); }
+    void setLeaseDuration(chrono::milliseconds duration) { leases_.setDuration(duration); }
+
     // Incrementa el contador de referencias del bloque
     void increaseRefCount(int blockID);
 
     // Decrementa el contador de referencias del bloque y libera si llega a 0
     void decreaseRefCount(int blockID);
 
+    // Suma 'delta' (positivo o negativo) al contador de referencias y libera el bloque si
+    // llega a 0; es lo que aplica el comando refdelta con los cambios netos de un cliente.
+    // false si el bloque no existe.
+    bool adjustRefCount(int blockID, int delta);
+
     // Devuelve un resumen global de la memoria (tamao total, usado, etc.)
     string getStatus() const;
 
-    // Devuelve un "mapa de memoria" detallado (ID, tipo, direccin, refCount, etc.)
-    string getMemoryMap() const;
+    // Estado de los allocators sumado sobre los shards, para medirlos (ver AllocatorBench)
+    struct AllocatorStats {
+        size_t usedBytes = 0;
+        size_t freeBytes = 0;
+        size_t freeRanges = 0;
+        size_t liveBlocks = 0;
+        // Tablas de bloques ms estructuras de los allocators
+        size_t metadataBytes = 0;
+        // Mayor rango libre de un shard y la peor fragmentacin entre los shards
+        size_t largestFree = 0;
+        double fragmentation = 0.0;
+    };
+    AllocatorStats getAllocatorStats() const;
+
+    // Devuelve un "mapa de memoria" detallado (ID, tipo, direccin, refCount, etc.). Con
+    // 'maxBytes' el mapa se corta antes de pasar ese tamao y avisa cuntas entradas omiti.
+    string getMemoryMap(size_t maxBytes = SIZE_MAX) const;
+
+    // Ejecuta 'fn' con los mutex de todos los shards tomados una sola vez (siempre en el mismo
+    // orden); las operaciones que 'fn' haga sobre el MemoryManager no se intercalan con las de
+    // otros clientes. Mientras tanto el hilo no vuelve a tomar ningn mutex de shard (ver
+    // holdsAllShards_), as que los mutex no necesitan ser recursivos.
+    template <typename F>
+    void runLocked(F&& fn) {
+        if (holdsAllShards_) {
+            fn();
+            return;
+        }
+        vector<unique_lock<shared_mutex>> locks;
+        locks.reserve(shards_.size());
+        for (auto& shard : shards_) {
+            locks.push_back(lockShard(*shard));
+        }
+        struct Release {
+            ~Release() { holdsAllShards_ = false; }
+        } release;
+        holdsAllShards_ = true;
+        fn();
+    }
+
+    // Cantidad de shards
+    size_t getShardCount() const { return shards_.size(); }
+
+    // Compactacin: los clientes solo conocen IDs, as que los bloques vivos se pueden deslizar
+    // hacia el inicio de su shard para juntar el espacio libre en un nico rango.
+    //
+    // compact() compacta todos los shards de inmediato y retorna la cantidad de bloques movidos.
+    size_t compact();
+    // Avanza la compactacin automtica pendiente durante a lo sumo 'budget'; true si queda
+    // trabajo. Un shard queda pendiente cuando su fragmentacin supera el umbral.
+    bool compactStep(chrono::microseconds budget);
+    // Umbral de fragmentacin (1 - mayor rango libre / bytes libres) que dispara la compactacin
+    // automtica; 0 la desactiva
+    void setCompactionThreshold(double threshold) { compactThreshold_ = threshold; }
 
-    // Establece la carpeta para los dumps
-    void setDumpFolder(const string& folder);
+    // Snapshot binario (ver Snapshot.h) de la memoria y la tabla de bloques en 'path'. Los
+    // clientes se detienen solo un instante: en Linux un fork deja al hijo la memoria congelada
+    // por copy-on-write; en Windows se copia la arena a un buffer. La escritura sigue en segundo
+    // plano; false (con 'error') si no pudo empezar. No est disponible con archivo de respaldo.
+    bool snapshot(const string& path, string& error);
+
+    // Inicializa desde un snapshot en lugar de init(), con su tamao y sus shards (sobre
+    // 'backingPath' si se indica); false si el archivo no es vlido o est daado
+    bool restore(const string& path, const string& backingPath = "");
+
+    // Write-ahead log (ver WriteAheadLog): aplica los segmentos de 'path' sobre la memoria ya
+    // inicializada o restaurada de un snapshot y abre uno nuevo para los cambios que sigan.
+    // No se combina con archivo de respaldo; false (con el motivo en cerr) si el log no sirve.
+    bool openLog(const string& path, WalSync mode, chrono::milliseconds interval);
+
+    // Espera a que los cambios hechos por este hilo estn en disco (solo con --walSync always);
+    // el servidor lo llama antes de responder, sin ningn mutex tomado. false si el hilo hizo
+    // cambios que no quedaron en el log (error de escritura o log ya fallido): el cambio est
+    // aplicado en memoria pero no sobrevivira a una cada, y el cliente recibe un error.
+    bool syncLog();
+
+    // Establece la carpeta para los dumps y arranca el hilo que los escribe
+    // ('every': cada cuntas operaciones se escribe el estado completo, ver DumpWriter)
+    void setDumpFolder(const string& folder, DumpMode mode = DumpMode::Delta, size_t every = 0);
 
     ~MemoryManager();
 
@@ -54,54 +213,195 @@ private:
     MemoryManager(const MemoryManager&) = delete;
     MemoryManager& operator=(const MemoryManager&) = delete;
 
-    // Estructura que describe un bloque ocupado
-    struct BlockInfo {
-        size_t offset;        // Desplazamiento dentro del bloque principal
-        size_t size;          // Tamao en bytes del bloque
-        string type;          // Tipo (por ejemplo, "int", "double", "string", etc.)
-        int refCount = 1;     // Contador de referencias
-    };
+    // Metadatos de un bloque ocupado (slot de 24 bytes de la HandleTable del shard)
+    using BlockInfo = HandleTable::Slot;
+
+    // Formato del ID: bits 0..23 = (slot << shardBits_) | shard, bits 24..30 = generacin
+    static constexpr int kIndexBits = 24;
 
-    // Estructura que describe un bloque libre
-    struct FreeBlock {
-        size_t offset;
-        size_t size;
+    // Porcin independiente del MemoryManager; los offsets son relativos a memoryBlock_
+    struct Shard {
+        // Exclusivo para toda modificacin del shard; compartido para las lecturas que no van
+        // por el camino sin lock (strings, arreglos, estado y mapa de memoria)
+        mutable shared_mutex mtx;
+        // Posicin en shards_ (va en los registros del log)
+        size_t index = 0;
+        // Inicio y tamao de la porcin del bloque principal
+        size_t base = 0;
+        size_t size = 0;
+        // Tamao en uso (redondeado como lo reserva el allocator)
+        size_t usedSize = 0;
+        // Tabla de bloques indexada por el slot del ID
+        HandleTable blocks;
+        // Rangos libres de la porcin
+        Allocator allocator;
+        // Compactacin incremental: bloques vivos ordenados por offset al empezar el ciclo
+        // (slot y generacin para descartar los que se liberen mientras tanto)
+        struct CompactEntry {
+            size_t offset;
+            uint32_t slot;
+            uint16_t generation;
+        };
+        vector<CompactEntry> compactQueue;
+        size_t compactPos = 0;
+        atomic<bool> compactPending{ false };
+        // Bloques movidos por la compactacin, por slot: cada movimiento avanza la versin del
+        // slot (para los lectores sin lock) sin cambiar el valor (ver txVersion)
+        vector<uint32_t> moves;
     };
 
-    // Bloque principal reservado con malloc
+    // Encabezado del archivo de respaldo (definido en MemoryManager.cpp)
+    struct ArenaHeader;
+
+    // Bloque principal reservado con malloc, o dentro del archivo mapeado si hay respaldo
     void* memoryBlock_;
     // Tamao total del bloque
     size_t totalSize_;
-    // Tamao en uso
-    size_t usedSize_;
-    // Generador de IDs nicos
-    int nextID_;
 
-    // Mapa de IDs a info de bloque
-    map<int, BlockInfo> blocks_;
-    // Lista de bloques libres
-    vector<FreeBlock> freeBlocks_;
+    // Archivo de respaldo y su encabezado (nullptr sin respaldo)
+    MappedFile backing_;
+    ArenaHeader* header_;
+
+    // Shards y cantidad de bits del ID que indican el shard
+    vector<unique_ptr<Shard>> shards_;
+    int shardBits_;
+
+    // Nombres de tipo internados: cada bloque guarda solo el ndice (typeTag). Las entradas
+    // nunca cambian una vez publicadas, as que se leen sin lock.
+    static constexpr size_t kMaxTypes = 256;
+    string typeNames_[kMaxTypes];
+    atomic<size_t> typeCount_;
+    mutex typeMtx_;
+
+    double compactThreshold_;
+
+    // Leases de lectura entregados a los clientes
+    LeaseTable leases_;
+
+    // Transacciones abiertas
+    TransactionTable transactions_;
+
+    // Log de cambios y LSN desde el que se aplica al arrancar (el del snapshot restaurado)
+    WriteAheadLog wal_;
+    uint64_t checkpointLsn_;
 
-    // Mutex recursivo para sincronizacin
-    mutable recursive_mutex mtx_;
+    // Snapshot en segundo plano (uno a la vez)
+    atomic<bool> snapshotBusy_;
+    thread snapshotThread_;
 
-    // Carpeta donde se guardan los dumps
+    // Carpeta donde se guardan los dumps y el hilo que los escribe
     string dumpFolder_;
+    DumpWriter dumpWriter_;
 
-    // Genera un volcado (dump) de la memoria en un archivo, registrando la accin realizada
-    void dumpMemory(const string& action) const;
+    // Arma el ID de un bloque a partir de su shard, su slot y la generacin del slot
+    int makeID(size_t shardIndex, uint32_t slot, uint16_t generation) const {
+        return static_cast<int>((uint32_t(generation) << kIndexBits) | (slot << shardBits_) | uint32_t(shardIndex));
+    }
 
-    // Fusiona bloques libres adyacentes
-    void mergeFreeBlocks();
+    // Shard al que pertenece un ID (nullptr si el ID no es vlido)
+    Shard* shardFor(int blockID) const;
 
-    // Genera un timestamp con fecha y hora
-    string getCurrentTimestamp() const;
+    // Busca un bloque del shard (con su mutex ya tomado); nullptr si no existe
+    BlockInfo* findBlock(Shard& shard, int blockID) const;
+
+    // El hilo est dentro de runLocked(): ya tiene todos los mutex de shard
+    static thread_local bool holdsAllShards_;
+
+    // Toman el mutex de un shard, exclusivo o compartido; si estaba ocupado, registran cunto se
+    // esper (ver Metrics). Dentro de runLocked() retornan un lock vaco.
+    static unique_lock<shared_mutex> lockShard(Shard& shard);
+    static shared_lock<shared_mutex> lockShardShared(Shard& shard);
+
+    // Busca un bloque tomando el mutex de su shard en 'lock'; nullptr si no existe
+    BlockInfo* lockBlock(int blockID, unique_lock<shared_mutex>& lock) const;
+    const BlockInfo* lockBlockShared(int blockID, shared_lock<shared_mutex>& lock) const;
+
+    // Slot y generacin que codifica un ID
+    uint32_t slotOf(int blockID) const {
+        return (static_cast<uint32_t>(blockID) & ((1u << kIndexBits) - 1)) >> shardBits_;
+    }
+    static uint16_t generationOf(int blockID) {
+        return static_cast<uint16_t>(static_cast<uint32_t>(blockID) >> kIndexBits);
+    }
+
+    // Lectura sin lock de un bloque escalar (ver HandleTable::readConsistent): copia el slot en
+    // 'info' y el valor en 'value'. false si hay que leer con el mutex (el bloque no es escalar
+    // o los escritores no dejaron leer); si el bloque no existe, true con 'info' libre.
+    static constexpr size_t kScalarBytes = 8;
+    bool readScalar(int blockID, BlockInfo& info, char (&value)[kScalarBytes]) const;
+
+    // Texto del valor de un bloque (con el mutex de su shard tomado), como lo muestra getValue
+    void formatValue(const BlockInfo& info, string& out) const;
+
+    // Mueve bloques del shard (con su mutex tomado) hasta terminar el ciclo o llegar a
+    // 'deadline'; retorna la cantidad movida. Al terminar el ciclo deja de estar pendiente.
+    size_t compactShard(Shard& shard, chrono::steady_clock::time_point deadline);
+
+    // Ubica el bloque en algn shard (compactando si hace falta); -1 si no hay espacio
+    int placeBlock(size_t size, uint8_t typeTag, uint8_t flags);
+
+    // Crea el bloque dentro de un shard; -1 si no hay espacio en ese shard
+    int createInShard(size_t shardIndex, size_t size, uint8_t typeTag, uint8_t flags);
+
+    // Offset y bytes de los elementos [begin, begin + count) de un arreglo; false si el bloque
+    // no es un arreglo o el rango se sale de l
+    static bool arrayRange(const BlockInfo& info, size_t begin, size_t count, size_t& offset, size_t& bytes);
+
+    // Texto de un arreglo ("[1, 2, 3]"), con a lo sumo kMaxArrayText elementos
+    static constexpr size_t kMaxArrayText = 64;
+    void formatArray(const BlockInfo& info, string& out) const;
+
+    // ndice del nombre de tipo (lo agrega si es nuevo); -1 si la tabla est llena o, con
+    // archivo de respaldo, si el nombre no entra en el encabezado
+    int internType(const string& type);
+    const string& typeName(const BlockInfo& info) const { return typeNames_[info.typeTag]; }
+
+    // Encola el registro de una operacin para el hilo de dump (no bloquea ni formatea nada).
+    // En SET se copian los primeros bytes del bloque tal como quedaron en memoria.
+    void recordDump(uint8_t op, int blockID, uint32_t arg, const BlockInfo* info, bool liberated = false);
+
+    // Bloque de una operacin atmica (con su mutex tomado en 'lock'); nullptr si no existe o
+    // su tipo no admite la operacin
+    BlockInfo* lockAtomic(int blockID, AtomicOp op, unique_lock<shared_mutex>& lock, const char* caller) const;
+
+    // Aplica la operacin con los valores ya en el formato del bloque; retorna 'swapped'
+    bool applyAtomic(int blockID, BlockInfo& info, AtomicOp op, const char* operand, const char* expected);
+
+    // Bloque de una operacin dentro de una transaccin (con su mutex tomado en 'lock');
+    // nullptr si no existe o es un arreglo
+    const BlockInfo* lockTxBlock(int blockID, shared_lock<shared_mutex>& lock, const char* caller) const;
+
+    // Versin que comparan las transacciones (con el mutex del shard tomado): la del slot sin
+    // los avances de la compactacin, as que solo cambia cuando se escribe el valor
+    uint32_t txVersion(int blockID, const BlockInfo& info) const;
+
+    // Si el bloque tiene leases, deja pendientes los avisos a sus suscriptores (con el mutex
+    // del shard tomado; ver notifyLeaseHolders)
+    void invalidateLeases(int blockID, BlockInfo& info);
+
+    // Recalcula usedSize y los rangos libres del shard desde sus bloques vivos y suma estos a
+    // 'live'; false si algn bloque se sale del shard
+    bool rebuildShard(Shard& shard, size_t& live);
+
+    // Reemplaza los nombres de tipo (al reabrir o restaurar); false si no corresponden
+    bool loadTypeNames(const vector<string>& names);
+
+    // Cabecera, tipos y tablas de bloques de un snapshot (con los mutex de los shards tomados)
+    string snapshotTables(uint64_t logLsn) const;
+
+    // Registros del log (con el mutex del shard tomado); no hacen nada sin log
+    void logRecord(uint8_t type, uint64_t target, const char* data, size_t len);
+    void logSlot(const Shard& shard, uint32_t slot, const BlockInfo& info);
+    void logData(size_t offset, size_t len);
+
+    // Aplica un registro del log al arrancar; false si no corresponde a esta memoria
+    bool applyLog(const WriteAheadLog::RecordHeader& record, const char* data);
+
+    // Formatea o retoma el archivo de respaldo y reparte su arena entre los shards
+    bool initBacked(size_t totalSize, size_t shardCount, const string& path);
 
     // Para obtener la direccin real en memoria de un offset
     uintptr_t computeRealAddress(size_t offset) const;
-
-    // Determina el tamao mnimo requerido para un tipo dado
-    static size_t getMinSizeForType(const string& type);
 };
 
 #endif // MEMORY_MANAGER_H
@@ -1,16 +1,23 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "Socket.h"
 #include "MemoryManager.h"
+#include "Protocol.h"
+#include "Reactor.h"
+#include "SharedMemoryServer.h"
+#include "Metrics.h"
 #include <exception>
-
-#pragma comment(lib, "Ws2_32.lib")
+#include <vector>
+#include <thread>
+#include <algorithm>
 
 using namespace std;
 
-bool parseArguments(int argc, char** argv, int& port, size_t& memSizeBytes, string& dumpFolder) {
+bool parseArguments(int argc, char** argv, int& port, size_t& memSizeBytes, string& dumpFolder, size_t& threads,
+    DumpMode& dumpMode, size_t& dumpEvery, double& compactThreshold, size_t& leaseMs,
+    string& backingPath, string& restorePath, string& walPath, WalSync& walSync, size_t& walGroupMs,
+    size_t& shmChannels) {
     // Lectura básica de argumentos
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
@@ -23,24 +30,591 @@ bool parseArguments(int argc, char** argv, int& port, size_t& memSizeBytes, stri
         else if (arg == "--dumpFolder" && i + 1 < argc) {
             dumpFolder = argv[++i];
         }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = stoul(argv[++i]);
+        }
+        else if (arg == "--dumpMode" && i + 1 < argc) {
+            if (!DumpWriter::parseMode(argv[++i], dumpMode)) return false;
+        }
+        else if (arg == "--dumpEvery" && i + 1 < argc) {
+            dumpEvery = stoul(argv[++i]);
+        }
+        else if (arg == "--compactThreshold" && i + 1 < argc) {
+            compactThreshold = stod(argv[++i]);
+        }
+        else if (arg == "--leaseMs" && i + 1 < argc) {
+            leaseMs = stoul(argv[++i]);
+        }
+        else if (arg == "--backing" && i + 1 < argc) {
+            backingPath = argv[++i];
+        }
+        else if (arg == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        }
+        else if (arg == "--wal" && i + 1 < argc) {
+            walPath = argv[++i];
+        }
+        else if (arg == "--walSync" && i + 1 < argc) {
+            if (!WriteAheadLog::parseSync(argv[++i], walSync)) return false;
+        }
+        else if (arg == "--walGroupMs" && i + 1 < argc) {
+            walGroupMs = stoul(argv[++i]);
+        }
+        else if (arg == "--shmChannels" && i + 1 < argc) {
+            shmChannels = stoul(argv[++i]);
+        }
     }
-    return !dumpFolder.empty() && port > 0 && memSizeBytes > 0;
+    return !dumpFolder.empty() && port > 0 && memSizeBytes > 0 && threads > 0;
+}
+
+// Aplica el cambio neto de refCount de un bloque (refdelta); false si el bloque no existe
+bool applyRefDelta(int id, int delta) {
+    if (MemoryManager::getInstance().adjustRefCount(id, delta)) return true;
+    cerr << "refdelta: Bloque " << id << " no encontrado." << endl;
+    return false;
 }
 
-void runServer(int port, size_t memSizeBytes, const string& dumpFolder) {
-    // Inicializa Winsock
-    WSADATA wsaData;
-    int wsaResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (wsaResult != 0) {
-        cerr << "[SERVIDOR] WSAStartup falló: " << wsaResult << endl;
+// Opcode con el que se mide un comando de texto: el del mismo nombre, o OP_TEXT
+uint8_t textOpcode(const string& cmd) {
+    for (uint8_t op = 1; op < Metrics::kMaxOps; op++) {
+        const char* name = protocol::opcodeName(op);
+        if (name && cmd == name) return op;
+    }
+    return protocol::OP_TEXT;
+}
+
+// Procesa un comando de texto y retorna la respuesta para el cliente
+string processCommand(const string& command) {
+    istringstream iss(command);
+    string cmd;
+    iss >> cmd;
+    Metrics::OpTimer timer(textOpcode(cmd));
+
+    string reply;
+    if (cmd == "create") {
+        size_t size;
+        string type;
+        iss >> size >> type;
+        int blockID = MemoryManager::getInstance().createBlock(size, type);
+        if (blockID < 0) {
+            reply = "Error al crear bloque (espacio insuficiente o inválido).";
+        }
+        else {
+            reply = "Bloque creado con ID=" + to_string(blockID);
+        }
+    }
+    else if (cmd == "createarray") {
+        // createarray <cantidad> <tipo>
+        size_t count;
+        string type;
+        iss >> count >> type;
+        int blockID = MemoryManager::getInstance().createArray(count, type);
+        if (blockID < 0) {
+            reply = "Error al crear arreglo (espacio insuficiente o inválido).";
+        }
+        else {
+            reply = "Arreglo creado con ID=" + to_string(blockID);
+        }
+    }
+    else if (cmd == "set") {
+        int id;
+        iss >> id;
+        string value;
+        getline(iss, value); // Lee el resto de la línea
+        // Elimina espacios en blanco iniciales
+        size_t start = value.find_first_not_of(" ");
+        if (start != string::npos) {
+            value = value.substr(start);
+        }
+        else {
+            value = "";
+        }
+        MemoryManager::getInstance().setValue(id, value);
+        reply = "Valor asignado al bloque " + to_string(id);
+    }
+    else if (cmd == "get") {
+        int id;
+        iss >> id;
+        string val = MemoryManager::getInstance().getValue(id);
+        reply = "Bloque " + to_string(id) + " -> " + val;
+    }
+    else if (cmd == "increase") {
+        int id;
+        iss >> id;
+        MemoryManager::getInstance().increaseRefCount(id);
+        reply = "RefCount incrementado en bloque " + to_string(id);
+    }
+    else if (cmd == "decrease") {
+        int id;
+        iss >> id;
+        MemoryManager::getInstance().decreaseRefCount(id);
+        reply = "RefCount decrementado en bloque " + to_string(id);
+    }
+    else if (cmd == "refdelta") {
+        // refdelta <id> <+n|-n> [<id> <+n|-n> ...]
+        int id, delta;
+        size_t applied = 0;
+        while (iss >> id >> delta) {
+            if (applyRefDelta(id, delta)) applied++;
+        }
+        reply = "RefCount ajustado en " + to_string(applied) + " bloques";
+    }
+    else if (cmd == "add" || cmd == "cas" || cmd == "xchg") {
+        // add <id> <delta> | cas <id> <esperado> <nuevo> | xchg <id> <valor>
+        typedef MemoryManager::AtomicOp AtomicOp;
+        AtomicOp op = cmd == "add" ? AtomicOp::Add : cmd == "cas" ? AtomicOp::CompareExchange : AtomicOp::Exchange;
+        int id = -1;
+        string operand, expected, previous;
+        iss >> id;
+        if (op == AtomicOp::CompareExchange) iss >> expected;
+        iss >> operand;
+        bool swapped = true;
+        if (operand.empty()) {
+            reply = "Uso: add <id> <delta> | cas <id> <esperado> <nuevo> | xchg <id> <valor>";
+        }
+        else if (!MemoryManager::getInstance().atomicText(id, op, operand, expected, previous, swapped)) {
+            reply = "Error: operación no válida sobre el bloque " + to_string(id);
+        }
+        else {
+            reply = "Valor anterior del bloque " + to_string(id) + ": " + previous;
+            if (op == AtomicOp::CompareExchange) reply += swapped ? " (intercambiado)" : " (sin cambios)";
+        }
+    }
+    else if (cmd == "begin") {
+        uint32_t tx = MemoryManager::getInstance().beginTransaction();
+        reply = tx != 0 ? "Transacción iniciada con TX=" + to_string(tx) : "Error: demasiadas transacciones abiertas";
+    }
+    else if (cmd == "tget") {
+        // tget <tx> <id>
+        uint32_t tx = 0;
+        int id = -1;
+        iss >> tx >> id;
+        string val;
+        if (MemoryManager::getInstance().txGet(tx, id, false, val)) {
+            reply = "Bloque " + to_string(id) + " -> " + val;
+        }
+        else {
+            reply = "Error: lectura no válida en la transacción " + to_string(tx);
+        }
+    }
+    else if (cmd == "tset") {
+        // tset <tx> <id> <valor>
+        uint32_t tx = 0;
+        int id = -1;
+        iss >> tx >> id;
+        string value;
+        getline(iss, value);
+        size_t start = value.find_first_not_of(" ");
+        value = start != string::npos ? value.substr(start) : "";
+        if (MemoryManager::getInstance().txSet(tx, id, false, value.data(), value.size())) {
+            reply = "Valor pendiente en bloque " + to_string(id) + " (TX=" + to_string(tx) + ")";
+        }
+        else {
+            reply = "Error: escritura no válida en la transacción " + to_string(tx);
+        }
+    }
+    else if (cmd == "commit") {
+        uint32_t tx = 0;
+        iss >> tx;
+        int conflictBlock = 0;
+        switch (MemoryManager::getInstance().commitTransaction(tx, conflictBlock)) {
+        case MemoryManager::TxResult::Committed:
+            reply = "Transacción " + to_string(tx) + " confirmada";
+            break;
+        case MemoryManager::TxResult::Conflict:
+            reply = "Conflicto: transacción " + to_string(tx) + " descartada (el bloque "
+                + to_string(conflictBlock) + " cambió)";
+            break;
+        case MemoryManager::TxResult::Unknown:
+            reply = "Error: transacción " + to_string(tx) + " no encontrada";
+            break;
+        }
+    }
+    else if (cmd == "abort") {
+        uint32_t tx = 0;
+        iss >> tx;
+        reply = MemoryManager::getInstance().abortTransaction(tx)
+            ? "Transacción " + to_string(tx) + " descartada"
+            : "Error: transacción " + to_string(tx) + " no encontrada";
+    }
+    else if (cmd == "status") {
+        reply = MemoryManager::getInstance().getStatus();
+    }
+    else if (cmd == "map") {
+        reply = MemoryManager::getInstance().getMemoryMap(protocol::kMaxFrameSize);
+    }
+    else if (cmd == "stats") {
+        // stats [json]
+        string format;
+        iss >> format;
+        reply = format == "json" ? Metrics::getInstance().reportJson() : Metrics::getInstance().report();
+    }
+    else if (cmd == "snapshot") {
+        // snapshot <archivo>
+        string path, error;
+        iss >> path;
+        if (path.empty()) {
+            reply = "Uso: snapshot <archivo>";
+        }
+        else if (MemoryManager::getInstance().snapshot(path, error)) {
+            reply = "Snapshot en curso en " + path;
+        }
+        else {
+            reply = "Error en snapshot: " + error;
+        }
+    }
+    else if (cmd == "compact") {
+        size_t moved = MemoryManager::getInstance().compact();
+        reply = "Compactación completada: " + to_string(moved) + " bloques movidos";
+    }
+    else {
+        reply = "Comando inválido";
+    }
+    return reply;
+}
+
+void processBinary(const protocol::Message& req, protocol::Message& resp);
+
+// Estado de la respuesta a una lectura: un valor que no entra en un frame se rechaza como
+// pedido inválido (el cliente debe leerlo por rangos más chicos)
+uint16_t readStatus(MemoryManager::ReadResult result) {
+    switch (result) {
+    case MemoryManager::ReadResult::Ok:
+        return protocol::STATUS_OK;
+    case MemoryManager::ReadResult::TooLarge:
+        return protocol::STATUS_BAD_REQUEST;
+    default:
+        return protocol::STATUS_ERROR;
+    }
+}
+
+// Operaciones de un lote que se ejecutan juntas con una sola toma de los mutex de shard
+constexpr size_t kLockedBatchOps = 1024;
+// Lugar que se reserva en la respuesta de un lote por cada operación que falta: su encabezado
+// más el valor previo de una operación atómica, para que una escritura ya aplicada siempre
+// pueda responderse
+constexpr size_t kBatchReplyReserve = protocol::kHeaderSize + 16;
+
+// Procesa un lote y devuelve las respuestas en el mismo orden. Las operaciones sobre bloques
+// se agrupan en tandas de hasta kLockedBatchOps que se ejecutan con una sola toma de los mutex
+// de todos los shards; las de arreglos (crear, leer o escribir un rango) pueden mover millones
+// de bytes y se ejecutan solas, con los locks de su propio shard, para no frenar al resto de
+// los hilos. Si la respuesta ya no entra en un frame, esa operación y las siguientes (que no se
+// ejecutan) se responden con STATUS_ERROR; solo puede pasar con lecturas.
+void processBatch(const protocol::Message& req, protocol::Message& resp) {
+    if (req.payload.size() < 4) {
+        resp.header.status = protocol::STATUS_BAD_REQUEST;
         return;
     }
+    uint32_t count = protocol::getU32(req.payload.data());
+    if (count > protocol::kMaxBatchOps) {
+        resp.header.status = protocol::STATUS_BAD_REQUEST;
+        return;
+    }
+
+    // Se decodifica el lote completo antes de tomar el mutex
+    vector<protocol::Message> ops(count);
+    size_t pos = 4;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!protocol::readMessage(req.payload, pos, ops[i])) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            return;
+        }
+    }
+
+    resp.payload.resize(4);
+    protocol::putU32(&resp.payload[0], count);
+    bool full = false;
+    protocol::Message sub;
+    auto step = [&](size_t i) {
+        protocol::Message& op = ops[i];
+        if (full) {
+            sub.header = op.header;
+            sub.header.status = protocol::STATUS_ERROR;
+            sub.payload.clear();
+            protocol::appendMessage(resp.payload, sub);
+            return;
+        }
+        switch (op.header.opcode) {
+        case protocol::OP_CREATE:
+        case protocol::OP_SET:
+        case protocol::OP_GET:
+        case protocol::OP_INCREASE:
+        case protocol::OP_DECREASE:
+        case protocol::OP_REFDELTA:
+        case protocol::OP_CREATE_ARRAY:
+        case protocol::OP_READ_RANGE:
+        case protocol::OP_WRITE_RANGE:
+        case protocol::OP_ATOMIC_ADD:
+        case protocol::OP_ATOMIC_CAS:
+        case protocol::OP_ATOMIC_XCHG:
+            processBinary(op, sub);
+            break;
+        default:
+            // Dentro de un lote solo se admiten operaciones sobre bloques
+            sub.header = op.header;
+            sub.header.status = protocol::STATUS_BAD_REQUEST;
+            sub.payload.clear();
+            break;
+        }
+        size_t reserved = (count - i - 1) * kBatchReplyReserve;
+        if (resp.payload.size() + protocol::kHeaderSize + sub.payload.size() + reserved > protocol::kMaxFrameSize) {
+            full = true;
+            sub.header.status = protocol::STATUS_ERROR;
+            sub.payload.clear();
+        }
+        protocol::appendMessage(resp.payload, sub);
+    };
+    auto isArrayOp = [](uint8_t opcode) {
+        return opcode == protocol::OP_CREATE_ARRAY || opcode == protocol::OP_READ_RANGE
+            || opcode == protocol::OP_WRITE_RANGE;
+    };
+
+    MemoryManager& mm = MemoryManager::getInstance();
+    size_t i = 0;
+    while (i < count) {
+        if (full || isArrayOp(ops[i].header.opcode)) {
+            step(i++);
+            continue;
+        }
+        size_t end = i;
+        while (end < count && end - i < kLockedBatchOps && !isArrayOp(ops[end].header.opcode)) {
+            end++;
+        }
+        mm.runLocked([&]() {
+            for (; i < end; i++) step(i);
+        });
+    }
+}
+
+// Procesa un mensaje del protocolo binario y llena la respuesta (OP_TEXT se mide como el
+// comando que transporta; las operaciones de un lote se miden cada una y también el lote)
+void processBinary(const protocol::Message& req, protocol::Message& resp) {
+    Metrics::OpTimer timer(req.header.opcode == protocol::OP_TEXT ? 0 : req.header.opcode);
+    MemoryManager& mm = MemoryManager::getInstance();
+    resp.header.opcode = req.header.opcode;
+    resp.header.requestId = req.header.requestId;
+    resp.header.blockId = req.header.blockId;
+    resp.header.status = protocol::STATUS_OK;
+    resp.payload.clear();
+
+    int id = req.header.blockId;
+    switch (req.header.opcode) {
+    case protocol::OP_CREATE: {
+        if (req.payload.size() < 4) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        size_t size = protocol::getU32(req.payload.data());
+        int blockID = mm.createBlock(size, req.payload.substr(4));
+        resp.header.blockId = blockID;
+        if (blockID < 0) resp.header.status = protocol::STATUS_ERROR;
+        break;
+    }
+    case protocol::OP_CREATE_ARRAY: {
+        if (req.payload.size() < 4) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        size_t count = protocol::getU32(req.payload.data());
+        int blockID = mm.createArray(count, req.payload.substr(4));
+        resp.header.blockId = blockID;
+        if (blockID < 0) resp.header.status = protocol::STATUS_ERROR;
+        break;
+    }
+    case protocol::OP_READ_RANGE:
+        if (req.payload.size() < 8) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        resp.header.status = readStatus(mm.readRange(id, protocol::getU32(req.payload.data()),
+            protocol::getU32(req.payload.data() + 4), resp.payload));
+        break;
+    case protocol::OP_WRITE_RANGE:
+        if (req.payload.size() < 4) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        if (!mm.writeRange(id, protocol::getU32(req.payload.data()), req.payload.data() + 4, req.payload.size() - 4))
+            resp.header.status = protocol::STATUS_ERROR;
+        break;
+    case protocol::OP_SET:
+        if (!mm.setValueBinary(id, req.payload.data(), req.payload.size()))
+            resp.header.status = protocol::STATUS_ERROR;
+        break;
+    case protocol::OP_GET:
+        resp.header.status = readStatus(mm.getValueBinary(id, resp.payload));
+        break;
+    case protocol::OP_ATOMIC_ADD:
+    case protocol::OP_ATOMIC_XCHG: {
+        bool swapped;
+        MemoryManager::AtomicOp op = req.header.opcode == protocol::OP_ATOMIC_ADD
+            ? MemoryManager::AtomicOp::Add : MemoryManager::AtomicOp::Exchange;
+        if (!mm.atomicBinary(id, op, req.payload.data(), req.payload.size(), nullptr, 0, resp.payload, swapped))
+            resp.header.status = protocol::STATUS_ERROR;
+        break;
+    }
+    case protocol::OP_ATOMIC_CAS: {
+        uint32_t expectedLen = req.payload.size() >= 4 ? protocol::getU32(req.payload.data()) : 0;
+        if (req.payload.size() < 4 || req.payload.size() - 4 < expectedLen) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        const char* expected = req.payload.data() + 4;
+        bool swapped = false;
+        string previous;
+        if (!mm.atomicBinary(id, MemoryManager::AtomicOp::CompareExchange, expected + expectedLen,
+                req.payload.size() - 4 - expectedLen, expected, expectedLen, previous, swapped)) {
+            resp.header.status = protocol::STATUS_ERROR;
+            break;
+        }
+        resp.payload.assign(1, swapped ? '\1' : '\0');
+        resp.payload += previous;
+        break;
+    }
+    case protocol::OP_TX_BEGIN: {
+        uint32_t tx = mm.beginTransaction();
+        if (tx == 0) {
+            resp.header.status = protocol::STATUS_ERROR;
+            break;
+        }
+        resp.payload.resize(4);
+        protocol::putU32(&resp.payload[0], tx);
+        break;
+    }
+    case protocol::OP_TX_GET:
+    case protocol::OP_TX_SET:
+    case protocol::OP_TX_COMMIT:
+    case protocol::OP_TX_ABORT: {
+        if (req.payload.size() < 4) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        uint32_t tx = protocol::getU32(req.payload.data());
+        bool ok = true;
+        if (req.header.opcode == protocol::OP_TX_GET) {
+            ok = mm.txGet(tx, id, true, resp.payload);
+        }
+        else if (req.header.opcode == protocol::OP_TX_SET) {
+            ok = mm.txSet(tx, id, true, req.payload.data() + 4, req.payload.size() - 4);
+        }
+        else if (req.header.opcode == protocol::OP_TX_ABORT) {
+            ok = mm.abortTransaction(tx);
+        }
+        else {
+            int conflictBlock = 0;
+            MemoryManager::TxResult result = mm.commitTransaction(tx, conflictBlock);
+            ok = result != MemoryManager::TxResult::Unknown;
+            if (result == MemoryManager::TxResult::Conflict) {
+                resp.header.status = protocol::STATUS_CONFLICT;
+                resp.header.blockId = conflictBlock;
+            }
+        }
+        if (!ok) resp.header.status = protocol::STATUS_ERROR;
+        break;
+    }
+    case protocol::OP_INCREASE:
+        mm.increaseRefCount(id);
+        break;
+    case protocol::OP_DECREASE:
+        mm.decreaseRefCount(id);
+        break;
+    case protocol::OP_REFDELTA: {
+        uint32_t count = req.payload.size() >= 4 ? protocol::getU32(req.payload.data()) : 0;
+        if (req.payload.size() < 4 || (req.payload.size() - 4) / 8 < count) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        uint32_t applied = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const char* entry = req.payload.data() + 4 + i * 8;
+            int blockID = static_cast<int>(protocol::getU32(entry));
+            int delta = static_cast<int>(protocol::getU32(entry + 4));
+            if (applyRefDelta(blockID, delta)) applied++;
+        }
+        resp.payload.resize(4);
+        protocol::putU32(&resp.payload[0], applied);
+        if (applied != count) resp.header.status = protocol::STATUS_ERROR;
+        break;
+    }
+    case protocol::OP_GET_LEASE: {
+        if (req.payload.size() < 4) {
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            break;
+        }
+        uint32_t leaseMs = 0;
+        string value;
+        resp.header.status = readStatus(mm.getValueLeased(id, protocol::getU32(req.payload.data()), value,
+            leaseMs));
+        if (resp.header.status != protocol::STATUS_OK) break;
+        resp.payload.resize(4);
+        protocol::putU32(&resp.payload[0], leaseMs);
+        resp.payload += value;
+        break;
+    }
+    case protocol::OP_STATUS:
+        resp.payload = mm.getStatus();
+        break;
+    case protocol::OP_MAP:
+        resp.payload = mm.getMemoryMap(protocol::kMaxFrameSize);
+        break;
+    case protocol::OP_TEXT:
+        resp.payload = processCommand(req.payload);
+        break;
+    case protocol::OP_BATCH:
+        processBatch(req, resp);
+        break;
+    default:
+        resp.header.status = protocol::STATUS_BAD_REQUEST;
+        break;
+    }
+}
+
+// Con --wal, la respuesta a un cambio que no quedó en el log pasa a ser un error (el cambio
+// está aplicado en memoria, pero no sobreviviría a una caída)
+void syncLogReply(protocol::Message& resp) {
+    if (MemoryManager::getInstance().syncLog()) return;
+    resp.header.status = protocol::STATUS_ERROR;
+    if (resp.header.opcode == protocol::OP_TEXT) {
+        resp.payload = "Error: el cambio no se pudo guardar en el log (" + resp.payload + ")";
+    }
+    else {
+        resp.payload.clear();
+    }
+}
+
+// La respuesta a una escritura sobre bloques con leases espera a que los suscriptores confirmen
+// el aviso (o a que venzan sus leases); en un reactor se retiene sin bloquear el hilo, y en un
+// canal de memoria compartida (que tiene su propio hilo) se espera ahí mismo
+void waitLeaseHolders() {
+    Reactor* reactor = Reactor::current();
+    if (reactor == nullptr) {
+        auto wait = MemoryManager::getInstance().notifyLeaseHolders(nullptr);
+        if (wait) wait->wait();
+        return;
+    }
+    auto wait = MemoryManager::getInstance().notifyLeaseHolders([reactor]() { reactor->wake(); });
+    if (wait) reactor->holdReply([wait]() { return wait->done(); });
+}
+
+void runServer(int port, size_t memSizeBytes, const string& dumpFolder, size_t threads,
+    DumpMode dumpMode = DumpMode::Delta, size_t dumpEvery = 0, double compactThreshold = 0.5,
+    size_t leaseMs = LeaseTable::kDefaultDuration.count(), const string& backingPath = "",
+    const string& restorePath = "", const string& walPath = "", WalSync walSync = WalSync::Group,
+    size_t walGroupMs = WriteAheadLog::kDefaultInterval.count(),
+    size_t shmChannels = SharedMemoryServer::kDefaultChannels) {
+    // Inicializa la librería de sockets (Winsock en Windows)
+    if (!net::startup()) {
+        cerr << "[SERVIDOR] No se pudo inicializar los sockets: " << net::lastError() << endl;
+        return;
+    }
+    net::raiseDescriptorLimit();
 
     // Crea el socket del servidor
     SOCKET server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd == INVALID_SOCKET) {
         cerr << "[SERVIDOR] Error al crear el socket del servidor." << endl;
-        WSACleanup();
+        net::cleanup();
         return;
     }
 
@@ -55,132 +629,139 @@ void runServer(int port, size_t memSizeBytes, const string& dumpFolder) {
     address.sin_port = htons(port);
 
     if (bind(server_fd, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
-        cerr << "[SERVIDOR] Error en bind. Código: " << WSAGetLastError() << endl;
+        cerr << "[SERVIDOR] Error en bind. Código: " << net::lastError() << endl;
         closesocket(server_fd);
-        WSACleanup();
+        net::cleanup();
         return;
     }
 
-    // Escucha conexiones entrantes
-    if (listen(server_fd, 5) == SOCKET_ERROR) {
-        cerr << "[SERVIDOR] Error en listen. Código: " << WSAGetLastError() << endl;
+    // Escucha conexiones entrantes (cola amplia para ráfagas de conexiones)
+    if (listen(server_fd, SOMAXCONN) == SOCKET_ERROR) {
+        cerr << "[SERVIDOR] Error en listen. Código: " << net::lastError() << endl;
         closesocket(server_fd);
-        WSACleanup();
+        net::cleanup();
         return;
     }
 
-    // Inicializa el MemoryManager
-    MemoryManager::getInstance().init(memSizeBytes);
-    MemoryManager::getInstance().setDumpFolder(dumpFolder);
+    // Inicializa el MemoryManager con un shard por hilo (sobre el archivo de respaldo, si hay),
+    // o con el contenido, el tamaño y los shards de un snapshot
+    if (!restorePath.empty()) {
+        if (!MemoryManager::getInstance().restore(restorePath, backingPath)) {
+            cerr << "[SERVIDOR] No se pudo restaurar el snapshot " << restorePath << endl;
+            closesocket(server_fd);
+            net::cleanup();
+            return;
+        }
+    }
+    else {
+        MemoryManager::getInstance().init(memSizeBytes, threads, backingPath);
+    }
+    // Los cambios registrados desde el snapshot (o desde el inicio) se aplican antes de atender
+    if (!walPath.empty()
+        && !MemoryManager::getInstance().openLog(walPath, walSync, chrono::milliseconds(walGroupMs))) {
+        cerr << "[SERVIDOR] No se pudo abrir el log " << walPath << endl;
+        closesocket(server_fd);
+        net::cleanup();
+        return;
+    }
+    MemoryManager::getInstance().setDumpFolder(dumpFolder, dumpMode, dumpEvery);
+    MemoryManager::getInstance().setCompactionThreshold(compactThreshold);
+    MemoryManager::getInstance().setLeaseDuration(chrono::milliseconds(leaseMs));
 
     cout << "[SERVIDOR] Iniciado correctamente." << endl;
     cout << "[SERVIDOR] Escuchando en el puerto " << port << endl;
     cout << "[SERVIDOR] Carpeta de dumps: " << dumpFolder << endl;
+    cout << "[SERVIDOR] Hilos de trabajo: " << threads << endl;
+    if (!backingPath.empty()) {
+        cout << "[SERVIDOR] Archivo de respaldo: " << backingPath << endl;
+    }
 
-    // Bucle principal para aceptar y procesar conexiones
-    while (true) {
-        try {
-            sockaddr_in clientAddr;
-            int clientLen = sizeof(clientAddr);
-            SOCKET client_socket = accept(server_fd, (sockaddr*)&clientAddr, &clientLen);
-            if (client_socket == INVALID_SOCKET) {
-                cerr << "[SERVIDOR] Error en accept. Código: " << WSAGetLastError() << endl;
-                continue;
-            }
-
-            // Recibir datos
-            char buffer[1024] = { 0 };
-            int bytesReceived = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
-            if (bytesReceived <= 0) {
-                cerr << "[SERVIDOR] Error al recibir datos o conexión cerrada." << endl;
-                closesocket(client_socket);
-                continue;
-            }
-            buffer[bytesReceived] = '\0';
-            cout << "[SERVIDOR] Comando recibido: " << buffer << endl;
-
-            // Procesar comando
-            istringstream iss(buffer);
-            string cmd;
-            iss >> cmd;
-
-            string reply;
-            if (cmd == "create") {
-                size_t size;
-                string type;
-                iss >> size >> type;
-                int blockID = MemoryManager::getInstance().createBlock(size, type);
-                if (blockID < 0) {
-                    reply = "Error al crear bloque (espacio insuficiente o inválido).";
-                }
-                else {
-                    reply = "Bloque creado con ID=" + to_string(blockID);
-                }
-            }
-            else if (cmd == "set") {
-                int id;
-                iss >> id;
-                string value;
-                getline(iss, value); // Lee el resto de la línea
-                // Elimina espacios en blanco iniciales
-                size_t start = value.find_first_not_of(" ");
-                if (start != string::npos) {
-                    value = value.substr(start);
-                }
-                else {
-                    value = "";
-                }
-                MemoryManager::getInstance().setValue(id, value);
-                reply = "Valor asignado al bloque " + to_string(id);
-            }
-            else if (cmd == "get") {
-                int id;
-                iss >> id;
-                string val = MemoryManager::getInstance().getValue(id);
-                reply = "Bloque " + to_string(id) + " -> " + val;
-            }
-            else if (cmd == "increase") {
-                int id;
-                iss >> id;
-                MemoryManager::getInstance().increaseRefCount(id);
-                reply = "RefCount incrementado en bloque " + to_string(id);
-            }
-            else if (cmd == "decrease") {
-                int id;
-                iss >> id;
-                MemoryManager::getInstance().decreaseRefCount(id);
-                reply = "RefCount decrementado en bloque " + to_string(id);
-            }
-            else if (cmd == "status") {
-                reply = MemoryManager::getInstance().getStatus();
-            }
-            else if (cmd == "map") {
-                reply = MemoryManager::getInstance().getMemoryMap();
-            }
-            else {
-                reply = "Comando inválido";
-            }
-
-            int sendResult = send(client_socket, reply.c_str(), (int)reply.size(), 0);
-            if (sendResult == SOCKET_ERROR) {
-                cerr << "[SERVIDOR] Error al enviar respuesta. Código: " << WSAGetLastError() << endl;
-            }
-            else {
-                cout << "[SERVIDOR] Respuesta enviada: " << reply << endl;
-            }
+    // Bucle de eventos: atiende todas las conexiones sin bloquearse en ninguna
+    Reactor::Handlers handlers;
+    handlers.text = [](const string& command) {
+        cout << "[SERVIDOR] Comando recibido: " << command << endl;
+        string reply = processCommand(command);
+        // Con --walSync always la respuesta sale cuando el cambio ya está en disco
+        if (!MemoryManager::getInstance().syncLog()) {
+            reply = "Error: el cambio no se pudo guardar en el log (" + reply + ")";
+        }
+        waitLeaseHolders();
+        cout << "[SERVIDOR] Respuesta enviada: " << reply << endl;
+        return reply;
+    };
+    // Clientes en la misma máquina: canales de memoria compartida, cada uno con su hilo, que
+    // procesan los mensajes igual que los reactores (sin suscripciones, que usan el socket)
+    SharedMemoryServer sharedMemory([](const protocol::Message& req, protocol::Message& resp) {
+        if (req.header.opcode == protocol::OP_SUBSCRIBE || req.header.opcode == protocol::OP_SHM_ATTACH) {
+            resp.header = req.header;
+            resp.header.status = protocol::STATUS_BAD_REQUEST;
+            resp.payload.clear();
+            return;
+        }
+        processBinary(req, resp);
+        syncLogReply(resp);
+        waitLeaseHolders();
+    }, shmChannels);
 
-            closesocket(client_socket);
+    handlers.binary = [&sharedMemory](SOCKET sock, const protocol::Message& req, protocol::Message& resp) {
+        if (req.header.opcode == protocol::OP_INVALIDATE) {
+            // Confirmación de un aviso por la conexión de suscripción; no lleva respuesta
+            MemoryManager::getInstance().confirmInvalidation(sock, req.header.requestId);
+            return false;
+        }
+        if (req.header.opcode != protocol::OP_SUBSCRIBE && req.header.opcode != protocol::OP_SHM_ATTACH) {
+            processBinary(req, resp);
+            syncLogReply(resp);
+            waitLeaseHolders();
+            return true;
         }
-        catch (const exception& ex) {
-            cerr << "[SERVIDOR] Excepción capturada: " << ex.what() << endl;
+        resp.header = req.header;
+        resp.header.status = protocol::STATUS_OK;
+        resp.payload.clear();
+        if (req.header.opcode == protocol::OP_SHM_ATTACH) {
+            // Desde ahora las peticiones de este cliente llegan por el segmento; la conexión
+            // queda abierta solo para saber cuándo se va
+            if (!sharedMemory.attach(sock, resp.payload)) resp.header.status = protocol::STATUS_ERROR;
+            return true;
         }
-        catch (...) {
-            cerr << "[SERVIDOR] Excepción desconocida capturada." << endl;
+        // La conexión pasa a recibir los avisos de invalidación de los leases del cliente, que
+        // otros hilos le encolan a este reactor
+        Reactor* reactor = Reactor::current();
+        uint32_t subscriber = MemoryManager::getInstance().subscribe(sock, [reactor, sock](string frame) {
+            reactor->post(sock, move(frame));
+        });
+        resp.payload.resize(4);
+        protocol::putU32(&resp.payload[0], subscriber);
+        return true;
+    };
+    handlers.closed = [&sharedMemory](SOCKET sock) {
+        MemoryManager::getInstance().unsubscribe(sock);
+        sharedMemory.detach(sock);
+    };
+    // Entre eventos, cada reactor avanza la compactación pendiente en pasos cortos
+    handlers.idle = []() {
+        return MemoryManager::getInstance().compactStep(chrono::microseconds(200));
+    };
+
+    // Cada hilo corre su propio reactor sobre el mismo socket de escucha; la conexión queda
+    // en el hilo que la aceptó, así que los reactores no comparten estado entre sí
+    auto work = [server_fd, &handlers]() {
+        Reactor reactor(server_fd, handlers);
+        if (reactor.init()) {
+            reactor.run();
         }
+    };
+    vector<thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
     }
 
     closesocket(server_fd);
-    WSACleanup();
+    net::cleanup();
 }
 
 
@@ -190,14 +771,39 @@ int main(int argc, char** argv) {
     int port = 0;
     size_t memSizeBytes = 0;
     string dumpFolder;
+    // Por defecto, un hilo por núcleo
+    size_t threads = max(1u, thread::hardware_concurrency());
+    // Por defecto, una línea por operación sin instantáneas completas
+    DumpMode dumpMode = DumpMode::Delta;
+    size_t dumpEvery = 0;
+    // Se compacta cuando la mitad del espacio libre queda fuera del mayor rango libre
+    double compactThreshold = 0.5;
+    // Los cachés de los clientes pueden usar un valor leído hasta 2 s sin volver a preguntar
+    size_t leaseMs = LeaseTable::kDefaultDuration.count();
+    // Sin archivo de respaldo la memoria se pierde al cerrar el servidor
+    string backingPath;
+    // Snapshot a cargar al arrancar (ver comando snapshot)
+    string restorePath;
+    // Log de cambios entre snapshots; por defecto se sincroniza cada 10 ms
+    string walPath;
+    WalSync walSync = WalSync::Group;
+    size_t walGroupMs = WriteAheadLog::kDefaultInterval.count();
+    // Canales de memoria compartida para clientes locales (cada uno ocupa un hilo)
+    size_t shmChannels = SharedMemoryServer::kDefaultChannels;
 
-    if (!parseArguments(argc, argv, port, memSizeBytes, dumpFolder)) {
+    if (!parseArguments(argc, argv, port, memSizeBytes, dumpFolder, threads, dumpMode, dumpEvery,
+        compactThreshold, leaseMs, backingPath, restorePath, walPath, walSync, walGroupMs, shmChannels)) {
         cerr << "Uso: " << argv[0]
-             << " --port <puerto> --memsize <MB> --dumpFolder <carpeta>" << endl;
+             << " --port <puerto> --memsize <MB> --dumpFolder <carpeta> [--threads <N>]"
+             << " [--dumpMode off|delta|full] [--dumpEvery <N>] [--compactThreshold <0..1>]"
+             << " [--leaseMs <ms>] [--backing <archivo>]"
+             << " [--restore <snapshot>] [--wal <archivo>] [--walSync always|group|none]"
+             << " [--walGroupMs <ms>] [--shmChannels <N>]" << endl;
         return 1;
     }
 
-    runServer(port, memSizeBytes, dumpFolder);
+    runServer(port, memSizeBytes, dumpFolder, threads, dumpMode, dumpEvery, compactThreshold, leaseMs, backingPath,
+        restorePath, walPath, walSync, walGroupMs, shmChannels);
     return 0;
 }
 
@@ -208,6 +814,6 @@ int main(int argc, char** argv) {
 //    size_t memSizeBytes = 100 * 1024 * 1024;
 //    string dumpFolder = "dumps";
 //
-//    runServer(port, memSizeBytes, dumpFolder);
+//    runServer(port, memSizeBytes, dumpFolder, thread::hardware_concurrency());
 //    return 0;
 //}
@@ -0,0 +1,264 @@
+#include "Metrics.h"
+#include "Protocol.h"
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// Usamos namespace std
+using namespace std;
+
+// ----------------------------------------------------------------------------------
+// Histogram
+// ----------------------------------------------------------------------------------
+Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+    for (auto& bucket : buckets_) bucket.store(0, memory_order_relaxed);
+}
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<size_t>(value);
+    int exponent = static_cast<int>(bit_width(value)) - 1;
+    if (exponent >= kMaxExponent) return kBuckets - 1;
+    size_t sub = static_cast<size_t>(value >> (exponent - kSubBits)) - kSubBuckets;
+    return kSubBuckets + static_cast<size_t>(exponent - kSubBits) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketLimit(size_t index) {
+    if (index < kSubBuckets) return index;
+    int shift = static_cast<int>((index - kSubBuckets) / kSubBuckets);
+    uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+    buckets_[bucketOf(value)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(value, memory_order_relaxed);
+    uint64_t seen = max_.load(memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+    }
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < kBuckets; i++) {
+        uint64_t n = other.buckets_[i].load(memory_order_relaxed);
+        if (n > 0) buckets_[i].fetch_add(n, memory_order_relaxed);
+    }
+    count_.fetch_add(other.count_.load(memory_order_relaxed), memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(memory_order_relaxed), memory_order_relaxed);
+    uint64_t otherMax = other.max_.load(memory_order_relaxed);
+    if (otherMax > max_.load(memory_order_relaxed)) max_.store(otherMax, memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum_.load(memory_order_relaxed)) / static_cast<double>(n);
+}
+
+uint64_t Histogram::percentile(double q) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(ceil(q * static_cast<double>(n)));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(memory_order_relaxed);
+        // El máximo exacto acota la última cubeta
+        if (seen >= target) return std::min(bucketLimit(i), maxValue());
+    }
+    return maxValue();
+}
+
+// ----------------------------------------------------------------------------------
+// Bloques por hilo
+// ----------------------------------------------------------------------------------
+Metrics::ThreadBlock::ThreadBlock() : inUse(true) {
+    for (auto& slot : ops) slot.store(nullptr, memory_order_relaxed);
+    for (auto& slot : series) slot.store(nullptr, memory_order_relaxed);
+    for (auto& counter : counters) counter.store(0, memory_order_relaxed);
+}
+
+Metrics::ThreadBlock::~ThreadBlock() {
+    for (auto& slot : ops) delete slot.load(memory_order_relaxed);
+    for (auto& slot : series) delete slot.load(memory_order_relaxed);
+}
+
+// Solo el hilo dueño crea los histogramas; los lectores ven el puntero ya publicado
+Histogram& Metrics::ThreadBlock::histogram(atomic<Histogram*>& slot) {
+    Histogram* histogram = slot.load(memory_order_relaxed);
+    if (histogram == nullptr) {
+        histogram = new Histogram();
+        slot.store(histogram, memory_order_release);
+    }
+    return *histogram;
+}
+
+thread_local Metrics::LocalBlock Metrics::local_;
+
+// Al terminar el hilo, su bloque queda para el próximo
+Metrics::LocalBlock::~LocalBlock() {
+    if (block) block->inUse.store(false, memory_order_release);
+}
+
+Metrics::Metrics() : started_(chrono::steady_clock::now()) {
+}
+
+Metrics::ThreadBlock& Metrics::local() {
+    if (local_.block) return *local_.block;
+    lock_guard<mutex> lock(mtx_);
+    ThreadBlock* block = nullptr;
+    for (auto& candidate : blocks_) {
+        if (!candidate->inUse.load(memory_order_acquire)) {
+            block = candidate.get();
+            block->inUse.store(true, memory_order_relaxed);
+            break;
+        }
+    }
+    if (block == nullptr) {
+        blocks_.push_back(make_unique<ThreadBlock>());
+        block = blocks_.back().get();
+    }
+    local_.block = block;
+    return *block;
+}
+
+void Metrics::recordOp(uint8_t opcode, uint64_t ns) {
+    if (opcode >= kMaxOps) return;
+    ThreadBlock& block = local();
+    block.histogram(block.ops[opcode]).record(ns);
+}
+
+void Metrics::record(Series series, uint64_t value) {
+    ThreadBlock& block = local();
+    block.histogram(block.series[series]).record(value);
+}
+
+void Metrics::add(Counter counter, uint64_t amount) {
+    local().counters[counter].fetch_add(amount, memory_order_relaxed);
+}
+
+void Metrics::collect(Totals& totals) const {
+    lock_guard<mutex> lock(mtx_);
+    for (auto& block : blocks_) {
+        for (size_t op = 0; op < kMaxOps; op++) {
+            Histogram* histogram = block->ops[op].load(memory_order_acquire);
+            if (histogram == nullptr) continue;
+            if (!totals.ops[op]) totals.ops[op] = make_unique<Histogram>();
+            totals.ops[op]->merge(*histogram);
+        }
+        for (size_t s = 0; s < kSeriesCount; s++) {
+            Histogram* histogram = block->series[s].load(memory_order_acquire);
+            if (histogram == nullptr) continue;
+            if (!totals.series[s]) totals.series[s] = make_unique<Histogram>();
+            totals.series[s]->merge(*histogram);
+        }
+        for (size_t c = 0; c < kCounterCount; c++) {
+            totals.counters[c] += block->counters[c].load(memory_order_relaxed);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Reportes
+// ----------------------------------------------------------------------------------
+static string opName(size_t opcode) {
+    const char* name = protocol::opcodeName(static_cast<uint8_t>(opcode));
+    return name ? name : "op" + to_string(opcode);
+}
+
+// 850 ns, 12.3 us, 4.56 ms, 1.20 s
+static string formatNs(uint64_t ns) {
+    ostringstream oss;
+    oss << fixed;
+    if (ns < 1000) oss << ns << " ns";
+    else if (ns < 1000000) oss << setprecision(1) << ns / 1e3 << " us";
+    else if (ns < 1000000000) oss << setprecision(2) << ns / 1e6 << " ms";
+    else oss << setprecision(2) << ns / 1e9 << " s";
+    return oss.str();
+}
+
+static string formatValue(uint64_t value, bool nanoseconds) {
+    return nanoseconds ? formatNs(value) : to_string(value);
+}
+
+static void writeSummary(ostringstream& oss, const Histogram* h, bool nanoseconds) {
+    if (h == nullptr || h->count() == 0) {
+        oss << "sin datos";
+        return;
+    }
+    oss << h->count() << " valores; p50 " << formatValue(h->percentile(0.5), nanoseconds)
+        << ", p99 " << formatValue(h->percentile(0.99), nanoseconds)
+        << ", p999 " << formatValue(h->percentile(0.999), nanoseconds)
+        << ", máx " << formatValue(h->maxValue(), nanoseconds);
+}
+
+string Metrics::report() const {
+    Totals totals;
+    collect(totals);
+    double uptime = chrono::duration<double>(chrono::steady_clock::now() - started_).count();
+
+    ostringstream oss;
+    oss << "Estadísticas desde el arranque (" << fixed << setprecision(1) << uptime << " s)\n";
+    oss << left << setw(14) << "Operación" << right << setw(12) << "cantidad" << setw(12) << "p50"
+        << setw(12) << "p99" << setw(12) << "p999" << setw(13) << "máx" << "\n";
+    for (size_t op = 0; op < kMaxOps; op++) {
+        const Histogram* h = totals.ops[op].get();
+        if (h == nullptr || h->count() == 0) continue;
+        oss << left << setw(13) << opName(op) << right << setw(12) << h->count()
+            << setw(12) << formatNs(h->percentile(0.5)) << setw(12) << formatNs(h->percentile(0.99))
+            << setw(12) << formatNs(h->percentile(0.999)) << setw(12) << formatNs(h->maxValue()) << "\n";
+    }
+
+    const Histogram* lockWait = totals.series[LOCK_WAIT].get();
+    oss << "Espera de locks: " << (lockWait ? lockWait->count() : 0) << " de "
+        << totals.counters[LOCK_ACQUIRES] << " tomas esperaron; ";
+    writeSummary(oss, lockWait, true);
+    oss << "\nPasos de búsqueda del allocator: ";
+    writeSummary(oss, totals.series[ALLOC_SEARCH].get(), false);
+    oss << "\nRangos libres del shard al asignar: ";
+    writeSummary(oss, totals.series[FREE_RANGES].get(), false);
+    oss << "\nPasadas del hilo de dump: ";
+    writeSummary(oss, totals.series[DUMP_PASS].get(), true);
+    oss << "\nEscrituras del log: ";
+    writeSummary(oss, totals.series[WAL_FLUSH].get(), true);
+    oss << "\nBytes recibidos: " << totals.counters[BYTES_IN] << ", enviados: " << totals.counters[BYTES_OUT];
+    return oss.str();
+}
+
+static void writeJsonSummary(ostringstream& oss, const Histogram* h) {
+    if (h == nullptr) {
+        oss << "{\"count\":0}";
+        return;
+    }
+    oss << "{\"count\":" << h->count() << ",\"mean\":" << static_cast<uint64_t>(h->mean())
+        << ",\"p50\":" << h->percentile(0.5) << ",\"p99\":" << h->percentile(0.99)
+        << ",\"p999\":" << h->percentile(0.999) << ",\"max\":" << h->maxValue() << "}";
+}
+
+string Metrics::reportJson() const {
+    Totals totals;
+    collect(totals);
+    auto uptime = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started_).count();
+
+    ostringstream oss;
+    oss << "{\"uptimeMs\":" << uptime << ",\"opsNs\":{";
+    bool first = true;
+    for (size_t op = 0; op < kMaxOps; op++) {
+        if (!totals.ops[op]) continue;
+        oss << (first ? "" : ",") << "\"" << opName(op) << "\":";
+        writeJsonSummary(oss, totals.ops[op].get());
+        first = false;
+    }
+    oss << "},\"lockWaitNs\":";
+    writeJsonSummary(oss, totals.series[LOCK_WAIT].get());
+    oss << ",\"lockAcquires\":" << totals.counters[LOCK_ACQUIRES] << ",\"allocSearchSteps\":";
+    writeJsonSummary(oss, totals.series[ALLOC_SEARCH].get());
+    oss << ",\"freeRanges\":";
+    writeJsonSummary(oss, totals.series[FREE_RANGES].get());
+    oss << ",\"dumpPassNs\":";
+    writeJsonSummary(oss, totals.series[DUMP_PASS].get());
+    oss << ",\"walFlushNs\":";
+    writeJsonSummary(oss, totals.series[WAL_FLUSH].get());
+    oss << ",\"bytesIn\":" << totals.counters[BYTES_IN] << ",\"bytesOut\":" << totals.counters[BYTES_OUT] << "}";
+    return oss.str();
+}
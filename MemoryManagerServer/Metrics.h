@@ -0,0 +1,160 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Histogram: cuenta valores (nanosegundos, pasos, cantidades) en cubetas log-lineales al estilo
+  HDR: los valores menores a 16 tienen su propia cubeta y cada potencia de 2 se parte en 16, así
+  que un percentil sale con un error relativo menor a 1/16 y el histograma ocupa siempre lo
+  mismo (kBuckets contadores). Los valores desde 2^kMaxExponent caen en la última cubeta.
+
+  record() no toma locks; está pensado para que cada histograma tenga un solo hilo que escribe
+  (ver Metrics) y cualquiera que lea. Los percentiles informan el mayor valor de su cubeta.
+*/
+class Histogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr size_t kBuckets = (kMaxExponent - kSubBits + 1) * kSubBuckets;
+
+    Histogram();
+
+    void record(uint64_t value);
+
+    // Suma los conteos de 'other' (que puede estar recibiendo valores mientras tanto)
+    void merge(const Histogram& other);
+
+    uint64_t count() const { return count_.load(memory_order_relaxed); }
+    uint64_t maxValue() const { return max_.load(memory_order_relaxed); }
+    double mean() const;
+
+    // Menor valor v tal que una fracción 'q' (0..1) de los valores es <= v
+    uint64_t percentile(double q) const;
+
+    static size_t bucketOf(uint64_t value);
+    // Mayor valor que cae en la cubeta 'index'
+    static uint64_t bucketLimit(size_t index);
+
+private:
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    atomic<uint64_t> buckets_[kBuckets];
+    atomic<uint64_t> count_;
+    atomic<uint64_t> sum_;
+    atomic<uint64_t> max_;
+};
+
+/*
+  Metrics: contadores e histogramas del servidor, para el comando "stats".
+
+  Cada hilo que registra algo (reactores, canales de memoria compartida, hilo de dump, hilo del
+  log) escribe en su propio bloque: no hay locks ni líneas de caché compartidas en el camino
+  de una operación. El bloque se pide una sola vez por hilo; al terminar el hilo queda libre y
+  lo reutiliza el próximo, con lo acumulado. Los histogramas de cada bloque se crean la primera
+  vez que se usan. report() y reportJson() suman todos los bloques en el momento.
+
+  Se mide:
+    - latencia de cada operación, por opcode (los comandos de texto cuentan como su opcode);
+    - espera por el mutex de un shard cuando estaba ocupado, y tomas totales;
+    - pasos de búsqueda del allocator y rangos libres del shard en cada asignación;
+    - duración de cada pasada del hilo de dump y de cada escritura del write-ahead log;
+    - bytes recibidos y enviados por los reactores y los canales de memoria compartida.
+*/
+class Metrics {
+public:
+    // Opcodes con histograma propio (Protocol.h usa menos)
+    static constexpr size_t kMaxOps = 32;
+
+    enum Series { LOCK_WAIT, ALLOC_SEARCH, FREE_RANGES, DUMP_PASS, WAL_FLUSH, kSeriesCount };
+    enum Counter { LOCK_ACQUIRES, BYTES_IN, BYTES_OUT, kCounterCount };
+
+    static Metrics& getInstance() {
+        static Metrics instance;
+        return instance;
+    }
+
+    // Reloj monotónico en nanosegundos
+    static uint64_t nowNs() {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void recordOp(uint8_t opcode, uint64_t ns);
+    void record(Series series, uint64_t value);
+    void add(Counter counter, uint64_t amount);
+
+    // Mide una operación desde la construcción hasta la destrucción (opcode 0: no se mide)
+    class OpTimer {
+    public:
+        explicit OpTimer(uint8_t opcode) : opcode_(opcode), start_(opcode != 0 ? nowNs() : 0) {}
+        ~OpTimer() {
+            if (opcode_ != 0) Metrics::getInstance().recordOp(opcode_, nowNs() - start_);
+        }
+
+    private:
+        OpTimer(const OpTimer&) = delete;
+        OpTimer& operator=(const OpTimer&) = delete;
+
+        uint8_t opcode_;
+        uint64_t start_;
+    };
+
+    // Tabla legible: cantidad y p50/p99/p999/máximo por operación y por serie
+    string report() const;
+
+    // Lo mismo en JSON, para herramientas
+    string reportJson() const;
+
+private:
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    struct ThreadBlock {
+        atomic<Histogram*> ops[kMaxOps];
+        atomic<Histogram*> series[kSeriesCount];
+        atomic<uint64_t> counters[kCounterCount];
+        // El hilo dueño sigue vivo
+        atomic<bool> inUse;
+
+        ThreadBlock();
+        ~ThreadBlock();
+        Histogram& histogram(atomic<Histogram*>& slot);
+    };
+
+    // Bloque del hilo que llama (lo toma la primera vez)
+    ThreadBlock& local();
+
+    struct LocalBlock {
+        ThreadBlock* block = nullptr;
+        ~LocalBlock();
+    };
+    static thread_local LocalBlock local_;
+
+    // Suma de todos los bloques
+    struct Totals {
+        unique_ptr<Histogram> ops[kMaxOps];
+        unique_ptr<Histogram> series[kSeriesCount];
+        uint64_t counters[kCounterCount] = {};
+    };
+    void collect(Totals& totals) const;
+
+    mutable mutex mtx_;
+    vector<unique_ptr<ThreadBlock>> blocks_;
+    chrono::steady_clock::time_point started_;
+};
+
+#endif // METRICS_H
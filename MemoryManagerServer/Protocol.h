@@ -0,0 +1,282 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "Socket.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Protocolo de transporte compartido entre el MemoryManagerServer y los MPointers.
+
+  Cada conexión TCP es persistente y transporta una secuencia de "frames":
+      [longitud: uint32 little-endian][payload: 'longitud' bytes]
+
+  El payload es el comando de texto de siempre ("create 4 int", "get 7", ...) y la
+  respuesta del servidor viaja con el mismo formato, de modo que una sola conexión
+  puede atender cualquier cantidad de comandos sin volver a hacer el handshake TCP.
+
+  Protocolo binario (versión kBinaryVersion):
+  Al conectarse, el cliente envía el frame de texto kBinaryHello. Si el servidor lo
+  reconoce, responde con el mismo texto y desde ese momento la conexión transporta
+  mensajes binarios:
+      [Header: 16 bytes little-endian][payload: header.payloadLength bytes]
+  Un servidor antiguo responde "Comando inválido" y el cliente sigue usando texto.
+
+  Los valores viajan en little-endian con ancho fijo:
+      int -> 4, long -> 8, float -> 4, double -> 8, bool -> 1, char -> 1,
+      string y tipos crudos -> bytes tal cual.
+*/
+namespace protocol {
+
+    // Tamaño del prefijo de longitud de cada frame
+    constexpr size_t kLengthPrefixSize = 4;
+
+    // Límite de un frame; protege al servidor de longitudes basura
+    constexpr uint32_t kMaxFrameSize = 16 * 1024 * 1024;
+
+    // Negociación del protocolo binario
+    constexpr uint8_t kBinaryVersion = 1;
+    constexpr const char* kBinaryHello = "proto bin 1";
+
+    // Operaciones del protocolo binario
+    enum Opcode : uint8_t {
+        OP_CREATE = 1,      // payload: uint32 size + nombre del tipo; respuesta: blockId
+        OP_SET = 2,         // payload: valor codificado
+        OP_GET = 3,         // respuesta: valor codificado
+        OP_INCREASE = 4,
+        OP_DECREASE = 5,
+        OP_STATUS = 6,      // respuesta: texto de getStatus()
+        OP_MAP = 7,         // respuesta: texto de getMemoryMap()
+        OP_BATCH = 8,       // payload: uint32 N + N mensajes; respuesta: N respuestas en el mismo orden
+        OP_REFDELTA = 9,    // payload: uint32 N + N pares (int32 blockId, int32 delta); respuesta: uint32 aplicados
+        OP_SUBSCRIBE = 10,  // convierte la conexión en canal de avisos; respuesta: uint32 suscriptor
+        OP_GET_LEASE = 11,  // payload: uint32 suscriptor; respuesta: uint32 ms del lease + valor codificado
+        OP_INVALIDATE = 12, // servidor -> suscriptor: el valor de blockId cambió; se confirma devolviéndolo igual
+        OP_READ_RANGE = 13, // payload: uint32 primer elemento + uint32 cantidad; respuesta: bytes de los elementos
+        OP_WRITE_RANGE = 14,// payload: uint32 primer elemento + bytes de los elementos
+        OP_CREATE_ARRAY = 16, // payload: uint32 cantidad de elementos + nombre del tipo; respuesta: blockId
+        OP_ATOMIC_ADD = 17, // payload: delta codificado; respuesta: valor anterior codificado
+        OP_ATOMIC_CAS = 18, // payload: uint32 largo + esperado + nuevo; respuesta: uint8 intercambiado + valor anterior
+        OP_ATOMIC_XCHG = 19,// payload: valor nuevo codificado; respuesta: valor anterior codificado
+        OP_TX_BEGIN = 20,   // respuesta: uint32 transacción
+        OP_TX_GET = 21,     // payload: uint32 transacción; respuesta: valor codificado
+        OP_TX_SET = 22,     // payload: uint32 transacción + valor codificado (pendiente hasta confirmar)
+        OP_TX_COMMIT = 23,  // payload: uint32 transacción; STATUS_CONFLICT (blockId = bloque que cambió) si se descartó
+        OP_TX_ABORT = 24,   // payload: uint32 transacción
+        OP_SHM_ATTACH = 25, // respuesta: nombre del segmento de memoria compartida (ver SharedRing.h)
+        OP_TEXT = 15        // payload: comando de texto; respuesta: texto (túnel para comandos sin opcode)
+    };
+
+    // Nombre de cada opcode (el del comando de texto equivalente, si lo hay); nullptr si no existe
+    inline const char* opcodeName(uint8_t opcode) {
+        static const char* const names[] = {
+            nullptr, "create", "set", "get", "increase", "decrease", "status", "map", "batch",
+            "refdelta", "subscribe", "getlease", "invalidate", "readrange", "writerange", "text",
+            "createarray", "add", "cas", "xchg", "begin", "tget", "tset", "commit", "abort", "shmattach"
+        };
+        return opcode < sizeof(names) / sizeof(names[0]) ? names[opcode] : nullptr;
+    }
+
+    // Resultado de una operación (campo status de la respuesta)
+    enum Status : uint16_t {
+        STATUS_OK = 0,
+        STATUS_ERROR = 1,
+        STATUS_BAD_REQUEST = 2,
+        STATUS_CONFLICT = 3
+    };
+
+    // Encabezado fijo de cada mensaje binario
+    struct Header {
+        uint8_t version = kBinaryVersion;
+        uint8_t opcode = 0;
+        uint16_t status = STATUS_OK;
+        uint32_t requestId = 0;
+        int32_t blockId = -1;
+        uint32_t payloadLength = 0;
+    };
+    constexpr size_t kHeaderSize = 16;
+
+    struct Message {
+        Header header;
+        string payload;
+    };
+
+    // Límite de operaciones por lote (el cliente parte lotes más grandes en varios frames)
+    constexpr uint32_t kMaxBatchOps = 65536;
+
+    // ------------------ Codificación little-endian ------------------
+    inline void putU16(char* out, uint16_t v) {
+        out[0] = static_cast<char>(v & 0xFF);
+        out[1] = static_cast<char>((v >> 8) & 0xFF);
+    }
+
+    inline void putU32(char* out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    inline void putU64(char* out, uint64_t v) {
+        for (int i = 0; i < 8; i++) out[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    inline uint16_t getU16(const char* in) {
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(in);
+        return static_cast<uint16_t>(b[0] | (b[1] << 8));
+    }
+
+    inline uint32_t getU32(const char* in) {
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(in);
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; i--) v = (v << 8) | b[i];
+        return v;
+    }
+
+    inline uint64_t getU64(const char* in) {
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(in);
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; i--) v = (v << 8) | b[i];
+        return v;
+    }
+
+    inline void encodeHeader(const Header& h, char* out) {
+        out[0] = static_cast<char>(h.version);
+        out[1] = static_cast<char>(h.opcode);
+        putU16(out + 2, h.status);
+        putU32(out + 4, h.requestId);
+        putU32(out + 8, static_cast<uint32_t>(h.blockId));
+        putU32(out + 12, h.payloadLength);
+    }
+
+    inline void decodeHeader(const char* in, Header& h) {
+        h.version = static_cast<uint8_t>(in[0]);
+        h.opcode = static_cast<uint8_t>(in[1]);
+        h.status = getU16(in + 2);
+        h.requestId = getU32(in + 4);
+        h.blockId = static_cast<int32_t>(getU32(in + 8));
+        h.payloadLength = getU32(in + 12);
+    }
+
+    inline void encodeLength(uint32_t length, char* out) {
+        out[0] = static_cast<char>(length & 0xFF);
+        out[1] = static_cast<char>((length >> 8) & 0xFF);
+        out[2] = static_cast<char>((length >> 16) & 0xFF);
+        out[3] = static_cast<char>((length >> 24) & 0xFF);
+    }
+
+    inline uint32_t decodeLength(const char* in) {
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(in);
+        return static_cast<uint32_t>(b[0])
+            | (static_cast<uint32_t>(b[1]) << 8)
+            | (static_cast<uint32_t>(b[2]) << 16)
+            | (static_cast<uint32_t>(b[3]) << 24);
+    }
+
+    // Agrega un mensaje (encabezado + payload) al final de 'out'; se usa para armar lotes
+    inline void appendMessage(string& out, Message& msg) {
+        msg.header.payloadLength = static_cast<uint32_t>(msg.payload.size());
+        size_t pos = out.size();
+        out.resize(pos + kHeaderSize);
+        encodeHeader(msg.header, &out[pos]);
+        out += msg.payload;
+    }
+
+    // Lee el siguiente mensaje de un lote a partir de 'pos'; false si el lote está truncado
+    inline bool readMessage(const string& in, size_t& pos, Message& msg) {
+        if (in.size() - pos < kHeaderSize) return false;
+        decodeHeader(in.data() + pos, msg.header);
+        pos += kHeaderSize;
+        if (in.size() - pos < msg.header.payloadLength) return false;
+        msg.payload.assign(in, pos, msg.header.payloadLength);
+        pos += msg.header.payloadLength;
+        return true;
+    }
+
+    // Tamaño total del siguiente frame (modo texto) o mensaje (modo binario) al inicio de 'data',
+    // si ya llegó completo. Retorna 0 si faltan bytes y -1 si el encabezado es inválido.
+    // Lo usa el servidor para reensamblar mensajes que llegan partidos en varios recv().
+    inline int64_t completeLength(bool binary, const char* data, size_t avail) {
+        if (!binary) {
+            if (avail < kLengthPrefixSize) return 0;
+            uint32_t length = decodeLength(data);
+            if (length > kMaxFrameSize) return -1;
+            return avail >= kLengthPrefixSize + length ? static_cast<int64_t>(kLengthPrefixSize + length) : 0;
+        }
+        if (avail < kHeaderSize) return 0;
+        if (static_cast<uint8_t>(data[0]) != kBinaryVersion) return -1;
+        uint32_t length = getU32(data + 12);
+        if (length > kMaxFrameSize) return -1;
+        return avail >= kHeaderSize + length ? static_cast<int64_t>(kHeaderSize + length) : 0;
+    }
+
+    // Envía exactamente 'len' bytes (send puede escribir menos de lo pedido)
+    inline bool sendAll(SOCKET sock, const char* data, size_t len) {
+        while (len > 0) {
+            int sent = static_cast<int>(send(sock, data, static_cast<int>(len), net::kSendFlags));
+            if (sent == SOCKET_ERROR || sent == 0) return false;
+            data += sent;
+            len -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    // Recibe exactamente 'len' bytes; false si la conexión se cerró o falló
+    inline bool recvAll(SOCKET sock, char* data, size_t len) {
+        while (len > 0) {
+            int received = static_cast<int>(recv(sock, data, static_cast<int>(len), 0));
+            if (received == SOCKET_ERROR || received == 0) return false;
+            data += received;
+            len -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    // Envía un frame completo en una sola llamada (prefijo + payload)
+    inline bool sendFrame(SOCKET sock, const string& payload) {
+        if (payload.size() > kMaxFrameSize) return false;
+        string frame(kLengthPrefixSize + payload.size(), '\0');
+        encodeLength(static_cast<uint32_t>(payload.size()), &frame[0]);
+        payload.copy(&frame[kLengthPrefixSize], payload.size());
+        return sendAll(sock, frame.data(), frame.size());
+    }
+
+    // Recibe un frame completo en 'payload'
+    inline bool recvFrame(SOCKET sock, string& payload) {
+        char prefix[kLengthPrefixSize];
+        if (!recvAll(sock, prefix, kLengthPrefixSize)) return false;
+        uint32_t length = decodeLength(prefix);
+        if (length > kMaxFrameSize) return false;
+        payload.resize(length);
+        return length == 0 || recvAll(sock, &payload[0], length);
+    }
+
+    // Envía un mensaje binario (encabezado + payload) en una sola llamada
+    inline bool sendMessage(SOCKET sock, Message& msg) {
+        if (msg.payload.size() > kMaxFrameSize) return false;
+        msg.header.payloadLength = static_cast<uint32_t>(msg.payload.size());
+        string wire(kHeaderSize + msg.payload.size(), '\0');
+        encodeHeader(msg.header, &wire[0]);
+        msg.payload.copy(&wire[kHeaderSize], msg.payload.size());
+        return sendAll(sock, wire.data(), wire.size());
+    }
+
+    // Recibe un mensaje binario completo
+    inline bool recvMessage(SOCKET sock, Message& msg) {
+        char header[kHeaderSize];
+        if (!recvAll(sock, header, kHeaderSize)) return false;
+        decodeHeader(header, msg.header);
+        if (msg.header.version != kBinaryVersion || msg.header.payloadLength > kMaxFrameSize) return false;
+        msg.payload.resize(msg.header.payloadLength);
+        return msg.header.payloadLength == 0 || recvAll(sock, &msg.payload[0], msg.header.payloadLength);
+    }
+
+    // Desactiva Nagle: los comandos son pequeños y se responden uno a uno
+    inline void setNoDelay(SOCKET sock) {
+        int flag = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&flag), sizeof(flag));
+    }
+}
+
+#endif // PROTOCOL_H
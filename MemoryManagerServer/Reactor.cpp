@@ -0,0 +1,488 @@
+#include "Reactor.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <iostream>
+#include <exception>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+// Usamos namespace std
+using namespace std;
+
+thread_local Reactor* Reactor::current_ = nullptr;
+
+// ----------------------------------------------------------------------------------
+// Constructor y destructor
+// ----------------------------------------------------------------------------------
+Reactor::Reactor(SOCKET listenSocket, Handlers handlers)
+    : listenSocket_(listenSocket), handlers_(move(handlers)), readBuffer_(kReadChunk),
+      wakeSocket_(INVALID_SOCKET), wakePending_(false), held_(0)
+#ifdef __linux__
+    , epollFd_(-1)
+#endif
+{
+}
+
+Reactor::~Reactor() {
+    for (auto& kv : connections_) {
+        closesocket(kv.first);
+    }
+    connections_.clear();
+    if (wakeSocket_ != INVALID_SOCKET) closesocket(wakeSocket_);
+#ifdef __linux__
+    if (epollFd_ >= 0) close(epollFd_);
+#endif
+}
+
+// ----------------------------------------------------------------------------------
+// Prepara el backend de eventos y registra el socket de escucha
+// ----------------------------------------------------------------------------------
+bool Reactor::init() {
+    if (!net::setNonBlocking(listenSocket_)) {
+        cerr << "[SERVIDOR] No se pudo poner el socket de escucha en modo no bloqueante." << endl;
+        return false;
+    }
+    if (!openWakeSocket()) {
+        cerr << "[SERVIDOR] No se pudo crear el socket de aviso del reactor. Código: " << net::lastError() << endl;
+        return false;
+    }
+#ifdef __linux__
+    epollFd_ = epoll_create1(0);
+    if (epollFd_ < 0) {
+        cerr << "[SERVIDOR] Error en epoll_create1. Código: " << net::lastError() << endl;
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+#ifdef EPOLLEXCLUSIVE
+    // Con varios reactores sobre el mismo socket, cada conexión nueva despierta a uno solo
+    ev.events |= EPOLLEXCLUSIVE;
+#endif
+    ev.data.ptr = nullptr; // nullptr identifica al socket de escucha
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenSocket_, &ev) < 0) {
+        cerr << "[SERVIDOR] Error al registrar el socket de escucha en epoll." << endl;
+        return false;
+    }
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = this; // 'this' identifica al socket de aviso
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeSocket_, &ev) < 0) {
+        cerr << "[SERVIDOR] Error al registrar el socket de aviso en epoll." << endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Socket UDP conectado a sí mismo: wake() le escribe un byte y el bucle lo ve como evento
+// ----------------------------------------------------------------------------------
+bool Reactor::openWakeSocket() {
+    wakeSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (wakeSocket_ == INVALID_SOCKET) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    return bind(wakeSocket_, (sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR
+        && getsockname(wakeSocket_, (sockaddr*)&addr, &len) != SOCKET_ERROR
+        && connect(wakeSocket_, (sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR
+        && net::setNonBlocking(wakeSocket_);
+}
+
+// ----------------------------------------------------------------------------------
+// Bucle de eventos
+// ----------------------------------------------------------------------------------
+void Reactor::run() {
+    current_ = this;
+#ifdef __linux__
+    const int kMaxEvents = 256;
+    epoll_event events[kMaxEvents];
+    int timeout = handlers_.idle ? 0 : -1;
+    while (true) {
+        int n = epoll_wait(epollFd_, events, kMaxEvents, timeout);
+        if (n < 0) {
+            if (net::interrupted(net::lastError())) continue;
+            cerr << "[SERVIDOR] Error en epoll_wait. Código: " << net::lastError() << endl;
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == this) {
+                drainWake();
+                continue;
+            }
+            Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+            if (conn == nullptr) {
+                acceptAll();
+            }
+            else {
+                // Edge-triggered: ante cualquier evento se lee y escribe hasta vaciar el socket
+                service(conn);
+            }
+        }
+        deliverPosted();
+        releaseHeld();
+        timeout = runIdle();
+    }
+#else
+    vector<WSAPOLLFD> fds;
+    vector<Connection*> owners;
+    int timeout = handlers_.idle ? 0 : -1;
+    while (true) {
+        fds.clear();
+        owners.clear();
+        WSAPOLLFD listenFd{};
+        listenFd.fd = listenSocket_;
+        listenFd.events = POLLRDNORM;
+        fds.push_back(listenFd);
+        owners.push_back(nullptr);
+        // El socket de aviso va siempre en la posición 1
+        WSAPOLLFD wakeFd{};
+        wakeFd.fd = wakeSocket_;
+        wakeFd.events = POLLRDNORM;
+        fds.push_back(wakeFd);
+        owners.push_back(nullptr);
+        for (auto& kv : connections_) {
+            Connection* conn = kv.second.get();
+            WSAPOLLFD pfd{};
+            pfd.fd = conn->sock;
+            pfd.events = conn->paused ? 0 : POLLRDNORM;
+            if (conn->outPos < conn->out.size()) pfd.events |= POLLWRNORM;
+            fds.push_back(pfd);
+            owners.push_back(conn);
+        }
+
+        int n = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout);
+        if (n == SOCKET_ERROR) {
+            cerr << "[SERVIDOR] Error en WSAPoll. Código: " << net::lastError() << endl;
+            return;
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            if (i == 1) {
+                drainWake();
+            }
+            else if (owners[i] == nullptr) {
+                acceptAll();
+            }
+            else {
+                service(owners[i]);
+            }
+        }
+        deliverPosted();
+        releaseHeld();
+        timeout = runIdle();
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------------
+// Trabajo en segundo plano entre tandas de eventos
+// ----------------------------------------------------------------------------------
+int Reactor::runIdle() {
+    int timeout = -1;
+    if (handlers_.idle) {
+        // Con trabajo pendiente no se espera: se atienden los eventos que haya y se sigue
+        timeout = handlers_.idle() ? 0 : kIdlePollMs;
+    }
+    if (held_ > 0 && (timeout < 0 || timeout > kHoldPollMs)) {
+        timeout = kHoldPollMs;
+    }
+    return timeout;
+}
+
+// ----------------------------------------------------------------------------------
+// Trabajo encolado desde otros hilos
+// ----------------------------------------------------------------------------------
+Reactor* Reactor::current() {
+    return current_;
+}
+
+void Reactor::post(SOCKET sock, string bytes) {
+    {
+        lock_guard<mutex> lock(postMtx_);
+        posted_.emplace_back(sock, move(bytes));
+    }
+    wake();
+}
+
+void Reactor::wake() {
+    // Un byte alcanza para despertar al reactor: los siguientes avisos esperan a que lo lea
+    if (wakePending_.exchange(true)) return;
+    char byte = 0;
+    send(wakeSocket_, &byte, 1, 0);
+}
+
+void Reactor::drainWake() {
+    wakePending_.store(false);
+    char buffer[64];
+    while (recv(wakeSocket_, buffer, sizeof(buffer), 0) > 0) {
+    }
+}
+
+void Reactor::deliverPosted() {
+    vector<pair<SOCKET, string>> posted;
+    {
+        lock_guard<mutex> lock(postMtx_);
+        if (posted_.empty()) return;
+        posted.swap(posted_);
+    }
+    for (auto& item : posted) {
+        auto it = connections_.find(item.first);
+        if (it == connections_.end()) continue;
+        Connection* conn = it->second.get();
+        conn->out += item.second;
+        service(conn);
+    }
+}
+
+void Reactor::holdReply(function<bool()> ready) {
+    holding_ = move(ready);
+}
+
+void Reactor::releaseHeld() {
+    if (held_ == 0) return;
+    vector<Connection*> ready;
+    for (auto& kv : connections_) {
+        Connection* conn = kv.second.get();
+        if (conn->ready && conn->ready()) ready.push_back(conn);
+    }
+    for (Connection* conn : ready) {
+        conn->out += conn->held;
+        conn->held.clear();
+        conn->ready = nullptr;
+        held_--;
+        // Sigue con los frames que esperaban detrás de la respuesta retenida
+        service(conn);
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Acepta todas las conexiones pendientes
+// ----------------------------------------------------------------------------------
+void Reactor::acceptAll() {
+    while (true) {
+        sockaddr_in clientAddr;
+        socklen_t clientLen = sizeof(clientAddr);
+        SOCKET sock = accept(listenSocket_, (sockaddr*)&clientAddr, &clientLen);
+        if (sock == INVALID_SOCKET) {
+            int err = net::lastError();
+            if (net::interrupted(err)) continue;
+            if (!net::wouldBlock(err)) {
+                cerr << "[SERVIDOR] Error en accept. Código: " << err << endl;
+            }
+            return;
+        }
+        net::setNonBlocking(sock);
+        protocol::setNoDelay(sock);
+
+        auto conn = make_unique<Connection>();
+        conn->sock = sock;
+#ifdef __linux__
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, sock, &ev) < 0) {
+            cerr << "[SERVIDOR] Error al registrar un cliente en epoll." << endl;
+            closesocket(sock);
+            continue;
+        }
+#endif
+        connections_[sock] = move(conn);
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Atiende una conexión con datos o espacio de escritura disponibles
+// ----------------------------------------------------------------------------------
+void Reactor::service(Connection* conn) {
+    while (true) {
+        // Se alterna entre procesar y enviar mientras alguno avance: si processInput se detuvo
+        // por la salida pendiente y flush la vació, los frames que quedaron en el buffer se
+        // atienden ahora, porque el socket no volverá a avisar por datos que ya se leyeron
+        bool stopped;
+        do {
+            if (!processInput(conn)) {
+                closeConnection(conn);
+                return;
+            }
+            stopped = conn->paused;
+            if (!flush(conn)) {
+                closeConnection(conn);
+                return;
+            }
+        } while (stopped && !conn->paused);
+        if (conn->paused || conn->ready) {
+            // Se reanuda cuando el socket acepte las respuestas pendientes (o se libere la
+            // respuesta retenida)
+            return;
+        }
+
+        int received = static_cast<int>(recv(conn->sock, readBuffer_.data(), static_cast<int>(readBuffer_.size()), 0));
+        if (received > 0) {
+            conn->in.append(readBuffer_.data(), static_cast<size_t>(received));
+            Metrics::getInstance().add(Metrics::BYTES_IN, static_cast<uint64_t>(received));
+            continue;
+        }
+        if (received == 0) {
+            // El cliente cerró la conexión
+            closeConnection(conn);
+            return;
+        }
+        int err = net::lastError();
+        if (net::interrupted(err)) continue;
+        if (!net::wouldBlock(err)) {
+            closeConnection(conn);
+        }
+        return;
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Procesa los frames completos; los incompletos quedan en el buffer hasta el próximo recv
+// ----------------------------------------------------------------------------------
+bool Reactor::processInput(Connection* conn) {
+    while (!conn->paused && !conn->ready) {
+        const char* data = conn->in.data() + conn->inPos;
+        size_t avail = conn->in.size() - conn->inPos;
+        int64_t length = protocol::completeLength(conn->binary, data, avail);
+        if (length < 0) {
+            cerr << "[SERVIDOR] Frame inválido; se cierra la conexión." << endl;
+            return false;
+        }
+        if (length == 0) break;
+
+        handleFrame(conn, data, static_cast<size_t>(length));
+        conn->inPos += static_cast<size_t>(length);
+
+        if (conn->out.size() - conn->outPos > kMaxPendingOutput) {
+            conn->paused = true;
+        }
+    }
+
+    // Descarta lo ya procesado
+    if (conn->inPos == conn->in.size()) {
+        conn->in.clear();
+        conn->inPos = 0;
+        if (conn->in.capacity() > 4 * kReadChunk) conn->in.shrink_to_fit();
+    }
+    else if (conn->inPos > kReadChunk) {
+        conn->in.erase(0, conn->inPos);
+        conn->inPos = 0;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Ejecuta un frame completo y agrega la respuesta al buffer de salida (o la retiene, si el
+// handler llamó a holdReply)
+// ----------------------------------------------------------------------------------
+void Reactor::handleFrame(Connection* conn, const char* data, size_t len) {
+    size_t start = conn->out.size();
+    holding_ = nullptr;
+    handleRequest(conn, data, len);
+    if (holding_) {
+        conn->held.assign(conn->out, start, string::npos);
+        conn->out.resize(start);
+        conn->ready = move(holding_);
+        held_++;
+    }
+}
+
+void Reactor::handleRequest(Connection* conn, const char* data, size_t len) {
+    if (!conn->binary) {
+        string command(data + protocol::kLengthPrefixSize, len - protocol::kLengthPrefixSize);
+        string reply;
+        if (command == protocol::kBinaryHello) {
+            reply = protocol::kBinaryHello;
+            conn->binary = true;
+        }
+        else {
+            try {
+                reply = handlers_.text(command);
+            }
+            catch (const exception& ex) {
+                cerr << "[SERVIDOR] Excepción capturada: " << ex.what() << endl;
+                reply = "Comando inválido";
+            }
+            catch (...) {
+                cerr << "[SERVIDOR] Excepción desconocida capturada." << endl;
+                reply = "Comando inválido";
+            }
+        }
+        // El cliente descarta frames más grandes que kMaxFrameSize (y la conexión con ellos)
+        if (reply.size() > protocol::kMaxFrameSize) {
+            reply = "Error: la respuesta (" + to_string(reply.size()) + " bytes) no entra en un mensaje";
+        }
+        size_t pos = conn->out.size();
+        conn->out.resize(pos + protocol::kLengthPrefixSize);
+        protocol::encodeLength(static_cast<uint32_t>(reply.size()), &conn->out[pos]);
+        conn->out += reply;
+        return;
+    }
+
+    protocol::decodeHeader(data, request_.header);
+    request_.payload.assign(data + protocol::kHeaderSize, len - protocol::kHeaderSize);
+    try {
+        if (!handlers_.binary(conn->sock, request_, response_)) return;
+    }
+    catch (const exception& ex) {
+        cerr << "[SERVIDOR] Excepción capturada: " << ex.what() << endl;
+        response_.header = request_.header;
+        response_.header.status = protocol::STATUS_ERROR;
+        response_.payload.clear();
+    }
+    if (response_.payload.size() > protocol::kMaxFrameSize) {
+        response_.header.status = protocol::STATUS_ERROR;
+        response_.payload.clear();
+    }
+    protocol::appendMessage(conn->out, response_);
+}
+
+// ----------------------------------------------------------------------------------
+// Envía las respuestas pendientes hasta que el socket no acepte más
+// ----------------------------------------------------------------------------------
+bool Reactor::flush(Connection* conn) {
+    while (conn->outPos < conn->out.size()) {
+        size_t pending = conn->out.size() - conn->outPos;
+        int sent = static_cast<int>(send(conn->sock, conn->out.data() + conn->outPos,
+            static_cast<int>(pending), net::kSendFlags));
+        if (sent > 0) {
+            conn->outPos += static_cast<size_t>(sent);
+            Metrics::getInstance().add(Metrics::BYTES_OUT, static_cast<uint64_t>(sent));
+            continue;
+        }
+        int err = net::lastError();
+        if (sent < 0 && net::interrupted(err)) continue;
+        if (sent < 0 && net::wouldBlock(err)) return true;
+        return false;
+    }
+    conn->out.clear();
+    conn->outPos = 0;
+    if (conn->out.capacity() > kMaxPendingOutput) conn->out.shrink_to_fit();
+    conn->paused = false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Cierra una conexión y libera su estado
+// ----------------------------------------------------------------------------------
+void Reactor::closeConnection(Connection* conn) {
+    SOCKET sock = conn->sock;
+    if (handlers_.closed) handlers_.closed(sock);
+    if (conn->ready) held_--;
+    {
+        // Lo encolado para esta conexión no debe llegarle a otra que reciba el mismo socket
+        lock_guard<mutex> lock(postMtx_);
+        posted_.erase(remove_if(posted_.begin(), posted_.end(), [sock](const pair<SOCKET, string>& item) {
+            return item.first == sock;
+        }), posted_.end());
+    }
+#ifdef __linux__
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, sock, nullptr);
+#endif
+    closesocket(sock);
+    connections_.erase(sock);
+}
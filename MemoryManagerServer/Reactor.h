@@ -0,0 +1,146 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Protocol.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Reactor: bucle de eventos no bloqueante del servidor.
+
+  Cada reactor corre en un hilo y atiende las conexiones que él mismo acepta; el servidor
+  lanza uno por hilo de trabajo (--threads) sobre el mismo socket de escucha. El socket de
+  escucha y los clientes son no bloqueantes, y cada conexión tiene su propio buffer de lectura
+  (donde se reensamblan los frames que llegan partidos) y de escritura (respuestas pendientes
+  cuando el socket está lleno). Un cliente lento ya no detiene a los demás.
+
+  Backend de eventos:
+    - Linux: epoll en modo edge-triggered (cada evento se atiende leyendo hasta EAGAIN).
+    - Windows: WSAPoll (level-triggered) con la misma lógica de buffers.
+
+  El procesamiento de comandos lo hacen los handlers que recibe el constructor; la negociación
+  del protocolo binario (protocol::kBinaryHello) la resuelve el reactor.
+
+  Otros hilos no tocan las conexiones de un reactor: le encolan bytes con post() y lo despiertan
+  con wake(), que escribe en un socket UDP conectado a sí mismo y vigilado junto con los demás.
+  Un handler puede retener su respuesta con holdReply() hasta que se cumpla una condición;
+  mientras tanto esa conexión no procesa más frames (las respuestas siguen en orden) y el
+  reactor sigue atendiendo al resto.
+*/
+class Reactor {
+public:
+    struct Handlers {
+        // Comando de texto -> respuesta de texto
+        function<string(const string&)> text;
+        // Mensaje binario -> respuesta binaria (con el socket de la conexión que lo envió);
+        // retorna false si el mensaje no lleva respuesta
+        function<bool(SOCKET, const protocol::Message&, protocol::Message&)> binary;
+        // Trabajo en segundo plano entre eventos (opcional); retorna true si quedó trabajo
+        // pendiente, y entonces el reactor no se bloquea esperando eventos
+        function<bool()> idle;
+        // Aviso de que una conexión se va a cerrar (opcional), antes de liberar el socket
+        function<void(SOCKET)> closed;
+    };
+
+    Reactor(SOCKET listenSocket, Handlers handlers);
+    ~Reactor();
+
+    // Prepara el backend de eventos; false si no se pudo crear
+    bool init();
+
+    // Atiende eventos indefinidamente
+    void run();
+
+    // Reactor que corre en el hilo actual (nullptr fuera de run())
+    static Reactor* current();
+
+    // Desde cualquier hilo: encola bytes para la conexión 'sock' de este reactor (se descartan
+    // si ya se cerró; el handler closed corre antes de descartar los que quedaban)
+    void post(SOCKET sock, string bytes);
+
+    // Desde cualquier hilo: hace que el reactor revise lo encolado y las respuestas retenidas
+    void wake();
+
+    // Desde un handler: la respuesta que está armando sale recién cuando 'ready' retorne true.
+    // Se consulta después de cada wake() y, como mínimo, cada kHoldPollMs.
+    void holdReply(function<bool()> ready);
+
+private:
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Estado de una conexión de cliente
+    struct Connection {
+        SOCKET sock = INVALID_SOCKET;
+        string in;            // bytes recibidos aún no procesados (desde inPos)
+        size_t inPos = 0;
+        string out;           // respuestas aún no enviadas (desde outPos)
+        size_t outPos = 0;
+        bool binary = false;  // negoció el protocolo binario
+        bool paused = false;  // no se lee más hasta vaciar 'out' (cliente que no lee sus respuestas)
+        string held;          // respuesta retenida por holdReply()
+        function<bool()> ready;  // condición para enviarla (vacía si no hay respuesta retenida)
+    };
+
+    // Máximo de bytes de respuesta pendientes antes de dejar de leer a un cliente
+    static constexpr size_t kMaxPendingOutput = 8 * 1024 * 1024;
+    // Tamaño de cada lectura del socket
+    static constexpr size_t kReadChunk = 64 * 1024;
+    // Con handler idle, cada cuánto se lo llama aunque no haya eventos
+    static constexpr int kIdlePollMs = 100;
+    // Con respuestas retenidas, cada cuánto se revisan aunque nadie despierte al reactor
+    static constexpr int kHoldPollMs = 10;
+
+    // Llama al handler idle; retorna el timeout para la próxima espera de eventos
+    int runIdle();
+    // Socket de aviso para wake(); false si no se pudo crear
+    bool openWakeSocket();
+    // Vacía el socket de aviso
+    void drainWake();
+    // Pasa lo encolado con post() a sus conexiones
+    void deliverPosted();
+    // Envía las respuestas retenidas cuya condición ya se cumplió
+    void releaseHeld();
+
+    void acceptAll();
+    // Procesa lo que haya en los buffers, envía respuestas y lee hasta que el socket se vacíe
+    void service(Connection* conn);
+    // Procesa los frames completos del buffer de lectura; false ante un error de protocolo
+    bool processInput(Connection* conn);
+    void handleFrame(Connection* conn, const char* data, size_t len);
+    // Arma la respuesta a un frame al final de 'out'
+    void handleRequest(Connection* conn, const char* data, size_t len);
+    // Envía lo pendiente; false si la conexión falló
+    bool flush(Connection* conn);
+    void closeConnection(Connection* conn);
+
+    SOCKET listenSocket_;
+    Handlers handlers_;
+    unordered_map<SOCKET, unique_ptr<Connection>> connections_;
+    vector<char> readBuffer_;
+    // Bytes encolados desde otros hilos (ver post())
+    SOCKET wakeSocket_;
+    atomic<bool> wakePending_;
+    mutex postMtx_;
+    vector<pair<SOCKET, string>> posted_;
+    // Condición de holdReply() del handler en curso, y conexiones con respuesta retenida
+    function<bool()> holding_;
+    size_t held_;
+    static thread_local Reactor* current_;
+    // Mensajes reutilizados para no reservar memoria en cada petición binaria
+    protocol::Message request_;
+    protocol::Message response_;
+#ifdef __linux__
+    int epollFd_;
+#endif
+};
+
+#endif // REACTOR_H
@@ -0,0 +1,114 @@
+#include "SharedMemoryServer.h"
+#include "Metrics.h"
+#include <iostream>
+#include <new>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+SharedMemoryServer::SharedMemoryServer(Handler handler, size_t maxChannels)
+    : handler_(move(handler)), maxChannels_(shm::kSupported ? maxChannels : 0), nextName_(1) {
+}
+
+SharedMemoryServer::~SharedMemoryServer() {
+    vector<SOCKET> socks;
+    {
+        lock_guard<mutex> lock(mtx_);
+        for (auto& entry : channels_) socks.push_back(entry.first);
+    }
+    for (SOCKET sock : socks) detach(sock);
+}
+
+#ifdef __linux__
+// ----------------------------------------------------------------------------------
+// attach: segmento nuevo con nombre único, visible solo para el mismo usuario
+// ----------------------------------------------------------------------------------
+bool SharedMemoryServer::attach(SOCKET sock, string& name) {
+    lock_guard<mutex> lock(mtx_);
+    if (channels_.size() >= maxChannels_ || channels_.count(sock)) return false;
+
+    unique_ptr<Channel> channel(new Channel());
+    channel->name = "/mpointers-" + to_string(getpid()) + "-" + to_string(nextName_++);
+    int fd = shm_open(channel->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        cerr << "[SERVIDOR] No se pudo crear el segmento " << channel->name << endl;
+        return false;
+    }
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, sizeof(shm::Segment)) == 0) {
+        addr = mmap(nullptr, sizeof(shm::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(channel->name.c_str());
+        cerr << "[SERVIDOR] No se pudo mapear el segmento " << channel->name << endl;
+        return false;
+    }
+    // El segmento nace en cero; se construyen los atómicos y se firma
+    channel->segment = new (addr) shm::Segment();
+    memcpy(channel->segment->magic, shm::kMagic, sizeof(shm::kMagic));
+    channel->segment->version = shm::kVersion;
+
+    name = channel->name;
+    Channel* raw = channel.get();
+    raw->worker = thread(&SharedMemoryServer::serve, this, raw);
+    channels_[sock] = move(channel);
+    return true;
+}
+
+void SharedMemoryServer::release(Channel& channel) {
+    // Por si el cliente nunca llegó a abrirlo (él borra el nombre al mapearlo)
+    shm_unlink(channel.name.c_str());
+    munmap(channel.segment, sizeof(shm::Segment));
+    channel.segment = nullptr;
+}
+
+void SharedMemoryServer::detach(SOCKET sock) {
+    unique_ptr<Channel> channel;
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = channels_.find(sock);
+        if (it == channels_.end()) return;
+        channel = move(it->second);
+        channels_.erase(it);
+    }
+    channel->stop.store(true, memory_order_release);
+    channel->segment->closed.store(1, memory_order_release);
+    shm::futexWake(channel->segment->request.head);
+    shm::futexWake(channel->segment->response.tail);
+    channel->worker.join();
+    release(*channel);
+}
+
+// ----------------------------------------------------------------------------------
+// Hilo del canal: petición -> handler -> respuesta, hasta que se cierre la conexión
+// ----------------------------------------------------------------------------------
+void SharedMemoryServer::serve(Channel* channel) {
+    shm::Segment* segment = channel->segment;
+    auto alive = [channel]() { return !channel->stop.load(memory_order_acquire); };
+    protocol::Message request, response;
+    Metrics& metrics = Metrics::getInstance();
+    while (shm::recvMessage(segment->request, request, alive)) {
+        metrics.add(Metrics::BYTES_IN, protocol::kHeaderSize + request.payload.size());
+        handler_(request, response);
+        if (!shm::sendMessage(segment->response, response, alive)) break;
+        metrics.add(Metrics::BYTES_OUT, protocol::kHeaderSize + response.payload.size());
+    }
+    // Un mensaje inválido también cierra el canal: el cliente lo ve en su próxima espera
+    segment->closed.store(1, memory_order_release);
+}
+#else
+bool SharedMemoryServer::attach(SOCKET, string&) {
+    return false;
+}
+
+void SharedMemoryServer::release(Channel&) {
+}
+
+void SharedMemoryServer::detach(SOCKET) {
+}
+
+void SharedMemoryServer::serve(Channel*) {
+}
+#endif
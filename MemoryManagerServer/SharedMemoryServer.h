@@ -0,0 +1,64 @@
+#ifndef SHARED_MEMORY_SERVER_H
+#define SHARED_MEMORY_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "SharedRing.h"
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  SharedMemoryServer: canales de memoria compartida para los clientes locales (ver SharedRing.h).
+
+  Cada canal pertenece a una conexión TCP (la que pidió OP_SHM_ATTACH) y lo atiende un hilo
+  propio, que lee las peticiones del anillo, las pasa al handler y escribe las respuestas.
+  Cuando la conexión se cierra, el reactor llama a detach() y el hilo termina. Como cada canal
+  ocupa un hilo, se admiten a lo sumo 'maxChannels'; los demás clientes siguen por TCP.
+
+  Solo Linux; en otros sistemas attach() siempre retorna false.
+*/
+class SharedMemoryServer {
+public:
+    typedef function<void(const protocol::Message&, protocol::Message&)> Handler;
+
+    // Canales por defecto (--shmChannels); 0 desactiva el transporte
+    static constexpr size_t kDefaultChannels = 64;
+
+    SharedMemoryServer(Handler handler, size_t maxChannels);
+    ~SharedMemoryServer();
+
+    // Crea el segmento y el hilo del canal de la conexión 'sock' y deja en 'name' el nombre
+    // que el cliente debe abrir; false si no hay lugar o no se pudo crear
+    bool attach(SOCKET sock, string& name);
+
+    // La conexión se cerró: detiene el hilo de su canal (si tenía uno) y libera el segmento
+    void detach(SOCKET sock);
+
+private:
+    SharedMemoryServer(const SharedMemoryServer&) = delete;
+    SharedMemoryServer& operator=(const SharedMemoryServer&) = delete;
+
+    struct Channel {
+        string name;
+        shm::Segment* segment = nullptr;
+        atomic<bool> stop{ false };
+        thread worker;
+    };
+
+    void serve(Channel* channel);
+    static void release(Channel& channel);
+
+    Handler handler_;
+    size_t maxChannels_;
+    mutex mtx_;
+    unordered_map<SOCKET, unique_ptr<Channel>> channels_;
+    atomic<uint32_t> nextName_;
+};
+
+#endif // SHARED_MEMORY_SERVER_H
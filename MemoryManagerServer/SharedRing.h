@@ -0,0 +1,265 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "Protocol.h"
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Transporte por memoria compartida para clientes en la misma máquina que el servidor.
+
+  El cliente se conecta por TCP como siempre y, si el servidor es local, pide un canal con
+  OP_SHM_ATTACH. El servidor crea un segmento POSIX (shm_open) con dos anillos de un solo
+  productor y un solo consumidor: 'request' (el cliente escribe, el servidor lee) y 'response'
+  (al revés), y un hilo que atiende ese canal. Los mensajes viajan con el mismo formato
+  binario que por TCP (encabezado de 16 bytes + payload), así que un mensaje más grande que el
+  anillo pasa por partes mientras el otro lado lo va leyendo.
+
+  Cada lado gira un momento esperando datos (una ida y vuelta cuesta alrededor de un
+  microsegundo) y después duerme en un futex sobre el contador del anillo; quien publica solo
+  hace la llamada al sistema si hay alguien durmiendo. La conexión TCP queda abierta sin
+  tráfico y sirve para saber si el otro lado sigue vivo: al cerrarse, el servidor libera el
+  canal, y el cliente lo nota al despertar de cada espera.
+
+  Solo Linux (futex); en otros sistemas kSupported es false y todo sigue por TCP.
+*/
+namespace shm {
+
+#ifdef __linux__
+    constexpr bool kSupported = true;
+#else
+    constexpr bool kSupported = false;
+#endif
+
+    // Bytes de cada anillo (potencia de 2: los contadores dan la vuelta sin saltos)
+    constexpr uint32_t kRingSize = 256 * 1024;
+    // Vueltas de espera activa antes de dormir (con un solo núcleo no se gira: el otro lado no
+    // podría avanzar mientras tanto), y cada cuánto se despierta a revisar al otro lado
+    constexpr int kSpins = 4000;
+    constexpr long kWaitSliceMs = 100;
+
+    static_assert((kRingSize & (kRingSize - 1)) == 0, "shm::kRingSize debe ser potencia de 2");
+    static_assert(atomic<uint32_t>::is_always_lock_free, "los contadores compartidos deben ser lock-free");
+
+    // Anillo SPSC: head y tail cuentan bytes escritos y leídos desde el inicio (módulo 2^32).
+    // Cada contador va en su propia línea de caché para que productor y consumidor no se pisen.
+    struct Ring {
+        alignas(64) atomic<uint32_t> head;
+        atomic<uint32_t> dataWaiters;   // consumidores durmiendo en head
+        alignas(64) atomic<uint32_t> tail;
+        atomic<uint32_t> spaceWaiters;  // productores durmiendo en tail
+        alignas(64) char data[kRingSize];
+    };
+
+    struct Segment {
+        char magic[8];
+        uint32_t version;
+        // El servidor cerró el canal
+        atomic<uint32_t> closed;
+        Ring request;
+        Ring response;
+    };
+
+    constexpr const char kMagic[8] = { 'M', 'P', 'S', 'H', 'M', 'R', 'N', '1' };
+    constexpr uint32_t kVersion = 1;
+
+#ifdef __linux__
+    // ----------------------------------------------------------------------------------
+    // Espera y aviso con futex (compartido entre procesos: sin FUTEX_PRIVATE_FLAG)
+    // ----------------------------------------------------------------------------------
+    inline void futexWait(atomic<uint32_t>& word, uint32_t seen, long timeoutMs) {
+        timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+    }
+
+    inline void futexWake(atomic<uint32_t>& word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    inline int spinLimit() {
+        static const int spins = thread::hardware_concurrency() > 1 ? kSpins : 0;
+        return spins;
+    }
+
+    // Espera a que 'word' deje de valer 'seen'; false si alive() dice que el otro lado ya no está
+    template <typename Alive>
+    bool waitChange(atomic<uint32_t>& word, uint32_t seen, atomic<uint32_t>& waiters, Alive&& alive) {
+        for (int i = 0, spins = spinLimit(); i < spins; i++) {
+            if (word.load(memory_order_acquire) != seen) return true;
+            cpuRelax();
+        }
+        while (true) {
+            // El orden seq_cst de estas operaciones y las de publish() asegura que, o el
+            // productor ve al que duerme, o el que duerme ve el valor nuevo antes de dormir
+            waiters.fetch_add(1, memory_order_seq_cst);
+            if (word.load(memory_order_seq_cst) == seen) futexWait(word, seen, kWaitSliceMs);
+            waiters.fetch_sub(1, memory_order_seq_cst);
+            if (word.load(memory_order_acquire) != seen) return true;
+            if (!alive()) return false;
+        }
+    }
+
+    inline void publish(atomic<uint32_t>& word, uint32_t value, atomic<uint32_t>& waiters) {
+        word.store(value, memory_order_seq_cst);
+        if (waiters.load(memory_order_seq_cst) != 0) futexWake(word);
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Escritura y lectura de bytes en un anillo
+    // ----------------------------------------------------------------------------------
+    // Productor: copia 'len' bytes; solo publica al llenarse el anillo y al terminar
+    template <typename Alive>
+    bool writeBytes(Ring& ring, const char* data, size_t len, Alive&& alive) {
+        uint32_t head = ring.head.load(memory_order_relaxed);
+        uint32_t published = head;
+        while (len > 0) {
+            uint32_t tail = ring.tail.load(memory_order_acquire);
+            uint32_t space = kRingSize - (head - tail);
+            if (space == 0) {
+                if (head != published) {
+                    publish(ring.head, head, ring.dataWaiters);
+                    published = head;
+                }
+                if (!waitChange(ring.tail, tail, ring.spaceWaiters, alive)) return false;
+                continue;
+            }
+            uint32_t n = static_cast<uint32_t>(len < space ? len : space);
+            uint32_t pos = head & (kRingSize - 1);
+            uint32_t first = n < kRingSize - pos ? n : kRingSize - pos;
+            memcpy(ring.data + pos, data, first);
+            memcpy(ring.data, data + first, n - first);
+            head += n;
+            data += n;
+            len -= n;
+        }
+        if (head != published) publish(ring.head, head, ring.dataWaiters);
+        return true;
+    }
+
+    // Consumidor: copia 'len' bytes a 'out', esperando lo que todavía no llegó
+    template <typename Alive>
+    bool readBytes(Ring& ring, char* out, size_t len, Alive&& alive) {
+        uint32_t tail = ring.tail.load(memory_order_relaxed);
+        while (len > 0) {
+            uint32_t head = ring.head.load(memory_order_acquire);
+            uint32_t avail = head - tail;
+            if (avail == 0) {
+                if (!waitChange(ring.head, head, ring.dataWaiters, alive)) return false;
+                continue;
+            }
+            uint32_t n = static_cast<uint32_t>(len < avail ? len : avail);
+            uint32_t pos = tail & (kRingSize - 1);
+            uint32_t first = n < kRingSize - pos ? n : kRingSize - pos;
+            memcpy(out, ring.data + pos, first);
+            memcpy(out + first, ring.data, n - first);
+            tail += n;
+            out += n;
+            len -= n;
+            publish(ring.tail, tail, ring.spaceWaiters);
+        }
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Mensajes del protocolo binario
+    // ----------------------------------------------------------------------------------
+    template <typename Alive>
+    bool sendMessage(Ring& ring, protocol::Message& msg, Alive&& alive) {
+        if (msg.payload.size() > protocol::kMaxFrameSize) return false;
+        msg.header.payloadLength = static_cast<uint32_t>(msg.payload.size());
+        char header[protocol::kHeaderSize];
+        protocol::encodeHeader(msg.header, header);
+        if (msg.payload.size() + protocol::kHeaderSize <= kRingSize) {
+            // Encabezado y payload se publican juntos: el otro lado despierta una sola vez
+            string wire(header, protocol::kHeaderSize);
+            wire += msg.payload;
+            return writeBytes(ring, wire.data(), wire.size(), alive);
+        }
+        return writeBytes(ring, header, protocol::kHeaderSize, alive)
+            && writeBytes(ring, msg.payload.data(), msg.payload.size(), alive);
+    }
+
+    template <typename Alive>
+    bool recvMessage(Ring& ring, protocol::Message& msg, Alive&& alive) {
+        char header[protocol::kHeaderSize];
+        if (!readBytes(ring, header, protocol::kHeaderSize, alive)) return false;
+        protocol::decodeHeader(header, msg.header);
+        if (msg.header.version != protocol::kBinaryVersion || msg.header.payloadLength > protocol::kMaxFrameSize)
+            return false;
+        msg.payload.resize(msg.header.payloadLength);
+        return msg.header.payloadLength == 0 || readBytes(ring, &msg.payload[0], msg.header.payloadLength, alive);
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Lado del cliente
+    // ----------------------------------------------------------------------------------
+    // Mapea el segmento que creó el servidor y borra su nombre (queda vivo mientras esté
+    // mapeado); nullptr si no existe o no es un segmento válido
+    inline Segment* attach(const string& name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) return nullptr;
+        void* addr = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        shm_unlink(name.c_str());
+        if (addr == MAP_FAILED) return nullptr;
+        Segment* segment = static_cast<Segment*>(addr);
+        if (memcmp(segment->magic, kMagic, sizeof(kMagic)) != 0 || segment->version != kVersion) {
+            munmap(addr, sizeof(Segment));
+            return nullptr;
+        }
+        return segment;
+    }
+
+    inline void detach(Segment* segment) {
+        if (segment) munmap(segment, sizeof(Segment));
+    }
+
+    // Envía una petición por el canal y espera la respuesta. 'sock' es la conexión TCP del
+    // canal: si el servidor la cerró (o se cayó), la espera termina con false.
+    // 'sent' indica si la petición se publicó completa (el servidor pudo haberla ejecutado).
+    inline bool call(Segment* segment, SOCKET sock, protocol::Message& msg, bool& sent) {
+        auto alive = [segment, sock]() {
+            if (segment->closed.load(memory_order_acquire)) return false;
+            pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN | POLLRDHUP;
+            pfd.revents = 0;
+            return poll(&pfd, 1, 0) == 0;
+        };
+        sent = sendMessage(segment->request, msg, alive);
+        return sent && recvMessage(segment->response, msg, alive);
+    }
+#else
+    inline Segment* attach(const string&) { return nullptr; }
+    inline void detach(Segment*) {}
+    inline bool call(Segment*, SOCKET, protocol::Message&, bool& sent) { sent = false; return false; }
+#endif
+}
+
+#endif // SHARED_RING_H
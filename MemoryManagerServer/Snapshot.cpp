@@ -0,0 +1,217 @@
+#include "Snapshot.h"
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Usamos namespace std
+using namespace std;
+
+namespace snapshot {
+
+    static const char kMagic[8] = { 'M', 'P', 'S', 'N', 'A', 'P', '0', '1' };
+    // Versión 2: la cabecera agrega logLsn
+    static constexpr uint32_t kVersion = 2;
+
+    // Trozo máximo por llamada al sistema
+    static constexpr size_t kChunk = size_t(8) << 20;
+
+    // ----------------------------------------------------------------------------------
+    // Cabecera
+    // ----------------------------------------------------------------------------------
+    Header makeHeader(size_t shardCount, size_t arenaSize, size_t typeCount, uint64_t logLsn) {
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.shardCount = static_cast<uint32_t>(shardCount);
+        header.arenaSize = arenaSize;
+        header.typeCount = static_cast<uint32_t>(typeCount);
+        header.logLsn = logLsn;
+        return header;
+    }
+
+    bool isValid(const Header& header) {
+        return memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion
+            && header.shardCount > 0;
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Checksum: cada palabra de 8 bytes se mezcla con xor, rotación y multiplicación
+    // ----------------------------------------------------------------------------------
+    static constexpr uint64_t kPrime = 0x9E3779B97F4A7C15ull;
+
+    Checksum::Checksum() : hash_(0xCBF29CE484222325ull), total_(0), tailLen_(0) {
+    }
+
+    void Checksum::mix(uint64_t word) {
+        hash_ ^= word;
+        hash_ = (hash_ << 29) | (hash_ >> 35);
+        hash_ *= kPrime;
+    }
+
+    void Checksum::update(const char* data, size_t len) {
+        total_ += len;
+        // Completa la palabra que quedó a medias en la llamada anterior
+        while (tailLen_ > 0 && len > 0) {
+            tail_[tailLen_++] = *data++;
+            len--;
+            if (tailLen_ == sizeof(tail_)) {
+                uint64_t word;
+                memcpy(&word, tail_, sizeof(word));
+                mix(word);
+                tailLen_ = 0;
+            }
+        }
+        for (; len >= 8; data += 8, len -= 8) {
+            uint64_t word;
+            memcpy(&word, data, sizeof(word));
+            mix(word);
+        }
+        memcpy(tail_, data, len);
+        tailLen_ += len;
+    }
+
+    uint64_t Checksum::value() const {
+        uint64_t hash = hash_;
+        uint64_t word = 0;
+        memcpy(&word, tail_, tailLen_);
+        hash ^= word;
+        hash = (hash << 29) | (hash >> 35);
+        hash *= kPrime;
+        // El largo total distingue imágenes que solo difieren en ceros al final
+        hash ^= total_;
+        hash *= kPrime;
+        return hash ^ (hash >> 32);
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Archivos
+    // ----------------------------------------------------------------------------------
+#ifdef _WIN32
+    int openWrite(const string& path) {
+        int fd = -1;
+        _sopen_s(&fd, path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+        return fd;
+    }
+
+    int openRead(const string& path) {
+        int fd = -1;
+        _sopen_s(&fd, path.c_str(), _O_RDONLY | _O_BINARY | _O_SEQUENTIAL, _SH_DENYWR, 0);
+        return fd;
+    }
+
+    static long rawWrite(int fd, const char* data, size_t len) {
+        return _write(fd, data, static_cast<unsigned int>(len));
+    }
+
+    static long rawRead(int fd, char* data, size_t len) {
+        return _read(fd, data, static_cast<unsigned int>(len));
+    }
+
+    static bool syncFile(int fd) {
+        return _commit(fd) == 0;
+    }
+
+    void closeFile(int fd) {
+        if (fd >= 0) _close(fd);
+    }
+
+    bool replace(const string& tmpPath, const string& path) {
+        return MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    }
+#else
+    int openWrite(const string& path) {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    int openRead(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+#ifdef POSIX_FADV_SEQUENTIAL
+        if (fd >= 0) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return fd;
+    }
+
+    static long rawWrite(int fd, const char* data, size_t len) {
+        ssize_t n;
+        do {
+            n = ::write(fd, data, len);
+        } while (n < 0 && errno == EINTR);
+        return static_cast<long>(n);
+    }
+
+    static long rawRead(int fd, char* data, size_t len) {
+        ssize_t n;
+        do {
+            n = ::read(fd, data, len);
+        } while (n < 0 && errno == EINTR);
+        return static_cast<long>(n);
+    }
+
+    static bool syncFile(int fd) {
+        return fsync(fd) == 0;
+    }
+
+    void closeFile(int fd) {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool replace(const string& tmpPath, const string& path) {
+        return rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+#endif
+
+    void removeFile(const string& path) {
+        remove(path.c_str());
+    }
+
+    // ----------------------------------------------------------------------------------
+    // Escritura y lectura en trozos grandes
+    // ----------------------------------------------------------------------------------
+    bool writeAll(int fd, const char* data, size_t len, Checksum& sum) {
+        sum.update(data, len);
+        while (len > 0) {
+            long n = rawWrite(fd, data, len < kChunk ? len : kChunk);
+            if (n <= 0) return false;
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readAll(int fd, char* data, size_t len, Checksum& sum) {
+        while (len > 0) {
+            long n = rawRead(fd, data, len < kChunk ? len : kChunk);
+            if (n <= 0) return false;
+            // Se suma cada trozo recién leído, mientras sigue en caché
+            sum.update(data, static_cast<size_t>(n));
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool writeChecksum(int fd, const Checksum& sum) {
+        uint64_t value = sum.value();
+        Checksum ignored;
+        return writeAll(fd, reinterpret_cast<const char*>(&value), sizeof(value), ignored) && syncFile(fd);
+    }
+
+    bool verifyChecksum(int fd, const Checksum& sum) {
+        uint64_t stored = 0;
+        Checksum ignored;
+        if (!readAll(fd, reinterpret_cast<char*>(&stored), sizeof(stored), ignored)) return false;
+        return stored == sum.value();
+    }
+}
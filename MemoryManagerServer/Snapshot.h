@@ -0,0 +1,92 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Snapshot: imagen binaria de la memoria del servidor, para guardarla (comando "snapshot") y
+  volver a cargarla al arrancar ("--restore").
+
+  Formato, en el orden de bytes de la máquina (la arena se guarda tal cual está en memoria):
+    Header                      40 bytes
+    nombres de tipo             por cada uno: u32 largo + bytes
+    por shard                   HandleTable::State + slots [0, used)
+    arena                       arenaSize bytes
+    checksum                    u64 de todo lo anterior
+
+  logLsn es el LSN del write-ahead log desde el que hay que aplicarlo encima del snapshot
+  (0 si el servidor no usaba log).
+
+  La tabla de bloques guarda offset, tamaño, tipo, refCount y generación de cada slot, y su
+  lista de slots libres; la lista libre del allocator sale de los bloques vivos al cargar.
+
+  La escritura y la lectura van por descriptores de archivo en trozos grandes, sin pasar por
+  el buffer de stdio. writeAll no reserva memoria ni toma locks, así que se puede usar en el
+  proceso hijo de un fork.
+*/
+namespace snapshot {
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t shardCount;
+        uint64_t arenaSize;
+        uint32_t typeCount;
+        uint32_t reserved;
+        uint64_t logLsn;
+    };
+
+    static_assert(sizeof(Header) == 40, "snapshot::Header debe ocupar 40 bytes");
+
+    // Cabecera nueva con la firma y la versión actuales
+    Header makeHeader(size_t shardCount, size_t arenaSize, size_t typeCount, uint64_t logLsn);
+
+    // true si la cabecera tiene la firma y la versión que este servidor sabe leer
+    bool isValid(const Header& header);
+
+    // Checksum de 64 bits que avanza de a 8 bytes (lo bastante rápido para no frenar al disco)
+    class Checksum {
+    public:
+        Checksum();
+        void update(const char* data, size_t len);
+        uint64_t value() const;
+
+    private:
+        void mix(uint64_t word);
+
+        uint64_t hash_;
+        uint64_t total_;
+        // Bytes que todavía no completan una palabra
+        char tail_[8];
+        size_t tailLen_;
+    };
+
+    // Descriptores de archivo (-1 si falla); openWrite crea o trunca
+    int openWrite(const string& path);
+    int openRead(const string& path);
+
+    // Escribe o lee 'len' bytes completos actualizando 'sum'
+    bool writeAll(int fd, const char* data, size_t len, Checksum& sum);
+    bool readAll(int fd, char* data, size_t len, Checksum& sum);
+
+    // Escribe el checksum final y fuerza los datos al disco
+    bool writeChecksum(int fd, const Checksum& sum);
+
+    // Lee el checksum guardado y lo compara con el calculado
+    bool verifyChecksum(int fd, const Checksum& sum);
+
+    void closeFile(int fd);
+
+    // Reemplaza 'path' por 'tmpPath' de una sola vez (el snapshot anterior sigue entero
+    // hasta que el nuevo está completo)
+    bool replace(const string& tmpPath, const string& path);
+
+    void removeFile(const string& path);
+}
+
+#endif // SNAPSHOT_H
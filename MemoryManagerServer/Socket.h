@@ -0,0 +1,136 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+/*
+  Capa mínima de compatibilidad de sockets entre Winsock (Windows) y BSD sockets (Linux).
+
+  En Windows se usan los nombres de Winsock tal cual (SOCKET, INVALID_SOCKET, closesocket, ...).
+  En Linux se definen esos mismos nombres sobre la API POSIX, de modo que el resto del código
+  (Protocol.h, ConnectionPool.h, el servidor) se escribe una sola vez.
+*/
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+
+typedef int SOCKET;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+
+inline int closesocket(SOCKET sock) {
+    return close(sock);
+}
+#endif
+
+namespace net {
+
+    // En Linux se evita SIGPIPE al escribir en una conexión que el otro extremo ya cerró
+#ifdef MSG_NOSIGNAL
+    constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int kSendFlags = 0;
+#endif
+
+    // Inicializa la librería de sockets (WSAStartup en Windows)
+    inline bool startup() {
+#ifdef _WIN32
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+        return true;
+#endif
+    }
+
+    inline void cleanup() {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    // Código del último error de sockets
+    inline int lastError() {
+#ifdef _WIN32
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    // true si el error indica que la operación no bloqueante debe reintentarse más tarde
+    inline bool wouldBlock(int err) {
+#ifdef _WIN32
+        return err == WSAEWOULDBLOCK;
+#else
+        return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+    }
+
+    // true si la llamada fue interrumpida por una señal y puede repetirse de inmediato
+    inline bool interrupted(int err) {
+#ifdef _WIN32
+        return err == WSAEINTR;
+#else
+        return err == EINTR;
+#endif
+    }
+
+    inline bool setNonBlocking(SOCKET sock) {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(sock, F_GETFL, 0);
+        return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    // true si hay datos o un cierre pendiente de leer (sin esperar); en una conexión inactiva
+    // indica que el otro extremo la cerró
+    inline bool hasPendingInput(SOCKET sock) {
+        pollfd pfd;
+        pfd.fd = sock;
+#ifdef _WIN32
+        pfd.events = POLLRDNORM;
+        pfd.revents = 0;
+        return WSAPoll(&pfd, 1, 0) != 0;
+#else
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        return poll(&pfd, 1, 0) != 0;
+#endif
+    }
+
+    // Corta la conexión en ambos sentidos sin liberar el descriptor (quien la atiende la cierra)
+    inline void shutdownBoth(SOCKET sock) {
+#ifdef _WIN32
+        shutdown(sock, SD_BOTH);
+#else
+        shutdown(sock, SHUT_RDWR);
+#endif
+    }
+
+    // Sube el límite de descriptores abiertos al máximo permitido (miles de conexiones en Linux)
+    inline void raiseDescriptorLimit() {
+#ifndef _WIN32
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+}
+
+#endif // SOCKET_H
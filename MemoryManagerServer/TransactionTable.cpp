@@ -0,0 +1,101 @@
+#include "TransactionTable.h"
+
+// Usamos namespace std
+using namespace std;
+
+TransactionTable::TransactionTable() : next_(1) {
+}
+
+// ----------------------------------------------------------------------------------
+// begin: si la tabla está llena, primero se descartan las transacciones vencidas
+// ----------------------------------------------------------------------------------
+uint32_t TransactionTable::begin() {
+    lock_guard<mutex> lock(mtx_);
+    auto now = chrono::steady_clock::now();
+    if (open_.size() >= kMaxOpen) {
+        for (auto it = open_.begin(); it != open_.end();) {
+            if (now - it->second.touched > kTimeout) it = open_.erase(it);
+            else ++it;
+        }
+        if (open_.size() >= kMaxOpen) return 0;
+    }
+    uint32_t tx = next_++;
+    if (next_ == 0) next_ = 1;
+    Transaction& txn = open_[tx];
+    txn = Transaction();
+    txn.touched = now;
+    return tx;
+}
+
+TransactionTable::Transaction* TransactionTable::find(uint32_t tx) {
+    auto it = open_.find(tx);
+    if (it == open_.end()) return nullptr;
+    auto now = chrono::steady_clock::now();
+    if (now - it->second.touched > kTimeout) {
+        open_.erase(it);
+        return nullptr;
+    }
+    it->second.touched = now;
+    return &it->second;
+}
+
+// Entrada del bloque (la crea con 'version' si es la primera vez que se toca)
+TransactionTable::Entry* TransactionTable::entryFor(Transaction& txn, int blockID, uint32_t version) {
+    for (Entry& entry : txn.entries) {
+        if (entry.blockID == blockID) {
+            if (entry.version != version && txn.conflictBlock == 0) txn.conflictBlock = blockID;
+            return &entry;
+        }
+    }
+    txn.entries.push_back(Entry{ blockID, version, false, string() });
+    return &txn.entries.back();
+}
+
+// ----------------------------------------------------------------------------------
+// Lecturas y escrituras dentro de la transacción
+// ----------------------------------------------------------------------------------
+bool TransactionTable::pending(uint32_t tx, int blockID, string& bytes, bool& found) {
+    lock_guard<mutex> lock(mtx_);
+    Transaction* txn = find(tx);
+    if (txn == nullptr) return false;
+    found = false;
+    for (const Entry& entry : txn->entries) {
+        if (entry.blockID == blockID && entry.written) {
+            bytes = entry.bytes;
+            found = true;
+        }
+    }
+    return true;
+}
+
+bool TransactionTable::observe(uint32_t tx, int blockID, uint32_t version) {
+    lock_guard<mutex> lock(mtx_);
+    Transaction* txn = find(tx);
+    if (txn == nullptr) return false;
+    entryFor(*txn, blockID, version);
+    return true;
+}
+
+bool TransactionTable::stage(uint32_t tx, int blockID, uint32_t version, string bytes) {
+    lock_guard<mutex> lock(mtx_);
+    Transaction* txn = find(tx);
+    if (txn == nullptr) return false;
+    Entry* entry = entryFor(*txn, blockID, version);
+    entry->written = true;
+    entry->bytes = move(bytes);
+    return true;
+}
+
+bool TransactionTable::take(uint32_t tx, Transaction& out) {
+    lock_guard<mutex> lock(mtx_);
+    if (find(tx) == nullptr) return false;
+    auto it = open_.find(tx);
+    out = move(it->second);
+    open_.erase(it);
+    return true;
+}
+
+size_t TransactionTable::openCount() const {
+    lock_guard<mutex> lock(mtx_);
+    return open_.size();
+}
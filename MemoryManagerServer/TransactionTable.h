@@ -0,0 +1,88 @@
+#ifndef TRANSACTION_TABLE_H
+#define TRANSACTION_TABLE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  TransactionTable: transacciones abiertas con control de concurrencia optimista.
+
+  Cada bloque tiene un número de versión que avanza con cada escritura de su valor: la del slot
+  (HandleTable::Slot::version) menos los movimientos de la compactación, que también la avanzan
+  para los lectores sin lock pero no cambian el valor (ver MemoryManager::txVersion).
+
+  Mientras la transacción está abierta no se bloquea nada: la primera vez que lee o escribe un
+  bloque se anota la versión que vio, y las escrituras quedan guardadas aquí (con el contenido
+  completo del bloque) sin tocar la memoria.
+
+  Al confirmar, el MemoryManager comprueba que ningún bloque haya cambiado de versión:
+    - sin escrituras, cada bloque se comprueba por separado con el mutex de su shard tomado
+      solo durante esa comparación. Alcanza porque una confirmación con escrituras cambia
+      todos sus bloques a la vez: si alguno cambió entre dos lecturas, su versión ya no coincide.
+    - con escrituras, se toman los mutex de los shards involucrados (en orden), se comprueban
+      todas las versiones y recién entonces se escribe.
+  Si alguna versión cambió, la transacción se descarta entera y el cliente la reintenta.
+
+  Una transacción sin actividad durante kTimeout se descarta al abrir otras. Es thread-safe;
+  se puede llamar con el mutex de un shard tomado (nunca al revés).
+*/
+class TransactionTable {
+public:
+    static constexpr chrono::seconds kTimeout{ 30 };
+    // Transacciones abiertas a la vez
+    static constexpr size_t kMaxOpen = 4096;
+
+    // Bloque tocado por una transacción
+    struct Entry {
+        int blockID;
+        uint32_t version;   // versión vista la primera vez
+        bool written;
+        string bytes;       // contenido nuevo del bloque (si written)
+    };
+
+    struct Transaction {
+        vector<Entry> entries;
+        // Bloque que ya cambió mientras la transacción estaba abierta (0 si ninguno)
+        int conflictBlock = 0;
+        chrono::steady_clock::time_point touched;
+    };
+
+    TransactionTable();
+
+    // Abre una transacción y retorna su número (nunca 0); 0 si hay demasiadas abiertas
+    uint32_t begin();
+
+    // Valor pendiente de escribir en el bloque ('found' false si la transacción no lo escribió);
+    // false si la transacción no existe
+    bool pending(uint32_t tx, int blockID, string& bytes, bool& found);
+
+    // Anota la versión leída del bloque; si ya tenía otra, la transacción queda en conflicto
+    bool observe(uint32_t tx, int blockID, uint32_t version);
+
+    // Guarda el contenido que tendrá el bloque al confirmar ('version' es la actual)
+    bool stage(uint32_t tx, int blockID, uint32_t version, string bytes);
+
+    // Quita la transacción de la tabla para confirmarla o descartarla; false si no existe
+    bool take(uint32_t tx, Transaction& out);
+
+    // Cantidad de transacciones abiertas
+    size_t openCount() const;
+
+private:
+    // Transacción viva (y le renueva el plazo); nullptr si no existe o venció
+    Transaction* find(uint32_t tx);
+    static Entry* entryFor(Transaction& txn, int blockID, uint32_t version);
+
+    mutable mutex mtx_;
+    unordered_map<uint32_t, Transaction> open_;
+    uint32_t next_;
+};
+
+#endif // TRANSACTION_TABLE_H
@@ -0,0 +1,198 @@
+#include "TypeCodec.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+
+// Usamos namespace std
+using namespace std;
+
+namespace {
+
+    typedef TypeCodec::ParseResult ParseResult;
+
+    // ----------------------------------------------------------------------------------
+    // Números (int, double, float, long)
+    // ----------------------------------------------------------------------------------
+    template <typename T>
+    ParseResult parseNumber(const char* text, size_t len, char* dst, size_t) {
+        const char* end = text + len;
+        // Como stoi/stod: se aceptan espacios iniciales, un '+' y basura al final
+        while (text < end && (*text == ' ' || *text == '\t')) text++;
+        if (text < end && *text == '+') text++;
+        T num{};
+        from_chars_result result = from_chars(text, end, num);
+        if (result.ec != errc()) return TypeCodec::PARSE_INVALID;
+        memcpy(dst, &num, sizeof(T));
+        return TypeCodec::PARSE_OK;
+    }
+
+    template <typename T>
+    void formatNumber(const char* src, size_t, string& out) {
+        T num;
+        memcpy(&num, src, sizeof(T));
+        char buffer[64];
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), num);
+        out.append(buffer, result.ptr);
+    }
+
+    template <typename T>
+    void addNumber(char* dst, const char* delta) {
+        T num, add;
+        memcpy(&num, dst, sizeof(T));
+        memcpy(&add, delta, sizeof(T));
+        if constexpr (is_integral_v<T>) {
+            // Suma sin signo: el desborde da la vuelta en lugar de ser indefinido
+            typedef make_unsigned_t<T> U;
+            num = static_cast<T>(static_cast<U>(num) + static_cast<U>(add));
+        }
+        else {
+            num += add;
+        }
+        memcpy(dst, &num, sizeof(T));
+    }
+
+    // Tipos de ancho fijo que viajan tal cual en el protocolo binario (host little-endian)
+    template <typename T>
+    bool decodeFixed(const char* data, size_t len, char* dst, size_t) {
+        if (len != sizeof(T)) return false;
+        memcpy(dst, data, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    void encodeFixed(const char* src, size_t, string& out) {
+        out.assign(src, src + sizeof(T));
+    }
+
+    // "long" siempre ocupa 8 bytes en el cable, aunque en Windows sea de 4
+    bool decodeLong(const char* data, size_t len, char* dst, size_t) {
+        if (len != sizeof(int64_t)) return false;
+        int64_t wide = 0;
+        memcpy(&wide, data, sizeof(int64_t));
+        long num = static_cast<long>(wide);
+        memcpy(dst, &num, sizeof(long));
+        return true;
+    }
+
+    void encodeLong(const char* src, size_t, string& out) {
+        long num = 0;
+        memcpy(&num, src, sizeof(long));
+        int64_t wide = num;
+        out.assign(reinterpret_cast<const char*>(&wide), sizeof(int64_t));
+    }
+
+    // ----------------------------------------------------------------------------------
+    // bool y char
+    // ----------------------------------------------------------------------------------
+    ParseResult parseBool(const char* text, size_t len, char* dst, size_t) {
+        bool b = (len == 4 && memcmp(text, "true", 4) == 0) || (len == 1 && text[0] == '1');
+        memcpy(dst, &b, sizeof(bool));
+        return TypeCodec::PARSE_OK;
+    }
+
+    void formatBool(const char* src, size_t, string& out) {
+        bool b = false;
+        memcpy(&b, src, sizeof(bool));
+        out.append(b ? "true" : "false");
+    }
+
+    bool decodeBool(const char* data, size_t len, char* dst, size_t) {
+        if (len != 1) return false;
+        bool b = data[0] != 0;
+        memcpy(dst, &b, sizeof(bool));
+        return true;
+    }
+
+    void encodeBool(const char* src, size_t, string& out) {
+        bool b = false;
+        memcpy(&b, src, sizeof(bool));
+        out.assign(1, b ? '\1' : '\0');
+    }
+
+    ParseResult parseChar(const char* text, size_t len, char* dst, size_t) {
+        *dst = (len == 0 ? '\0' : text[0]);
+        return TypeCodec::PARSE_OK;
+    }
+
+    void formatChar(const char* src, size_t, string& out) {
+        out += *src;
+    }
+
+    // ----------------------------------------------------------------------------------
+    // string: se guarda con terminador nulo si cabe
+    // ----------------------------------------------------------------------------------
+    bool copyString(const char* data, size_t len, char* dst, size_t blockSize) {
+        size_t maxCopy = (blockSize > 0 ? blockSize - 1 : 0);
+        size_t copySize = min(maxCopy, len);
+        memcpy(dst, data, copySize);
+        if (maxCopy > 0) {
+            dst[copySize] = '\0';
+        }
+        return copySize == len;
+    }
+
+    ParseResult parseString(const char* text, size_t len, char* dst, size_t blockSize) {
+        return copyString(text, len, dst, blockSize) ? TypeCodec::PARSE_OK : TypeCodec::PARSE_TRUNCATED;
+    }
+
+    void formatString(const char* src, size_t blockSize, string& out) {
+        out.append(src, strnlen(src, blockSize));
+    }
+
+    bool decodeString(const char* data, size_t len, char* dst, size_t blockSize) {
+        copyString(data, len, dst, blockSize);
+        return true;
+    }
+
+    void encodeString(const char* src, size_t blockSize, string& out) {
+        out.assign(src, strnlen(src, blockSize));
+    }
+
+    // ----------------------------------------------------------------------------------
+    // raw (y cualquier tipo no reconocido): buffer de bytes, se muestra en hexadecimal
+    // ----------------------------------------------------------------------------------
+    ParseResult parseRaw(const char* text, size_t len, char* dst, size_t blockSize) {
+        size_t copySize = min(blockSize, len);
+        memcpy(dst, text, copySize);
+        return copySize == len ? TypeCodec::PARSE_OK : TypeCodec::PARSE_TRUNCATED;
+    }
+
+    void formatRaw(const char* src, size_t blockSize, string& out) {
+        static const char digits[] = "0123456789abcdef";
+        out.reserve(out.size() + blockSize * 3);
+        for (size_t i = 0; i < blockSize; i++) {
+            unsigned char byte = static_cast<unsigned char>(src[i]);
+            out += digits[byte >> 4];
+            out += digits[byte & 0x0f];
+            out += ' ';
+        }
+    }
+
+    bool decodeRaw(const char* data, size_t len, char* dst, size_t blockSize) {
+        memcpy(dst, data, min(blockSize, len));
+        return true;
+    }
+
+    void encodeRaw(const char* src, size_t blockSize, string& out) {
+        out.assign(src, blockSize);
+    }
+
+    // Tabla indexada por TypeTag
+    const TypeCodec kCodecs[TYPE_KNOWN_COUNT] = {
+        { "int",    sizeof(int),    sizeof(int),    parseNumber<int>,    formatNumber<int>,    decodeFixed<int>,    encodeFixed<int>,    true,  addNumber<int> },
+        { "double", sizeof(double), sizeof(double), parseNumber<double>, formatNumber<double>, decodeFixed<double>, encodeFixed<double>, true,  addNumber<double> },
+        { "float",  sizeof(float),  sizeof(float),  parseNumber<float>,  formatNumber<float>,  decodeFixed<float>,  encodeFixed<float>,  true,  addNumber<float> },
+        { "long",   sizeof(long),   0,              parseNumber<long>,   formatNumber<long>,   decodeLong,          encodeLong,          true,  addNumber<long> },
+        { "bool",   sizeof(bool),   sizeof(bool),   parseBool,           formatBool,           decodeBool,          encodeBool,          true,  nullptr },
+        { "char",   sizeof(char),   sizeof(char),   parseChar,           formatChar,           decodeFixed<char>,   encodeFixed<char>,   false, nullptr },
+        // Para un string, requerimos al menos 1 byte
+        { "string", 1,              0,              parseString,         formatString,         decodeString,        encodeString,        false, nullptr },
+        // "raw" u otro, permitimos 0; en arreglos cada elemento es un byte
+        { "raw",    0,              1,              parseRaw,            formatRaw,            decodeRaw,           encodeRaw,           false, nullptr },
+    };
+}
+
+const TypeCodec& codecFor(uint8_t typeTag) {
+    return kCodecs[typeTag < TYPE_KNOWN_COUNT ? typeTag : static_cast<uint8_t>(TYPE_RAW)];
+}
@@ -0,0 +1,64 @@
+#ifndef TYPE_CODEC_H
+#define TYPE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  Codificación de valores por tipo.
+
+  El tipo de un bloque se interna una sola vez al crearlo (typeTag) y todas las conversiones se
+  despachan por una tabla de funciones indexada por ese tag, sin comparar strings. Los números
+  se convierten con from_chars/to_chars sobre buffers en la pila: leer o escribir un escalar
+  no reserva memoria (el texto resultante cabe en el buffer interno de std::string).
+
+  Los tags 0..TYPE_RAW son los tipos conocidos, en el mismo orden en que el MemoryManager los
+  interna al arrancar; cualquier otro nombre de tipo usa el codec de TYPE_RAW.
+*/
+enum TypeTag : uint8_t {
+    TYPE_INT,
+    TYPE_DOUBLE,
+    TYPE_FLOAT,
+    TYPE_LONG,
+    TYPE_BOOL,
+    TYPE_CHAR,
+    TYPE_STRING,
+    TYPE_RAW,
+    TYPE_KNOWN_COUNT
+};
+
+struct TypeCodec {
+    // Resultado de escribir un valor de texto
+    enum ParseResult { PARSE_OK, PARSE_TRUNCATED, PARSE_INVALID };
+
+    const char* name;
+    // Tamaño mínimo del bloque para guardar el tipo
+    size_t minSize;
+    // Bytes por elemento en los bloques arreglo (se copian tal cual); 0 si el tipo no se admite
+    // en arreglos (string es de largo variable y long no mide lo mismo en Windows y Linux)
+    size_t arrayElemSize;
+
+    // Texto -> memoria del bloque
+    ParseResult (*parseText)(const char* text, size_t len, char* dst, size_t blockSize);
+    // Memoria del bloque -> texto (se agrega a 'out')
+    void (*formatText)(const char* src, size_t blockSize, string& out);
+    // Valor del protocolo binario -> memoria del bloque; false si el largo no corresponde
+    bool (*decodeBinary)(const char* data, size_t len, char* dst, size_t blockSize);
+    // Memoria del bloque -> valor del protocolo binario (reemplaza 'out')
+    void (*encodeBinary)(const char* src, size_t blockSize, string& out);
+
+    // true si el tipo admite las operaciones atómicas (add, cas, xchg): escalares de ancho fijo
+    bool atomic;
+    // Suma 'delta' (ya en el formato del bloque) al valor en 'dst'; nullptr si el tipo no se
+    // suma. Los enteros dan la vuelta al desbordar, como std::atomic::fetch_add.
+    void (*addValue)(char* dst, const char* delta);
+};
+
+// Codec de un tag (los tags de tipos no conocidos usan el de TYPE_RAW)
+const TypeCodec& codecFor(uint8_t typeTag);
+
+#endif // TYPE_CODEC_H
@@ -0,0 +1,359 @@
+#include "WriteAheadLog.h"
+#include "Snapshot.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Usamos namespace std
+using namespace std;
+
+static const char kWalMagic[8] = { 'M', 'P', 'W', 'A', 'L', '0', '0', '1' };
+static constexpr uint32_t kWalVersion = 1;
+
+// Con más de esto en el buffer se despierta al hilo antes de que venza el intervalo
+static constexpr size_t kWakeBytes = size_t(1) << 20;
+
+// Checksum de un registro: encabezado sin el campo checksum, y los datos
+static uint64_t recordChecksum(const WriteAheadLog::RecordHeader& header, const char* data) {
+    snapshot::Checksum sum;
+    sum.update(reinterpret_cast<const char*>(&header), offsetof(WriteAheadLog::RecordHeader, checksum));
+    sum.update(data, header.length);
+    return sum.value();
+}
+
+static bool syncFile(FILE* file) {
+    if (fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// ----------------------------------------------------------------------------------
+// Constructor y destructor
+// ----------------------------------------------------------------------------------
+WriteAheadLog::WriteAheadLog()
+    : shardCount_(0), arenaSize_(0), mode_(WalSync::Group), interval_(kDefaultInterval), nextLsn_(1),
+      file_(nullptr), writtenLsn_(0), durableLsn_(0), failed_(false), open_(false), running_(false) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::parseSync(const string& name, WalSync& mode) {
+    if (name == "always") mode = WalSync::Always;
+    else if (name == "group") mode = WalSync::Group;
+    else if (name == "none") mode = WalSync::None;
+    else return false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Segmentos: "<path>.NNNNNN" junto al path
+// ----------------------------------------------------------------------------------
+string WriteAheadLog::segmentName(const string& path, uint64_t number) {
+    char suffix[24];
+    snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(number));
+    return path + suffix;
+}
+
+vector<pair<uint64_t, string>> WriteAheadLog::listSegments(const string& path) {
+    namespace fs = std::filesystem;
+    vector<pair<uint64_t, string>> segments;
+    fs::path base(path);
+    fs::path folder = base.has_parent_path() ? base.parent_path() : fs::path(".");
+    string prefix = base.filename().string() + ".";
+    error_code ec;
+    for (fs::directory_iterator it(folder, ec), end; !ec && it != end; it.increment(ec)) {
+        string name = it->path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+        string digits = name.substr(prefix.size());
+        if (!all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) continue;
+        segments.emplace_back(stoull(digits), it->path().string());
+    }
+    sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// ----------------------------------------------------------------------------------
+// Lectura del log al arrancar
+// ----------------------------------------------------------------------------------
+bool WriteAheadLog::replay(const string& path, size_t shardCount, size_t arenaSize, uint64_t fromLsn,
+    const function<bool(const RecordHeader&, const char*)>& fn, uint64_t& nextLsn, string& error) {
+    nextLsn = fromLsn;
+    vector<pair<uint64_t, string>> segments = listSegments(path);
+    uint64_t expected = 0;
+    vector<char> data;
+
+    for (size_t i = 0; i < segments.size(); i++) {
+        const string& name = segments[i].second;
+        FILE* file = fopen(name.c_str(), "rb");
+        if (file == nullptr) {
+            error = "no se pudo abrir '" + name + "'";
+            return false;
+        }
+        SegmentHeader header;
+        if (fread(&header, sizeof(header), 1, file) != 1) {
+            // Segmento creado justo antes de una caída: no tiene registros
+            fclose(file);
+            continue;
+        }
+        if (memcmp(header.magic, kWalMagic, sizeof(kWalMagic)) != 0 || header.version != kWalVersion) {
+            fclose(file);
+            error = "'" + name + "' no es un segmento del log";
+            return false;
+        }
+        if (header.shardCount != shardCount || header.arenaSize != arenaSize) {
+            fclose(file);
+            error = "'" + name + "' es de una memoria de " + to_string(header.arenaSize) + " bytes en "
+                + to_string(header.shardCount) + " shard(s)";
+            return false;
+        }
+        if (expected == 0) {
+            if (header.firstLsn > fromLsn) {
+                fclose(file);
+                error = "el log empieza en el LSN " + to_string(header.firstLsn)
+                    + "; falta el snapshot (--restore) desde el que sigue";
+                return false;
+            }
+        }
+        else if (header.firstLsn != expected) {
+            fclose(file);
+            error = "faltan los registros " + to_string(expected) + " a " + to_string(header.firstLsn - 1);
+            return false;
+        }
+        expected = header.firstLsn;
+
+        // Registros hasta el final o hasta el primero incompleto o dañado
+        uint64_t good = sizeof(header);
+        RecordHeader record;
+        while (fread(&record, sizeof(record), 1, file) == 1) {
+            if (record.lsn != expected || record.length > (size_t(1) << 31)) break;
+            data.resize(record.length);
+            if (record.length > 0 && fread(data.data(), record.length, 1, file) != 1) break;
+            if (recordChecksum(record, data.data()) != record.checksum) break;
+            if (record.lsn >= fromLsn && !fn(record, data.data())) {
+                fclose(file);
+                error = "el registro " + to_string(record.lsn) + " no se pudo aplicar";
+                return false;
+            }
+            expected++;
+            good += sizeof(record) + record.length;
+        }
+        fclose(file);
+        error_code ec;
+        if (std::filesystem::file_size(name, ec) != good && !ec) {
+            // Lo que sigue nunca se confirmó a un cliente en modo always: se recorta
+            std::filesystem::resize_file(name, good, ec);
+            cerr << "WAL: Se descartó el final incompleto de '" << name << "'." << endl;
+        }
+    }
+    nextLsn = max(expected, fromLsn);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------
+// Apertura y cierre
+// ----------------------------------------------------------------------------------
+bool WriteAheadLog::createSegment(uint64_t number, uint64_t firstLsn) {
+    string name = segmentName(path_, number);
+    FILE* file = fopen(name.c_str(), "wb");
+    if (file == nullptr) {
+        cerr << "WAL: No se pudo crear '" << name << "'." << endl;
+        return false;
+    }
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kWalMagic, sizeof(kWalMagic));
+    header.version = kWalVersion;
+    header.shardCount = static_cast<uint32_t>(shardCount_);
+    header.arenaSize = arenaSize_;
+    header.firstLsn = firstLsn;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || !syncFile(file)) {
+        fclose(file);
+        cerr << "WAL: No se pudo escribir '" << name << "'." << endl;
+        return false;
+    }
+    file_ = file;
+    segments_.emplace_back(number, firstLsn);
+    return true;
+}
+
+bool WriteAheadLog::open(const string& path, size_t shardCount, size_t arenaSize, uint64_t firstLsn,
+    WalSync mode, chrono::milliseconds interval) {
+    close();
+    path_ = path;
+    shardCount_ = shardCount;
+    arenaSize_ = arenaSize;
+    mode_ = mode;
+    interval_ = interval.count() > 0 ? interval : kDefaultInterval;
+
+    lock_guard<mutex> io(ioMtx_);
+    segments_.clear();
+    vector<pair<uint64_t, string>> existing = listSegments(path);
+    // Los segmentos anteriores se conservan hasta el próximo snapshot; todos terminan antes
+    // del segmento nuevo, así que basta con anotarlos con primer LSN 0
+    for (auto& segment : existing) {
+        segments_.emplace_back(segment.first, 0);
+    }
+    uint64_t number = existing.empty() ? 1 : existing.back().first + 1;
+    nextLsn_ = firstLsn;
+    writtenLsn_ = durableLsn_ = firstLsn - 1;
+    failed_ = false;
+    if (!createSegment(number, firstLsn)) return false;
+
+    running_ = true;
+    worker_ = thread(&WriteAheadLog::run, this);
+    open_.store(true, memory_order_release);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (!running_ && file_ == nullptr) return;
+        running_ = false;
+    }
+    open_.store(false, memory_order_release);
+    wakeup_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    uint64_t last;
+    {
+        lock_guard<mutex> lock(mtx_);
+        last = nextLsn_ - 1;
+    }
+    flush(last, true);
+    lock_guard<mutex> io(ioMtx_);
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Agregado: solo se copia al buffer (con el mutex del shard del bloque tomado)
+// ----------------------------------------------------------------------------------
+uint64_t WriteAheadLog::append(uint8_t type, uint64_t target, const char* data, size_t len) {
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.target = target;
+    header.length = static_cast<uint32_t>(len);
+    header.type = type;
+
+    lock_guard<mutex> lock(mtx_);
+    header.lsn = nextLsn_++;
+    header.checksum = recordChecksum(header, data);
+    buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer_.append(data, len);
+    if (buffer_.size() >= kWakeBytes) wakeup_.notify_one();
+    return header.lsn;
+}
+
+// ----------------------------------------------------------------------------------
+// Escritura: quien entra primero escribe todo lo acumulado (de todos los hilos)
+// ----------------------------------------------------------------------------------
+bool WriteAheadLog::flush(uint64_t lsn, bool sync) {
+    lock_guard<mutex> io(ioMtx_);
+    if (file_ == nullptr) return false;
+    if ((sync ? durableLsn_ : writtenLsn_) >= lsn) return true;
+
+    string pending;
+    uint64_t last;
+    {
+        lock_guard<mutex> lock(mtx_);
+        pending.swap(buffer_);
+        last = nextLsn_ - 1;
+    }
+    // Después de un error el segmento tiene un hueco: lo que sigue no se podría aplicar
+    if (failed_) return false;
+    uint64_t start = Metrics::nowNs();
+    bool ok = pending.empty() || fwrite(pending.data(), 1, pending.size(), file_) == pending.size();
+    ok = ok && (sync ? syncFile(file_) : fflush(file_) == 0);
+    Metrics::getInstance().record(Metrics::WAL_FLUSH, Metrics::nowNs() - start);
+    if (!ok) {
+        if (!failed_) cerr << "WAL: Error al escribir en '" << segmentName(path_, segments_.back().first) << "'." << endl;
+        failed_ = true;
+        return false;
+    }
+    writtenLsn_ = last;
+    if (sync) durableLsn_ = last;
+    return true;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    if (lsn == 0) return true;
+    if (mode_ == WalSync::Always) return flush(lsn, true);
+    return !failed();
+}
+
+void WriteAheadLog::run() {
+    unique_lock<mutex> lock(mtx_);
+    while (running_) {
+        wakeup_.wait_for(lock, interval_);
+        if (buffer_.empty()) continue;
+        uint64_t last = nextLsn_ - 1;
+        lock.unlock();
+        flush(last, mode_ != WalSync::None);
+        lock.lock();
+    }
+}
+
+// ----------------------------------------------------------------------------------
+// Segmentos y snapshots
+// ----------------------------------------------------------------------------------
+uint64_t WriteAheadLog::rotate() {
+    lock_guard<mutex> io(ioMtx_);
+    string pending;
+    uint64_t first;
+    {
+        lock_guard<mutex> lock(mtx_);
+        pending.swap(buffer_);
+        first = nextLsn_;
+    }
+    if (file_ == nullptr) return first;
+    // Igual que en flush(): después de un error lo pendiente ya no se escribe
+    bool ok = !failed_ && (pending.empty() || fwrite(pending.data(), 1, pending.size(), file_) == pending.size());
+    ok = ok && syncFile(file_);
+    string name = segmentName(path_, segments_.back().first);
+    fclose(file_);
+    file_ = nullptr;
+    if (!ok) {
+        // Los registros que no llegaron a disco no se dan por escritos: el log queda fallido
+        if (!failed_) cerr << "WAL: Error al escribir en '" << name << "'." << endl;
+        failed_ = true;
+        return first;
+    }
+    writtenLsn_ = durableLsn_ = first - 1;
+    if (!createSegment(segments_.back().first + 1, first)) {
+        failed_ = true;
+    }
+    return first;
+}
+
+void WriteAheadLog::dropBefore(uint64_t lsn) {
+    lock_guard<mutex> io(ioMtx_);
+    // Se conserva desde el último segmento que empieza en 'lsn' o antes
+    size_t keep = 0;
+    for (size_t i = 0; i < segments_.size(); i++) {
+        if (segments_[i].second <= lsn) keep = i;
+    }
+    for (size_t i = 0; i < keep; i++) {
+        string name = segmentName(path_, segments_[i].first);
+        if (remove(name.c_str()) != 0) {
+            cerr << "WAL: No se pudo borrar '" << name << "'." << endl;
+        }
+    }
+    segments_.erase(segments_.begin(), segments_.begin() + keep);
+}
@@ -0,0 +1,162 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Usamos namespace std
+using namespace std;
+
+/*
+  WriteAheadLog: registro binario, solo de agregado, de los cambios que hace el MemoryManager,
+  para no perder lo hecho desde el último snapshot si el servidor se cae.
+
+  Cada registro describe un cambio físico, ya resuelto (el slot completo de la tabla de bloques,
+  los bytes escritos en la arena, un rango puesto en cero o un bloque movido), así que volver a
+  aplicarlos no repite ninguna decisión del allocator y los IDs quedan iguales. Los registros
+  llevan un LSN consecutivo y un checksum; uno incompleto al final (caída a mitad de escritura)
+  se descarta.
+
+  El log se parte en segmentos "<path>.000001", "<path>.000002", ...: cada arranque y cada
+  snapshot empiezan uno nuevo. El snapshot guarda el LSN desde el que hay que aplicar el log, y
+  cuando termina de escribirse se borran los segmentos anteriores.
+
+  Escritura (--walSync):
+    - always: la respuesta a un cliente sale recién cuando sus registros están en disco. Los
+              pedidos que esperan a la vez comparten un solo fsync (group commit): el primero
+              escribe y sincroniza todo lo acumulado, y los demás ya lo encuentran hecho.
+    - group:  un hilo escribe y sincroniza cada --walGroupMs; una caída pierde a lo sumo ese
+              intervalo.
+    - none:   el hilo escribe cada intervalo sin fsync (sobrevive a una caída del proceso, no
+              del sistema).
+  append() solo copia el registro a un buffer en memoria; nunca toca el disco.
+
+  Si una escritura o un fsync falla, el segmento queda con un hueco y lo que siga ya no se
+  podría aplicar: el log queda marcado como fallido, descarta lo que se agregue después y
+  waitDurable() retorna false para todo registro que no llegó a disco antes del error. Vuelve
+  a funcionar al reiniciar el servidor.
+*/
+enum class WalSync { None, Group, Always };
+
+class WriteAheadLog {
+public:
+    // TYPE:  nombre de tipo internado; target = typeTag, datos = nombre
+    // SLOT:  slot completo de la tabla; target = (shard << 32) | slot, datos = HandleTable::Slot
+    // DATA:  bytes escritos; target = offset en la arena, datos = bytes
+    // ZERO:  rango puesto en cero; target = offset, datos = u64 largo
+    // MOVE:  bloque movido por la compactación; target = offset destino, datos = u64 origen + u64 largo
+    enum RecordType : uint8_t { TYPE = 1, SLOT, DATA, ZERO, MOVE };
+
+    struct RecordHeader {
+        uint64_t lsn;
+        uint64_t target;
+        uint32_t length;        // bytes de datos después del encabezado
+        uint8_t type;
+        uint8_t reserved[3];
+        uint64_t checksum;      // de los 24 bytes anteriores y los datos
+    };
+
+    static_assert(sizeof(RecordHeader) == 32, "WriteAheadLog::RecordHeader debe ocupar 32 bytes");
+
+    // Intervalo por defecto del hilo de escritura (modo group)
+    static constexpr chrono::milliseconds kDefaultInterval{ 10 };
+
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    // Convierte un nombre de modo ("always", "group", "none"); false si no es válido
+    static bool parseSync(const string& name, WalSync& mode);
+
+    // Recorre en orden los registros de los segmentos de 'path': fn(encabezado, datos). Los
+    // segmentos deben ser de una memoria de 'shardCount' shards y 'arenaSize' bytes, y el primero
+    // debe empezar en 'fromLsn' o antes (si no, falta el snapshot con el que se cortó el log).
+    // Solo se pasan los registros desde 'fromLsn'. Un registro dañado corta su segmento (y se
+    // recorta del archivo); el siguiente debe seguir con el LSN que falta. Al terminar 'nextLsn'
+    // queda en el LSN que sigue al último válido. false (con 'error') si el log no sirve.
+    static bool replay(const string& path, size_t shardCount, size_t arenaSize, uint64_t fromLsn,
+        const function<bool(const RecordHeader&, const char*)>& fn, uint64_t& nextLsn, string& error);
+
+    // Abre un segmento nuevo que empieza en 'firstLsn' y arranca el hilo de escritura
+    bool open(const string& path, size_t shardCount, size_t arenaSize, uint64_t firstLsn, WalSync mode,
+        chrono::milliseconds interval);
+
+    // Escribe y sincroniza lo pendiente y detiene el hilo
+    void close();
+
+    bool isOpen() const { return open_.load(memory_order_acquire); }
+
+    // Agrega un registro al buffer y retorna su LSN
+    uint64_t append(uint8_t type, uint64_t target, const char* data, size_t len);
+
+    // En modo always espera a que el registro 'lsn' (y los anteriores) estén en disco. false si
+    // no se pudo escribir o el log ya había fallado (en cualquier modo)
+    bool waitDurable(uint64_t lsn);
+
+    bool failed() const { return failed_.load(memory_order_acquire); }
+
+    // Escribe lo pendiente, cierra el segmento y abre uno nuevo; retorna su primer LSN
+    uint64_t rotate();
+
+    // Borra los segmentos que terminan antes de 'lsn' (ya incluidos en un snapshot)
+    void dropBefore(uint64_t lsn);
+
+private:
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    struct SegmentHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t shardCount;
+        uint64_t arenaSize;
+        uint64_t firstLsn;
+    };
+
+    // Segmentos existentes de 'path' (número, archivo) ordenados por número
+    static vector<pair<uint64_t, string>> listSegments(const string& path);
+    static string segmentName(const string& path, uint64_t number);
+
+    // Crea el segmento 'number' con su encabezado (con ioMtx_ tomado)
+    bool createSegment(uint64_t number, uint64_t firstLsn);
+
+    // Escribe lo pendiente hasta 'lsn' inclusive y, con 'sync', hace fsync. Si otro hilo ya lo
+    // hizo retorna enseguida: así varios pedidos comparten un fsync. false si la escritura falló
+    // ahora o antes (después de un error lo pendiente se descarta).
+    bool flush(uint64_t lsn, bool sync);
+
+    void run();
+
+    string path_;
+    size_t shardCount_;
+    size_t arenaSize_;
+    WalSync mode_;
+    chrono::milliseconds interval_;
+
+    // mtx_ protege el buffer y el próximo LSN (append); ioMtx_ el archivo y los segmentos
+    mutex mtx_;
+    string buffer_;
+    uint64_t nextLsn_;
+    mutex ioMtx_;
+    FILE* file_;
+    uint64_t writtenLsn_;
+    uint64_t durableLsn_;
+    atomic<bool> failed_;
+    // Segmentos vivos: (número, primer LSN)
+    vector<pair<uint64_t, uint64_t>> segments_;
+
+    atomic<bool> open_;
+    thread worker_;
+    bool running_;
+    condition_variable wakeup_;
+};
+
+#endif // WRITE_AHEAD_LOG_H